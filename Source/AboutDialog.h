@@ -2,14 +2,18 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "MarkdownConverter.h"
+#include "LessonLibrary.h"
 #include <juce_core/juce_core.h>
 #include <juce_gui_extra/juce_gui_extra.h>
 #include "BinaryData.h"
+#include "Trace.h"
 
 // Custom WebBrowserComponent that forwards specific keys to parent and opens external links
 class DialogWebBrowser : public juce::WebBrowserComponent
 {
 public:
+    std::function<void()> onPageLoaded;
+
     bool keyPressed(const juce::KeyPress& key) override
     {
         // Forward Return and Delete keys to parent, let Escape work normally
@@ -32,13 +36,24 @@ public:
         }
         return true;
     }
+
+    void pageFinishedLoading(const juce::String&) override
+    {
+        if (onPageLoaded)
+            onPageLoaded();
+    }
 };
 
-class AboutDialog : public juce::Component
+// The README, or a lesson from the LessonLibrary. A lesson's blocks are each
+// wrapped in a <div>, so an edit to the file replaces just the divs of the
+// blocks that changed rather than reloading the page.
+class AboutDialog : public juce::Component,
+                    private LessonLibrary::Listener
 {
 public:
     AboutDialog()
     {
+        TRACE_SCOPE("AboutDialog::AboutDialog");
         
         // Title
         titleLabel.setText("Musical Mode Trainer", juce::dontSendNotification);
@@ -57,18 +72,21 @@ public:
         infoLabel.setJustificationType(juce::Justification::centred);
         addAndMakeVisible(infoLabel);
         
-        // Convert README.md from binary data to HTML and display in a web view
-        MarkdownConverter converter;
-        std::string markdownContent(BinaryData::README_md, BinaryData::README_mdSize);
-        std::string convertedHtml = converter.convertToHtml(markdownContent);
-        
-        // Wrap in full HTML document with styling
-        std::string htmlContent = createFullHtmlDocument(convertedHtml);
+        // Lessons, offered only once there are some
+        lessonChooser.onChange = [this] {
+            if (lessonChooser.getSelectedId() > 1)
+                showLesson(lessonChooser.getText());
+            else
+                showReadme();
+        };
+        addChildComponent(lessonChooser);
         
-        auto tempFile = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("readme.html");
-        tempFile.replaceWithText(htmlContent);
-        webView.goToURL("file://" + tempFile.getFullPathName());
+        webView.onPageLoaded = [this] { pageLoaded = true; };
+        showReadme();
         addAndMakeVisible(webView);
+        
+        lessonLibrary->addListener(this);
+        lessonsChanged();
 
         // Close button
         closeButton.setButtonText("Close");
@@ -86,6 +104,11 @@ closeButton.addShortcut(juce::KeyPress(juce::KeyPress::deleteKey));
         addAndMakeVisible(closeButton);
     }
     
+    ~AboutDialog() override
+    {
+        lessonLibrary->removeListener(this);
+    }
+    
     void paint(juce::Graphics& g) override
     {
         g.fillAll(juce::Colours::darkgrey);
@@ -103,6 +126,12 @@ closeButton.addShortcut(juce::KeyPress(juce::KeyPress::deleteKey));
         infoLabel.setBounds(area.removeFromTop(50));
         area.removeFromTop(15);
         
+        if (lessonChooser.isVisible())
+        {
+            lessonChooser.setBounds(area.removeFromTop(26));
+            area.removeFromTop(10);
+        }
+        
         closeButton.setBounds(area.removeFromBottom(30));
         area.removeFromBottom(10);
         
@@ -113,14 +142,102 @@ closeButton.addShortcut(juce::KeyPress(juce::KeyPress::deleteKey));
 private:
     juce::Label titleLabel;
     juce::Label infoLabel;
+    juce::ComboBox lessonChooser;  // "About", then each lesson
     DialogWebBrowser webView;
     juce::TextButton closeButton;
     
+    juce::SharedResourcePointer<LessonLibrary> lessonLibrary;
+    juce::String shownLesson;  // Empty while the README is shown
+    int shownVersion = 0;
+    bool pageLoaded = false;   // Until then the page can't be updated in place
+    
+    void showReadme()
+    {
+        // Convert README.md from binary data to HTML and display in a web view
+        MarkdownConverter converter;
+        std::string markdownContent(BinaryData::README_md, BinaryData::README_mdSize);
+        std::string convertedHtml = converter.convertToHtml(markdownContent);
+        
+        shownLesson = {};
+        showPage(createFullHtmlDocument(convertedHtml), "readme.html");
+    }
+    
+    void showLesson(const juce::String& name)
+    {
+        TRACE_SCOPE("AboutDialog::showLesson");
+        std::string blocksHtml = "<div id=\"blocks\">\n";
+        for (const auto& block : lessonLibrary->getLessonBlocks(name, shownVersion))
+            blocksHtml += "<div>" + *block.html + "</div>\n";
+        blocksHtml += "</div>";
+        
+        shownLesson = name;
+        showPage(createFullHtmlDocument(blocksHtml), "lesson.html");
+    }
+    
+    void showPage(const std::string& htmlContent, const juce::String& fileName)
+    {
+        auto tempFile = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile(fileName);
+        tempFile.replaceWithText(htmlContent);
+        pageLoaded = false;
+        webView.goToURL("file://" + tempFile.getFullPathName());
+    }
+    
+    void lessonsChanged() override
+    {
+        auto names = lessonLibrary->getLessonNames();
+        if (shownLesson.isNotEmpty() && !names.contains(shownLesson))
+            showReadme();
+        
+        lessonChooser.clear(juce::dontSendNotification);
+        lessonChooser.addItem("About", 1);
+        lessonChooser.addItemList(names, 2);
+        lessonChooser.setSelectedId(shownLesson.isEmpty() ? 1 : names.indexOf(shownLesson) + 2, juce::dontSendNotification);
+        
+        lessonChooser.setVisible(!names.isEmpty());
+        resized();
+    }
+    
+    void lessonChanged(const LessonLibrary::Change& change) override
+    {
+        if (change.lesson != shownLesson || change.version <= shownVersion)
+            return;  // Not shown, or already in the page
+        
+        // A change missed, or a page still loading, means starting again
+        if (!pageLoaded || change.version != shownVersion + 1)
+        {
+            showLesson(shownLesson);
+            return;
+        }
+        
+        TRACE_SCOPE("AboutDialog::lessonChanged");
+        juce::Array<juce::var> inserted;
+        for (const auto& block : change.inserted)
+            inserted.add(juce::String::fromUTF8(block.html->data(), static_cast<int>(block.html->size())));
+        
+        webView.evaluateJavascript("updateBlocks(" + juce::String(change.firstBlock) + ", " + juce::String(change.numRemoved)
+                                   + ", " + juce::JSON::toString(juce::var(inserted), true) + ");");
+        shownVersion = change.version;
+    }
+    
     std::string createFullHtmlDocument(const std::string& bodyHtml)
     {
         return R"(<!DOCTYPE html>
 <html>
 <head>
+    <script>
+        // Replace a lesson's changed blocks (see AboutDialog::lessonChanged)
+        function updateBlocks(first, numRemoved, inserted) {
+            var blocks = document.getElementById('blocks');
+            for (var i = 0; i < numRemoved; ++i)
+                blocks.removeChild(blocks.children[first]);
+            var next = blocks.children[first] || null;
+            inserted.forEach(function (html) {
+                var block = document.createElement('div');
+                block.innerHTML = html;
+                blocks.insertBefore(block, next);
+            });
+        }
+    </script>
     <style>
         body { font-family: Arial, sans-serif; font-size: 14px; padding: 20px; line-height: 1.4; margin: 0; }
         h1, h2, h3, h4, h5, h6 { color: #333; margin-top: 16px; margin-bottom: 6px; }
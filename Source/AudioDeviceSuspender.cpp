@@ -0,0 +1,145 @@
+#include "AudioDeviceSuspender.h"
+
+AudioDeviceSuspender::AudioDeviceSuspender(juce::AudioDeviceManager& deviceManager)
+    : deviceManager(deviceManager)
+    , idleSeconds(kDefaultIdleSeconds)
+    , suspended(false)
+    , resuming(false)
+    , resumeRequestTime(0.0)
+    , lastResumeMilliseconds(0.0)
+{
+}
+
+AudioDeviceSuspender::~AudioDeviceSuspender()
+{
+    shutdown();
+}
+
+void AudioDeviceSuspender::shutdown()
+{
+    idleSeconds = 0;
+    stopTimer();
+    if (resumeThread.joinable())
+        resumeThread.join();
+}
+
+void AudioDeviceSuspender::setIdleTimeout(int seconds)
+{
+    idleSeconds = juce::jmax(0, seconds);
+    if (idleSeconds == 0)
+        stopTimer();
+}
+
+int AudioDeviceSuspender::getIdleTimeout() const
+{
+    return idleSeconds;
+}
+
+void AudioDeviceSuspender::noteActivity()
+{
+    if (idleSeconds > 0 && !suspended)
+        startTimer(idleSeconds * 1000);
+}
+
+bool AudioDeviceSuspender::isSuspended() const
+{
+    return suspended;
+}
+
+bool AudioDeviceSuspender::isResuming() const
+{
+    return resuming;
+}
+
+void AudioDeviceSuspender::timerCallback()
+{
+    stopTimer();
+
+    if (canSuspend && !canSuspend())
+    {
+        noteActivity();
+        return;
+    }
+
+    deviceManager.closeAudioDevice();
+    suspended = true;
+    juce::Logger::writeToLog("Audio device closed after " + juce::String(idleSeconds) + " s idle");
+
+    if (onSuspended)
+        onSuspended();
+}
+
+void AudioDeviceSuspender::resume(std::function<void()> onResumed)
+{
+    if (!suspended || resuming)
+        return;
+
+    resuming = true;
+    resumeRequestTime = juce::Time::getMillisecondCounterHiRes();
+    firstCallbackTime = 0.0;
+    awaitingFirstCallback = true;
+
+    if (resumeThread.joinable())
+        resumeThread.join();
+
+    // Reopening can block for as long as opening did at startup
+    resumeThread = std::thread([this, onResumed, safeThis = juce::WeakReference<AudioDeviceSuspender>(this)]
+    {
+        deviceManager.restartLastAudioDevice();
+
+        juce::MessageManager::callAsync([safeThis, onResumed]
+        {
+            if (auto* suspender = safeThis.get())
+                suspender->resumeFinished(onResumed);
+        });
+    });
+}
+
+void AudioDeviceSuspender::resumeFinished(std::function<void()> onResumed)
+{
+    if (resumeThread.joinable())
+        resumeThread.join();
+    resuming = false;
+    suspended = false;
+    noteActivity();
+
+    if (onResumed)
+        onResumed();
+
+    reportResumeLatency(0);
+}
+
+void AudioDeviceSuspender::audioCallbackStarted() noexcept
+{
+    if (awaitingFirstCallback.load(std::memory_order_relaxed) && awaitingFirstCallback.exchange(false))
+        firstCallbackTime = juce::Time::getMillisecondCounterHiRes();
+}
+
+void AudioDeviceSuspender::reportResumeLatency(int attempt)
+{
+    // The first callback usually comes within a buffer of the device starting
+    double callbackTime = firstCallbackTime;
+    if (callbackTime == 0.0)
+    {
+        if (attempt < 20)
+        {
+            juce::Timer::callAfterDelay(25, [safeThis = juce::WeakReference<AudioDeviceSuspender>(this), attempt]
+            {
+                if (auto* suspender = safeThis.get())
+                    suspender->reportResumeLatency(attempt + 1);
+            });
+        }
+        return;
+    }
+
+    lastResumeMilliseconds = callbackTime - resumeRequestTime;
+    juce::Logger::writeToLog("Audio device resumed in " + juce::String(lastResumeMilliseconds, 1) + " ms"
+                             + (lastResumeMilliseconds > kResumeTargetMilliseconds
+                                    ? " (over the " + juce::String(kResumeTargetMilliseconds, 0) + " ms target)"
+                                    : juce::String()));
+}
+
+double AudioDeviceSuspender::getLastResumeMilliseconds() const
+{
+    return lastResumeMilliseconds;
+}
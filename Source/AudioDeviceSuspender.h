@@ -0,0 +1,70 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// Closes the audio device after a period with nothing to play, so an idle
+// machine isn't woken every buffer just to output silence, and reopens it on
+// demand. Idle time is measured with a one-shot timer that is restarted by
+// activity, so waiting costs no periodic wakeups either.
+//
+// Reopening happens on a background thread, as at startup. The owner can hide
+// most of that time by rendering the first blocks while the device opens.
+class AudioDeviceSuspender : private juce::Timer
+{
+public:
+    static constexpr int kDefaultIdleSeconds = 300;
+    static constexpr double kResumeTargetMilliseconds = 150.0;  // Request to first callback
+
+    explicit AudioDeviceSuspender(juce::AudioDeviceManager& deviceManager);
+    ~AudioDeviceSuspender() override;
+
+    /** Seconds with nothing played before the device is closed; 0 never closes it */
+    void setIdleTimeout(int seconds);
+    int getIdleTimeout() const;
+
+    /** Restart the idle period; call whenever something is played */
+    void noteActivity();
+
+    bool isSuspended() const;   // Closed, or still reopening
+    bool isResuming() const;
+
+    /** Reopen the device in the background; onResumed is called on the message thread once it's running */
+    void resume(std::function<void()> onResumed);
+
+    /** Stop the idle timer and wait for a resume in progress; call before shutting the device manager down */
+    void shutdown();
+
+    /** Call at the start of every audio callback; only timestamps the first after a resume */
+    void audioCallbackStarted() noexcept;
+
+    /** Milliseconds from the last resume() to the first audio callback after it, or 0 */
+    double getLastResumeMilliseconds() const;
+
+    // Asked before suspending; return false to wait another idle period (e.g. while playing)
+    std::function<bool()> canSuspend;
+
+    // Called on the message thread after the device is closed
+    std::function<void()> onSuspended;
+
+private:
+    juce::AudioDeviceManager& deviceManager;
+    int idleSeconds;
+    bool suspended;
+    bool resuming;
+    std::thread resumeThread;
+
+    std::atomic<bool> awaitingFirstCallback { false };
+    double resumeRequestTime;
+    std::atomic<double> firstCallbackTime { 0.0 };
+    double lastResumeMilliseconds;
+
+    void timerCallback() override;
+    void resumeFinished(std::function<void()> onResumed);
+    void reportResumeLatency(int attempt);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(AudioDeviceSuspender)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioDeviceSuspender)
+};
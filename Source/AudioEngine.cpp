@@ -1,17 +1,27 @@
 #include "AudioEngine.h"
+#include "DspNodes.h"
+#include "RealtimeAudit.h"
+#include "Trace.h"
+#include <algorithm>
 #include <cmath>
-#include <juce_events/juce_events.h>
 
 AudioEngine::AudioEngine()
     : currentSampleRate(44100.0)
     , currentAngle(0.0)
     , angleDelta(0.0)
-    , isPlaying(false)
     , currentNoteIndex(0)
-    , noteDuration(0.5f)
     , samplesSinceNoteStart(0)
-    , currentPattern(PlaybackPattern::Ascending)
+    , currentMode(ModeType::Ionian)
     , random(juce::Time::currentTimeMillis())
+    , activePlayId(0)
+    , notifiedPlayId(0)
+    , timbre(Timbre::Pure)
+    , maximumBlockSize(0)
+    , lowestFrequency(0.0f)
+    , highestFrequency(0.0f)
+    , limiterActive(false)
+    , limiterSwitchingOff(false)
+    , soundingMidiNote(-1)
 {
     // Initialize the modes with their interval patterns (in semitones from root)
     modes[ModeType::Ionian] = {0, 2, 4, 5, 7, 9, 11, 12};      // Major scale
@@ -30,61 +40,200 @@ AudioEngine::AudioEngine()
     modeNames[ModeType::Aeolian] = "Aeolian";  // Natural minor
     modeNames[ModeType::Locrian] = "Locrian";
     
-    // Initialize pattern names
-    patternNames[PlaybackPattern::Ascending] = "Ascending";
-    patternNames[PlaybackPattern::Descending] = "Descending";
-    patternNames[PlaybackPattern::Intervallic] = "Thirds Ascending";
-    patternNames[PlaybackPattern::IntervallicDescending] = "Thirds Descending";
-    patternNames[PlaybackPattern::Random] = "Random";
+    // Built-in patterns, in PlaybackPattern order
+    addPattern("Ascending", "1..8");
+    addPattern("Descending", "8..1");
+    addPattern("Thirds Ascending", "cycle 3 1..7, 8");
+    addPattern("Thirds Descending", "cycle 3 8..2, 1");
+    addPattern("Random", "1, shuffle 2..8");
+    
+    // Playback only ever copies a program into these, so they never reallocate
+    currentScale.reserve(PatternLanguage::kMaxNotes);
+    currentMidiNotes.reserve(PatternLanguage::kMaxNotes);
+    currentNoteGains.reserve(PatternLanguage::kMaxNotes);
+    playbackOrder.reserve(PatternLanguage::kMaxNotes);
+    commands.resize(kCommandQueueSize);
+    
+    activeGraph = createGraph(timbre);
+}
+
+AudioEngine::~AudioEngine()
+{
+    delete pendingGraph.exchange(nullptr);
+    delete retiredGraph.exchange(nullptr);
+}
+
+void AudioEngine::addPattern(const juce::String& name, const juce::String& source)
+{
+    PatternLanguage::Definition definition;
+    definition.name = name;
+    definition.source = source;
+    
+    juce::String error;
+    bool parsed = PatternLanguage::parse(source, definition.code, error);
+    jassert(parsed); // Built-in patterns must always parse
+    juce::ignoreUnused(parsed);
+    
+    patternDefinitions.push_back(definition);
+    compilePrograms(static_cast<PlaybackPattern>(patternDefinitions.size() - 1));
+}
+
+void AudioEngine::compilePrograms(PlaybackPattern pattern)
+{
+    auto& code = patternDefinitions[static_cast<size_t>(pattern)].code;
+    for (auto& [mode, intervals] : modes)
+    {
+        std::vector<int> scaleSemitones(intervals.begin(), intervals.begin() + 7);
+        programs[{mode, pattern}] = PatternLanguage::compile(code, scaleSemitones);
+    }
+}
+
+juce::StringArray AudioEngine::loadUserPatterns(const juce::File& file)
+{
+    juce::StringArray errors;
+    if (!file.existsAsFile())
+        return errors;
+    
+    for (auto& definition : PatternLanguage::parseDefinitions(file.loadFileAsString(), errors))
+    {
+        patternDefinitions.push_back(definition);
+        compilePrograms(static_cast<PlaybackPattern>(patternDefinitions.size() - 1));
+    }
+    return errors;
+}
+
+juce::File AudioEngine::getUserPatternFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("ModeTrainer")
+        .getChildFile("Patterns.txt");
 }
 
 void AudioEngine::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
+    const juce::ScopedLock lock(graphBuildLock);
+    
     currentSampleRate = sampleRate;
+    maximumBlockSize = juce::jmax(1, samplesPerBlockExpected);
+    reverbStage.prepare(sampleRate, maximumBlockSize);
+    equalLoudness.prepare(sampleRate);
+    peakLimiter.prepare(sampleRate, maximumBlockSize);
+    
+    // The audio thread isn't running, so the active graph can be touched here
+    activeGraph->prepare(sampleRate, maximumBlockSize);
+    if (auto* graph = pendingGraph.load())
+        graph->prepare(sampleRate, maximumBlockSize);
+    midiOutput.ensureSize(256);  // Room for a block's note events without allocating
 }
 
 void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    if (!isPlaying)
+    RealtimeAudit::ScopedRealtimeSection realtimeSection;
+    TRACE_SCOPE("AudioEngine::getNextAudioBlock");
+    
+    midiOutput.clear();
+    applyCommands();
+
+    // Release a mirrored note that was cut off by stopPlaying()
+    if (midiNoteOffPending.exchange(false) && soundingMidiNote >= 0)
+    {
+        midiOutput.addEvent(juce::MidiMessage::noteOff(1, soundingMidiNote), 0);
+        soundingMidiNote = -1;
+    }
+
+    if (maximumBlockSize == 0)
     {
+        jassertfalse; // prepareToPlay() hasn't been called
         bufferToFill.clearActiveBufferRegion();
         return;
     }
 
-    auto* leftBuffer = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-    auto* rightBuffer = bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample);
+    // Pick up a new graph, once the one it replaced last time has been deleted
+    if (retiredGraph.load() == nullptr)
+    {
+        if (auto* graph = pendingGraph.exchange(nullptr))
+        {
+            retiredGraph = activeGraph.release();
+            activeGraph.reset(graph);
+        }
+    }
+
+    // Render in chunks no longer than the prepared buffers, in case the device
+    // delivers more samples than it said it would
+    for (int offset = 0; offset < bufferToFill.numSamples;)
+    {
+        int numSamples = juce::jmin(bufferToFill.numSamples - offset, maximumBlockSize);
+        renderChunk(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + offset, numSamples),
+                    offset);
+        offset += numSamples;
+    }
 
-    for (auto sample = 0; sample < bufferToFill.numSamples; ++sample)
+    if (limiterActive)
     {
-        // Calculate envelope (fade in/out for each note)
-        float envelope = calculateEnvelope();
-        
-        // Generate sine wave
-        auto currentSample = static_cast<float>(std::sin(currentAngle)) * 0.125f * envelope;
+        peakLimiter.process(bufferToFill);
+        if (limiterSwitchingOff && peakLimiter.isSilent())
+            limiterActive = limiterSwitchingOff = false;
+    }
+}
 
-        leftBuffer[sample] = currentSample;
-        rightBuffer[sample] = currentSample;
+void AudioEngine::renderChunk(const juce::AudioSourceChannelInfo& chunk, int midiOffset)
+{
+    bool mirrorToMidi = midiMirroringEnabled;
+    bool panByDegree = degreePanningEnabled;
+    float duration = noteDuration.load(std::memory_order_relaxed);
 
-        currentAngle += angleDelta;
-        samplesSinceNoteStart++;
+    // Run the graph once per note, so nodes see whole stretches of one note
+    DspContext context;
+    context.output = &chunk;
+    int position = 0;
+
+    while (isPlaying && position < chunk.numSamples)
+    {
+        // Mirror each note start, releasing the previous note at the same position
+        if (mirrorToMidi && samplesSinceNoteStart == 0)
+        {
+            if (soundingMidiNote >= 0)
+                midiOutput.addEvent(juce::MidiMessage::noteOff(1, soundingMidiNote), midiOffset + position);
+            soundingMidiNote = currentMidiNotes[playbackOrder[currentNoteIndex]];
+            midiOutput.addEvent(juce::MidiMessage::noteOn(1, soundingMidiNote, static_cast<juce::uint8>(100)),
+                                midiOffset + position);
+        }
+
+        int samplesPerNote = static_cast<int>(duration * currentSampleRate);
+        int segmentLength = juce::jlimit(1, chunk.numSamples - position, samplesPerNote - samplesSinceNoteStart);
+
+        context.offset = position;
+        context.numSamples = segmentLength;
+        context.noteActive = true;
+        context.frequency = currentScale[playbackOrder[currentNoteIndex]];
+        context.noteGain = currentNoteGains[playbackOrder[currentNoteIndex]];
+        context.startAngle = currentAngle;
+        context.angleDelta = angleDelta;
+        context.samplesSinceNoteStart = samplesSinceNoteStart;
+        context.samplesPerNote = duration * static_cast<float>(currentSampleRate);
+        context.panPosition = panByDegree ? getPanPosition() : -1.0f;
+        activeGraph->process(context);
+
+        currentAngle += angleDelta * segmentLength;
+        samplesSinceNoteStart += segmentLength;
+        position += segmentLength;
 
         // Check if we need to move to the next note
-        if (samplesSinceNoteStart >= static_cast<int>(noteDuration * currentSampleRate))
+        if (samplesSinceNoteStart >= static_cast<int>(duration * currentSampleRate))
         {
             currentNoteIndex++;
             if (currentNoteIndex >= playbackOrder.size())
             {
+                // Notify playback finished; the message thread picks this up in timerCallback.
+                // Set before clearing isPlaying, which is when the timer stops polling.
+                finishedPlayId.store(activePlayId, std::memory_order_release);
                 isPlaying = false;
-                // Call callback to notify playback finished - marshal to message thread
-                if (onPlaybackFinished)
+                if (soundingMidiNote >= 0)
                 {
-                    juce::MessageManager::callAsync([this]()
-                    {
-                        if (onPlaybackFinished)
-                            onPlaybackFinished();
-                    });
+                    midiOutput.addEvent(juce::MidiMessage::noteOff(1, soundingMidiNote),
+                                        midiOffset + juce::jmin(position, chunk.numSamples - 1));
+                    soundingMidiNote = -1;
                 }
-                break;
             }
             else
             {
@@ -92,6 +241,29 @@ void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferTo
             }
         }
     }
+
+    // The rest of the chunk has no note, but effects like reverb keep ringing
+    if (position < chunk.numSamples)
+    {
+        context.offset = position;
+        context.numSamples = chunk.numSamples - position;
+        context.noteActive = false;
+        context.panPosition = -1.0f;
+        activeGraph->process(context);
+    }
+}
+
+float AudioEngine::getPanPosition() const
+{
+    if (currentNoteIndex >= playbackOrder.size() || highestFrequency <= lowestFrequency)
+        return 0.5f;
+    
+    // Evenly spaced by pitch, kept in from the outermost channels so no note is
+    // heard from one speaker only
+    constexpr float spread = 0.8f;
+    float frequency = currentScale[playbackOrder[currentNoteIndex]];
+    float pitch = std::log2(frequency / lowestFrequency) / std::log2(highestFrequency / lowestFrequency);
+    return 0.5f + spread * (pitch - 0.5f);
 }
 
 void AudioEngine::releaseResources()
@@ -101,114 +273,350 @@ void AudioEngine::releaseResources()
 
 void AudioEngine::playMode(ModeType mode, float rootFrequency, PlaybackPattern pattern)
 {
-    if (modes.find(mode) == modes.end())
-        return;
+    TRACE_SCOPE("AudioEngine::playMode");
+    auto playback = preparePlayback(mode, rootFrequency, pattern);
+    if (playback.isValid())
+        play(playback);
+}
 
-    currentMode = mode;
-    currentPattern = pattern;
-    currentScale.clear();
-    playbackOrder.clear();
+AudioEngine::PreparedPlayback AudioEngine::preparePlayback(ModeType mode, float rootFrequency, PlaybackPattern pattern) const
+{
+    TRACE_SCOPE("AudioEngine::preparePlayback");
+    PreparedPlayback playback;
+    auto program = programs.find({mode, pattern});
+    if (program == programs.end())
+        return playback;
+
+    playback.mode = mode;
+    playback.pattern = pattern;
+    playback.rootFrequency = rootFrequency;
     
-    // Calculate frequencies for each note in the mode
-    auto& modeIntervals = modes[mode];
-    for (int semitone : modeIntervals)
+    const auto& notes = program->second;
+    for (float ratio : notes.frequencyRatios)
     {
-        float frequency = rootFrequency * std::pow(2.0f, semitone / 12.0f);
-        currentScale.push_back(frequency);
+        float frequency = rootFrequency * ratio;
+        playback.scale.push_back(frequency);
+        playback.midiNotes.push_back(juce::roundToInt(69.0 + 12.0 * std::log2(frequency / 440.0)));
     }
+    playback.order.assign(notes.order.begin(), notes.order.end());
     
-    // Generate playback order based on pattern
-    switch (pattern)
+    // Fisher-Yates shuffle of each shuffled range
+    const juce::SpinLock::ScopedLockType lock(randomLock);
+    for (auto& [start, length] : notes.shuffles)
     {
-        case PlaybackPattern::Ascending:
-            for (int i = 0; i < static_cast<int>(currentScale.size()); ++i)
-                playbackOrder.push_back(i);
-            break;
-            
-        case PlaybackPattern::Descending:
-            for (int i = static_cast<int>(currentScale.size()) - 1; i >= 0; --i)
-                playbackOrder.push_back(i);
-            break;
-            
-        case PlaybackPattern::Intervallic:
-            // Pattern: 1 3 2 4 3 5 4 6 5 7 6 1+ 7 2+ 1+
-            // Indices: 0 2 1 3 2 4 3 5 4 6 5 7  6 8  7  (where 7=octave, 8=9th)
-            {
-                // Add higher octave notes to scale
-                float octaveMultiplier = 2.0f;
-                for (int i = 1; i < 3 && i < static_cast<int>(modeIntervals.size()); ++i) // 9th and 10th
-                {
-                    float frequency = rootFrequency * std::pow(2.0f, modeIntervals[i] / 12.0f) * octaveMultiplier;
-                    currentScale.push_back(frequency);
-                }
-                
-                // Build intervallic pattern
-                std::vector<int> pattern = {0, 2, 1, 3, 2, 4, 3, 5, 4, 6, 5, 7, 6};
-                if (currentScale.size() > 8) pattern.push_back(8); // 9th if available
-                pattern.push_back(7); // octave
-                
-                for (int idx : pattern)
-                {
-                    if (idx < static_cast<int>(currentScale.size()))
-                        playbackOrder.push_back(idx);
-                }
-            }
-            break;
-            
-        case PlaybackPattern::IntervallicDescending:
-            // Pattern: 8 6 7 5 6 4 5 3 4 2 3 1 2 7- 1
-            // Indices: 7 5 6 4 5 3 4 2 3 1 2 0 1 -1 0  (where -1 is 7 below octave)
-            {
-                // Add the 7th below the root (7-)
-                float belowSeventh = rootFrequency * std::pow(2.0f, (modeIntervals[6] - 12) / 12.0f);
-                currentScale.insert(currentScale.begin(), belowSeventh); // Insert at beginning
-                
-                // Adjust all existing indices by +1 since we inserted at beginning
-                // Pattern with adjusted indices: 8 6 7 5 6 4 5 3 4 2 3 1 2 0 1
-                // (where index 0 is now the 7- and index 1 is the root)
-                std::vector<int> pattern = {8, 6, 7, 5, 6, 4, 5, 3, 4, 2, 3, 1, 2, 0, 1};
-                
-                for (int idx : pattern)
-                {
-                    if (idx < static_cast<int>(currentScale.size()))
-                        playbackOrder.push_back(idx);
-                }
-            }
-            break;
-            
-        case PlaybackPattern::Random:
-            // Start with root
-            playbackOrder.push_back(0);
-            // Add remaining notes in random order
-            std::vector<int> remainingNotes;
-            for (int i = 1; i < static_cast<int>(currentScale.size()); ++i)
-                remainingNotes.push_back(i);
-            
-            while (!remainingNotes.empty())
-            {
-                int randomIndex = random.nextInt(static_cast<int>(remainingNotes.size()));
-                playbackOrder.push_back(remainingNotes[randomIndex]);
-                remainingNotes.erase(remainingNotes.begin() + randomIndex);
-            }
-            break;
+        for (int i = length - 1; i > 0; --i)
+            std::swap(playback.order[static_cast<size_t>(start + i)],
+                      playback.order[static_cast<size_t>(start + random.nextInt(i + 1))]);
     }
+    
+    return playback;
+}
+
+template <typename FillCommand>
+bool AudioEngine::sendCommand(FillCommand&& fill)
+{
+    const juce::SpinLock::ScopedLockType lock(commandWriteLock);
+    auto write = commandFifo.write(1);
+    if (write.blockSize1 == 0)
+        return false;
+    
+    fill(commands[static_cast<size_t>(write.startIndex1)]);
+    return true;  // Made visible to the audio thread as write goes out of scope
+}
+
+juce::uint32 AudioEngine::play(const PreparedPlayback& playback)
+{
+    TRACE_SCOPE("AudioEngine::play");
+    jassert(playback.isValid());
+    jassert(playback.scale.size() <= PatternLanguage::kMaxNotes && playback.order.size() <= PatternLanguage::kMaxNotes);
+    
+    juce::uint32 playId = 0;
+    bool sent = sendCommand([&](Command& command)
+    {
+        playId = ++lastPlayId;
+        command.type = Command::Type::play;
+        command.playId = playId;
+        command.mode = playback.mode;
+        command.pattern = playback.pattern;
+        command.numScaleNotes = juce::jmin(static_cast<int>(playback.scale.size()), PatternLanguage::kMaxNotes);
+        command.numOrderNotes = juce::jmin(static_cast<int>(playback.order.size()), PatternLanguage::kMaxNotes);
+        std::copy_n(playback.scale.begin(), command.numScaleNotes, command.scale.begin());
+        std::copy_n(playback.midiNotes.begin(), command.numScaleNotes, command.midiNotes.begin());
+        std::copy_n(playback.order.begin(), command.numOrderNotes, command.order.begin());
+        numQueuedPlays++;
+        numNotesInPlayback = command.numOrderNotes;
+    });
+    if (!sent)
+        return 0;
+    
+    // Poll for the end of playback, unless there's no message loop to do it
+    if (onPlaybackFinished && juce::MessageManager::existsAndIsCurrentThread())
+        startTimerHz(60);
+    
+    return playId;
+}
+
+void AudioEngine::restartPlayback()
+{
+    if (!isPlaying)
+        return;
+    
+    currentNoteIndex = 0;
+    currentAngle = 0.0;
+    playNextNote();  // Also works out the phase step at the current rate
+}
+
+bool AudioEngine::stopPlaying()
+{
+    return sendCommand([](Command& command) { command.type = Command::Type::stop; });
+}
+
+void AudioEngine::applyCommands()
+{
+    auto read = commandFifo.read(commandFifo.getNumReady());
+    read.forEach([this](int index) { applyCommand(commands[static_cast<size_t>(index)]); });
+}
+
+void AudioEngine::applyCommand(const Command& command)
+{
+    if (command.type == Command::Type::stop)
+    {
+        isPlaying = false;
+        currentAngle = 0.0;
+        midiNoteOffPending = true;
+        return;
+    }
+    
+    currentMode = command.mode;
+    currentPattern = command.pattern;
+    
+    // The vectors have capacity for any program, so these never allocate
+    currentScale.assign(command.scale.begin(), command.scale.begin() + command.numScaleNotes);
+    currentMidiNotes.assign(command.midiNotes.begin(), command.midiNotes.begin() + command.numScaleNotes);
+    playbackOrder.assign(command.order.begin(), command.order.begin() + command.numOrderNotes);
+    bool compensate = loudnessCompensationEnabled;
+
+    // Like the gains, the limiter only follows the setting as a playback
+    // starts: switching it mid-note would drop or insert its look-ahead delay
+    // and click. It starts from an empty look-ahead each time it comes on, and
+    // goes off only once what the look-ahead holds is silent, so a tail still
+    // sounding from the last playback isn't cut short.
+    if (compensate && !limiterActive)
+        peakLimiter.reset();
+    limiterSwitchingOff = limiterActive && !compensate;
+    limiterActive = limiterActive || compensate;
+
+    currentNoteGains.clear();
+    for (float frequency : currentScale)
+        currentNoteGains.push_back(compensate ? equalLoudness.getGain(frequency) : 1.0f);
+    lowestFrequency = currentScale.empty() ? 0.0f : currentScale.front();
+    highestFrequency = currentScale.empty() ? 0.0f : currentScale.back();
 
     currentNoteIndex = 0;
     samplesSinceNoteStart = 0;
-    isPlaying = true;
+    activePlayId = command.playId;
+    isPlaying = !playbackOrder.empty();
+    numQueuedPlays--;
     
     playNextNote();
 }
 
-void AudioEngine::stopPlaying()
+void AudioEngine::dispatchPendingNotifications()
 {
-    isPlaying = false;
-    currentAngle = 0.0;
+    collectRetiredGraph();
+    
+    // Only the latest playback is reported; one replaced just as it finished isn't
+    auto finished = finishedPlayId.load(std::memory_order_acquire);
+    if (finished != notifiedPlayId && finished == lastPlayId.load())
+    {
+        notifiedPlayId = finished;
+        if (onPlaybackFinished)
+            onPlaybackFinished();
+    }
+}
+
+juce::uint32 AudioEngine::getFinishedPlayId() const
+{
+    return notifiedPlayId;
+}
+
+void AudioEngine::timerCallback()
+{
+    if (!isCurrentlyPlaying())
+        stopTimer();
+    
+    dispatchPendingNotifications();
+}
+
+// MARK: - (Processing graph)
+
+std::unique_ptr<DspGraph> AudioEngine::createGraph(Timbre graphTimbre)
+{
+    auto graph = std::make_unique<DspGraph>();
+    
+    int voice;
+    if (graphTimbre == Timbre::Warm)
+    {
+        int oscillator = graph->addNode(std::make_unique<OscillatorNode>(OscillatorNode::Waveform::Saw));
+        voice = graph->addNode(std::make_unique<FilterNode>(3.0f, 0.707f));
+        graph->connect(oscillator, voice);
+    }
+    else
+    {
+        voice = graph->addNode(std::make_unique<OscillatorNode>(OscillatorNode::Waveform::Sine));
+    }
+    
+    int gain = graph->addNode(std::make_unique<GainNode>(graphTimbre == Timbre::Warm ? 0.1f : 0.125f));
+    int reverb = graph->addNode(std::make_unique<ReverbNode>(reverbStage));
+    int output = graph->addNode(std::make_unique<OutputNode>());
+    
+    if (envelopeEnabled)
+    {
+        int envelope = graph->addNode(std::make_unique<EnvelopeNode>());
+        graph->connect(voice, envelope);
+        graph->connect(envelope, gain);
+    }
+    else
+    {
+        graph->connect(voice, gain);
+    }
+    graph->connect(gain, output);   // Dry, panned
+    graph->connect(gain, reverb);
+    graph->connect(reverb, output); // Return, unpanned
+    
+    bool built = graph->build();
+    jassert(built); // These graphs never have cycles
+    juce::ignoreUnused(built);
+    return graph;
+}
+
+void AudioEngine::rebuildGraph()
+{
+    collectRetiredGraph();
+    
+    auto graph = createGraph(timbre);
+    
+    const juce::ScopedLock lock(graphBuildLock);
+    if (maximumBlockSize > 0)
+        graph->prepare(currentSampleRate, maximumBlockSize);
+    
+    // A graph still pending was never seen by the audio thread, so it can go now
+    delete pendingGraph.exchange(graph.release());
+}
+
+void AudioEngine::collectRetiredGraph()
+{
+    delete retiredGraph.exchange(nullptr);
+}
+
+void AudioEngine::setTimbre(Timbre newTimbre)
+{
+    if (newTimbre == timbre)
+        return;
+    
+    timbre = newTimbre;
+    rebuildGraph();
+}
+
+AudioEngine::Timbre AudioEngine::getTimbre() const
+{
+    return timbre;
+}
+
+void AudioEngine::setEnvelopeEnabled(bool shouldApplyEnvelope)
+{
+    if (shouldApplyEnvelope == envelopeEnabled)
+        return;
+    
+    envelopeEnabled = shouldApplyEnvelope;
+    rebuildGraph();
+}
+
+juce::String AudioEngine::getTimbreName(Timbre timbreToName) const
+{
+    switch (timbreToName)
+    {
+        case Timbre::Pure: return "Pure";
+        case Timbre::Warm: return "Warm";
+    }
+    return "Unknown";
+}
+
+std::vector<AudioEngine::Timbre> AudioEngine::getAllTimbres() const
+{
+    return {Timbre::Pure, Timbre::Warm};
+}
+
+void AudioEngine::setMidiMirroringEnabled(bool shouldMirror)
+{
+    midiMirroringEnabled = shouldMirror;
+    if (!shouldMirror)
+        midiNoteOffPending = true;
+}
+
+const juce::MidiBuffer& AudioEngine::getMidiOutputForLastBlock() const
+{
+    return midiOutput;
+}
+
+void AudioEngine::setDegreePanningEnabled(bool shouldPan)
+{
+    degreePanningEnabled = shouldPan;
+}
+
+bool AudioEngine::isDegreePanningEnabled() const
+{
+    return degreePanningEnabled;
+}
+
+void AudioEngine::setLoudnessCompensationEnabled(bool shouldCompensate)
+{
+    loudnessCompensationEnabled = shouldCompensate;
+}
+
+bool AudioEngine::isLoudnessCompensationEnabled() const
+{
+    return loudnessCompensationEnabled;
+}
+
+ReverbStage& AudioEngine::getReverb()
+{
+    return reverbStage;
 }
 
 bool AudioEngine::isCurrentlyPlaying() const
 {
-    return isPlaying;
+    return isPlaying || numQueuedPlays > 0;
+}
+
+float AudioEngine::getNoteDuration() const
+{
+    return noteDuration;
+}
+
+int AudioEngine::getNumNotesInPlayback() const
+{
+    return numNotesInPlayback;
+}
+
+const char* AudioEngine::checkPlaybackState() const
+{
+    if (currentScale.size() != currentMidiNotes.size() || currentScale.size() != currentNoteGains.size())
+        return "scale, MIDI note and gain tables differ in length";
+    if (currentScale.capacity() < PatternLanguage::kMaxNotes || currentNoteGains.capacity() < PatternLanguage::kMaxNotes
+        || playbackOrder.capacity() < PatternLanguage::kMaxNotes)
+        return "playback tables lost their preallocated capacity";
+    for (int index : playbackOrder)
+        if (index < 0 || index >= static_cast<int>(currentScale.size()))
+            return "playback order index out of range";
+    for (float frequency : currentScale)
+        if (!std::isfinite(frequency) || frequency <= 0.0f)
+            return "invalid note frequency";
+    if (isPlaying && (currentNoteIndex < 0 || currentNoteIndex >= static_cast<int>(playbackOrder.size())))
+        return "playing past the end of the playback order";
+    if (samplesSinceNoteStart < 0)
+        return "negative position in note";
+    return nullptr;
 }
 
 juce::String AudioEngine::getModeName(ModeType mode) const
@@ -217,6 +625,18 @@ juce::String AudioEngine::getModeName(ModeType mode) const
     return (it != modeNames.end()) ? it->second : "Unknown";
 }
 
+std::vector<float> AudioEngine::getScaleFrequencies(ModeType mode, float rootFrequency) const
+{
+    std::vector<float> frequencies;
+    auto it = modes.find(mode);
+    if (it != modes.end())
+    {
+        for (int semitones : it->second)
+            frequencies.push_back(rootFrequency * std::pow(2.0f, semitones / 12.0f));
+    }
+    return frequencies;
+}
+
 std::vector<AudioEngine::ModeType> AudioEngine::getAllModes() const
 {
     return {ModeType::Ionian, ModeType::Dorian, ModeType::Phrygian, 
@@ -224,23 +644,30 @@ std::vector<AudioEngine::ModeType> AudioEngine::getAllModes() const
 }
 
 void AudioEngine::setPlaybackSpeed(float speed)
+{
+    noteDuration = getNoteDurationForSpeed(speed);
+}
+
+float AudioEngine::getNoteDurationForSpeed(float speed)
 {
     // Clamp speed between 0.5 and 3.0
     speed = juce::jlimit(0.5f, 3.0f, speed);
     // Faster speed = shorter note duration
-    noteDuration = 0.5f / speed;
+    return 0.5f / speed;
 }
 
 juce::String AudioEngine::getPatternName(PlaybackPattern pattern) const
 {
-    auto it = patternNames.find(pattern);
-    return (it != patternNames.end()) ? it->second : "Unknown";
+    auto index = static_cast<size_t>(pattern);
+    return (index < patternDefinitions.size()) ? patternDefinitions[index].name : "Unknown";
 }
 
 std::vector<AudioEngine::PlaybackPattern> AudioEngine::getAllPatterns() const
 {
-    return {PlaybackPattern::Ascending, PlaybackPattern::Descending,
-            PlaybackPattern::Intervallic, PlaybackPattern::IntervallicDescending, PlaybackPattern::Random};
+    std::vector<PlaybackPattern> patterns;
+    for (size_t i = 0; i < patternDefinitions.size(); ++i)
+        patterns.push_back(static_cast<PlaybackPattern>(i));
+    return patterns;
 }
 
 void AudioEngine::setPlaybackPattern(PlaybackPattern pattern)
@@ -248,6 +675,12 @@ void AudioEngine::setPlaybackPattern(PlaybackPattern pattern)
     currentPattern = pattern;
 }
 
+void AudioEngine::setRandomSeed(juce::int64 seed)
+{
+    const juce::SpinLock::ScopedLockType lock(randomLock);
+    random.setSeed(seed);
+}
+
 void AudioEngine::playNextNote()
 {
     if (currentNoteIndex < playbackOrder.size())
@@ -258,26 +691,3 @@ void AudioEngine::playNextNote()
         samplesSinceNoteStart = 0;
     }
 }
-
-float AudioEngine::calculateEnvelope()
-{
-    float samplesPerNote = noteDuration * currentSampleRate;
-    float attackTime = 0.05f * samplesPerNote;  // 5% attack
-    float releaseTime = 0.2f * samplesPerNote;  // 20% release
-    
-    if (samplesSinceNoteStart < attackTime)
-    {
-        // Attack phase
-        return samplesSinceNoteStart / attackTime;
-    }
-    else if (samplesSinceNoteStart > samplesPerNote - releaseTime)
-    {
-        // Release phase
-        return (samplesPerNote - samplesSinceNoteStart) / releaseTime;
-    }
-    else
-    {
-        // Sustain phase
-        return 1.0f;
-    }
-}
@@ -2,11 +2,19 @@
 
 #include <juce_core/juce_core.h>
 #include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_events/juce_events.h>
+#include <array>
+#include <atomic>
 #include <map>
 #include <vector>
 #include <functional>
+#include "DspGraph.h"
+#include "EqualLoudness.h"
+#include "PatternLanguage.h"
+#include "PeakLimiter.h"
+#include "ReverbStage.h"
 
-class AudioEngine
+class AudioEngine : private juce::Timer
 {
 public:
     enum class ModeType
@@ -27,49 +35,223 @@ public:
         Intervallic,  // 1 3 2 4 3 5 4 6 5 7 6 1+ 7 2+ 1+
         IntervallicDescending,  // 8 6 7 5 6 4 5 3 4 2 3 1 2 7- 1
         Random
+        // Patterns loaded with loadUserPatterns() follow Random, in file order
+    };
+    
+    enum class Timbre
+    {
+        Pure,  // Sine
+        Warm   // Filtered saw
     };
 
     AudioEngine();
+    ~AudioEngine() override;
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate);
     void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill);
     void releaseResources();
 
+    // Everything playMode() works out before sound can start: the scale's
+    // frequencies and MIDI notes, and the order to play them in with any
+    // shuffles already done. Can be prepared well before it's played.
+    struct PreparedPlayback
+    {
+        ModeType mode = ModeType::Ionian;
+        PlaybackPattern pattern = PlaybackPattern::Ascending;
+        float rootFrequency = 0.0f;
+        std::vector<float> scale;
+        std::vector<int> midiNotes;  // For each entry of scale
+        std::vector<int> order;      // Indices into scale
+        
+        bool isValid() const { return !order.empty(); }
+    };
+    
+    // Playing and stopping can be called from any thread while the audio thread
+    // renders. They're queued and take effect at the start of the next block.
     void playMode(ModeType mode, float rootFrequency, PlaybackPattern pattern = PlaybackPattern::Ascending);
-    void stopPlaying();
+    bool stopPlaying();  // false if too many commands are already queued
+    
+    /** Work out a playback ahead of time; invalid if the pattern doesn't exist. Any thread but the audio thread. */
+    PreparedPlayback preparePlayback(ModeType mode, float rootFrequency, PlaybackPattern pattern) const;
+    
+    /**
+     * Start a prepared playback from the next block
+     * @return An id for this playback (see getFinishedPlayId()), or 0 if too many commands are already queued
+     */
+    juce::uint32 play(const PreparedPlayback& playback);
+    
+    /**
+     * Go back to the first note of the playback under way, if there is one.
+     * Only while nothing is rendering, e.g. from prepareToPlay(), to render a
+     * playback's opening again after the sample rate changed under it.
+     */
+    void restartPlayback();
     
     void setPlaybackSpeed(float speed); // 0.5 to 3.0, where 1.0 is normal speed
+    static float getNoteDurationForSpeed(float speed);  // Seconds per note, as set by setPlaybackSpeed()
     void setPlaybackPattern(PlaybackPattern pattern);
     
+    // Shuffled patterns come from this seed, so a recorded session plays back identically
+    void setRandomSeed(juce::int64 seed);
+    
+    // Rebuilds the processing graph off the audio thread and swaps it in at the next block
+    void setTimbre(Timbre timbre);
+    Timbre getTimbre() const;
+    
+    // Off, notes are rendered as sustained tones with no attack or release, for
+    // PitchShifter to shift and then apply the envelope itself. Rebuilds the graph.
+    void setEnvelopeEnabled(bool shouldApplyEnvelope);
+    juce::String getTimbreName(Timbre timbre) const;
+    std::vector<Timbre> getAllTimbres() const;
+    
     juce::String getPatternName(PlaybackPattern pattern) const;
     std::vector<PlaybackPattern> getAllPatterns() const;
     
+    /**
+     * Add the patterns defined in a text file (see PatternLanguage) after the built-in ones
+     * @param file Pattern definitions, one per line
+     * @return A message for each definition that could not be loaded
+     */
+    juce::StringArray loadUserPatterns(const juce::File& file);
+    static juce::File getUserPatternFile();
+    
+    // Called on the message thread when playback reaches the end of the pattern,
+    // once per playback. Not called for a playback that finished after a newer
+    // one was started. The audio thread only records which playback finished;
+    // a timer running while playing delivers it.
     std::function<void()> onPlaybackFinished;
+    
+    // In onPlaybackFinished, the id play() returned for the playback that finished
+    juce::uint32 getFinishedPlayId() const;
+    
+    // Deliver a pending onPlaybackFinished call now. Only needed where no message
+    // loop is running, e.g. when rendering offline.
+    void dispatchPendingNotifications();
+
+    bool isCurrentlyPlaying() const;    // Including a playback queued but not yet started
+    float getNoteDuration() const;      // Seconds per note at the current speed
+    int getNumNotesInPlayback() const;  // Length of the playback order most recently started
+    
+    /** Consistency of the audio thread's playback state, for tests; nullptr if consistent. Call between blocks on the audio thread. */
+    const char* checkPlaybackState() const;
+
+    // Note events for the block most recently rendered, at their sample positions
+    // within that block. Only filled while mirroring is enabled.
+    void setMidiMirroringEnabled(bool shouldMirror);
+    const juce::MidiBuffer& getMidiOutputForLastBlock() const;
+
+    // Place each note across the output channels by pitch, lowest note towards the
+    // first channel and highest towards the last. Off, every channel gets every note.
+    void setDegreePanningEnabled(bool shouldPan);
+    bool isDegreePanningEnabled() const;
+
+    // Give each note a gain from the equal-loudness contours, so low and high
+    // notes sound about as loud as each other, and limit the output's peaks
+    // (delaying it by the limiter's look-ahead). Off until enabled, so
+    // renderings stay the same as before it existed. Both the gains and the
+    // limiter take effect when the next playback starts, never mid-playback.
+    void setLoudnessCompensationEnabled(bool shouldCompensate);
+    bool isLoudnessCompensationEnabled() const;
 
-    bool isCurrentlyPlaying() const;
+    // Room reverb applied after the voice; off until enabled
+    ReverbStage& getReverb();
 
     juce::String getModeName(ModeType mode) const;
+    std::vector<float> getScaleFrequencies(ModeType mode, float rootFrequency) const;  // Degrees 1 to 8
     std::vector<ModeType> getAllModes() const;
 
 private:
     double currentSampleRate;
     double currentAngle;
     double angleDelta;
-    bool isPlaying;
+    std::atomic<bool> isPlaying { false };  // Written by the audio thread
 
     int currentNoteIndex;
-    float noteDuration;
+    std::atomic<float> noteDuration { 0.5f };
     int samplesSinceNoteStart;
 
     ModeType currentMode;
-    PlaybackPattern currentPattern;
+    std::atomic<PlaybackPattern> currentPattern { PlaybackPattern::Ascending };
     std::vector<float> currentScale;
     std::vector<int> playbackOrder;  // Indices for the order to play notes
+    std::vector<int> currentMidiNotes;  // MIDI note number for each entry of currentScale
+    std::vector<float> currentNoteGains;  // Loudness compensation for each entry of currentScale
     std::map<ModeType, std::vector<int>> modes;
     std::map<ModeType, juce::String> modeNames;
-    std::map<PlaybackPattern, juce::String> patternNames;
-    juce::Random random;
+    std::vector<PatternLanguage::Definition> patternDefinitions;  // Indexed by PlaybackPattern
+    std::map<std::pair<ModeType, PlaybackPattern>, PatternLanguage::NoteProgram> programs;
+    mutable juce::Random random;  // Advanced by preparePlayback()
+    mutable juce::SpinLock randomLock;
+    
+    // Play and stop commands, queued by any thread and applied by the audio
+    // thread at the start of each block. Senders take commandWriteLock between
+    // themselves; the audio thread only reads, without locking.
+    struct Command
+    {
+        enum class Type
+        {
+            play,
+            stop
+        };
+        
+        Type type = Type::stop;
+        juce::uint32 playId = 0;
+        ModeType mode = ModeType::Ionian;
+        PlaybackPattern pattern = PlaybackPattern::Ascending;
+        int numScaleNotes = 0;
+        int numOrderNotes = 0;
+        std::array<float, PatternLanguage::kMaxNotes> scale;
+        std::array<int, PatternLanguage::kMaxNotes> midiNotes;
+        std::array<int, PatternLanguage::kMaxNotes> order;
+    };
+    static constexpr int kCommandQueueSize = 32;
+    juce::AbstractFifo commandFifo { kCommandQueueSize };
+    std::vector<Command> commands;
+    juce::SpinLock commandWriteLock;
+    std::atomic<int> numQueuedPlays { 0 };
+    std::atomic<int> numNotesInPlayback { 0 };
+    std::atomic<juce::uint32> lastPlayId { 0 };
+    std::atomic<juce::uint32> finishedPlayId { 0 };  // Set by the audio thread when a playback ends
+    juce::uint32 activePlayId;                        // Audio thread
+    juce::uint32 notifiedPlayId;                      // Whichever thread dispatches notifications
+
+    // The audio thread owns activeGraph. New graphs are handed over through
+    // pendingGraph; the one replaced goes to retiredGraph to be deleted off the
+    // audio thread, and no swap happens until that slot is empty again.
+    std::unique_ptr<DspGraph> activeGraph;
+    std::atomic<DspGraph*> pendingGraph { nullptr };
+    std::atomic<DspGraph*> retiredGraph { nullptr };
+    juce::CriticalSection graphBuildLock;  // Between rebuilds and prepareToPlay, never the audio thread
+    Timbre timbre;
+    bool envelopeEnabled = true;
+    int maximumBlockSize;
+
+    ReverbStage reverbStage;
+    EqualLoudness equalLoudness;
+    PeakLimiter peakLimiter;
+    std::atomic<bool> loudnessCompensationEnabled { false };
+    bool limiterActive;       // Audio thread only; follows the setting when a playback starts
+    bool limiterSwitchingOff; // Audio thread only; off once the look-ahead holds only silence
+    std::atomic<bool> degreePanningEnabled { false };
+    float lowestFrequency;   // Range of currentScale, for panning by pitch
+    float highestFrequency;
+
+    std::atomic<bool> midiMirroringEnabled { false };
+    std::atomic<bool> midiNoteOffPending { false };
+    juce::MidiBuffer midiOutput;
+    int soundingMidiNote;  // -1 when no mirrored note is sounding
 
+    void addPattern(const juce::String& name, const juce::String& source);
+    void compilePrograms(PlaybackPattern pattern);
+    template <typename FillCommand>
+    bool sendCommand(FillCommand&& fill);
+    void applyCommands();
+    void applyCommand(const Command& command);
     void playNextNote();
-    float calculateEnvelope();
+    void renderChunk(const juce::AudioSourceChannelInfo& chunk, int midiOffset);
+    float getPanPosition() const;
+    std::unique_ptr<DspGraph> createGraph(Timbre graphTimbre);
+    void rebuildGraph();
+    void collectRetiredGraph();
+    void timerCallback() override;
 };
@@ -0,0 +1,34 @@
+#include "AudioTap.h"
+
+AudioTap::AudioTap(int capacity)
+    : fifo(capacity)
+    , buffer(static_cast<size_t>(capacity), 0.0f)
+{
+}
+
+void AudioTap::push(const float* samples, int numSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        std::copy(samples, samples + size1, buffer.data() + start1);
+    if (size2 > 0)
+        std::copy(samples + size1, samples + size1 + size2, buffer.data() + start2);
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+int AudioTap::pull(float* destination, int maxSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        std::copy(buffer.data() + start1, buffer.data() + start1 + size1, destination);
+    if (size2 > 0)
+        std::copy(buffer.data() + start2, buffer.data() + start2 + size2, destination + size1);
+
+    fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
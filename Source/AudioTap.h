@@ -0,0 +1,31 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <vector>
+
+// Single-producer, single-consumer ring of samples for getting audio out of
+// the audio callback. push() is wait-free and only copies; if the reader falls
+// behind, the newest samples are dropped rather than blocking.
+class AudioTap
+{
+public:
+    explicit AudioTap(int capacity = 1 << 15);
+
+    /** Audio thread only */
+    void push(const float* samples, int numSamples);
+
+    /**
+     * Reader thread only
+     * @return Number of samples copied into destination, up to maxSamples
+     */
+    int pull(float* destination, int maxSamples);
+
+    void setSampleRate(double sampleRate) { currentSampleRate = sampleRate; }
+    double getSampleRate() const { return currentSampleRate; }
+
+private:
+    juce::AbstractFifo fifo;
+    std::vector<float> buffer;
+    std::atomic<double> currentSampleRate { 44100.0 };
+};
@@ -0,0 +1,295 @@
+#include "BufferSizeTuner.h"
+#include <algorithm>
+
+BufferSizeTuner::BufferSizeTuner(juce::AudioDeviceManager& deviceManager)
+    : deviceManager(deviceManager)
+    , enabled(false)
+    , phase(Phase::idle)
+    , tunedSampleRate(0.0)
+    , candidateIndex(0)
+    , bestSize(0)
+    , startingXRuns(-1)
+{
+}
+
+BufferSizeTuner::~BufferSizeTuner()
+{
+    shutdown();
+}
+
+// MARK: - (Control)
+
+void BufferSizeTuner::setEnabled(bool shouldTune)
+{
+    if (shouldTune == enabled)
+        return;
+
+    enabled = shouldTune;
+    if (enabled)
+    {
+        if (loadEngine == nullptr)
+            createLoadEngine();
+        deviceManager.addChangeListener(this);
+        tunedDeviceName = {};
+        start();
+    }
+    else
+    {
+        deviceManager.removeChangeListener(this);
+        if (phase != Phase::idle)
+            finish();
+    }
+}
+
+bool BufferSizeTuner::isEnabled() const
+{
+    return enabled;
+}
+
+bool BufferSizeTuner::isTuning() const
+{
+    return phase != Phase::idle;
+}
+
+void BufferSizeTuner::shutdown()
+{
+    enabled = false;
+    deviceManager.removeChangeListener(this);
+    stopTimer();
+    if (phase != Phase::idle)
+    {
+        phase = Phase::idle;
+        deviceManager.removeAudioCallback(this);
+    }
+}
+
+void BufferSizeTuner::changeListenerCallback(juce::ChangeBroadcaster*)
+{
+    // Changes made while tuning are the tuner's own
+    if (!enabled || phase != Phase::idle)
+        return;
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device != nullptr && (device->getName() != tunedDeviceName || device->getCurrentSampleRate() != tunedSampleRate))
+        start();
+}
+
+// MARK: - (Tuning)
+
+void BufferSizeTuner::createLoadEngine()
+{
+    // The heaviest sound the app can make: every note restarts the Warm voice's
+    // filter and envelope, and the full reverb tail is convolved across every channel
+    loadEngine = std::make_unique<AudioEngine>();
+    loadEngine->setTimbre(AudioEngine::Timbre::Warm);
+    loadEngine->setDegreePanningEnabled(true);
+    loadEngine->getReverb().setTailLimited(false);
+    loadEngine->getReverb().setEnabled(true);
+    loadEngine->setPlaybackSpeed(3.0f);
+    loadPlayback = loadEngine->preparePlayback(AudioEngine::ModeType::Locrian, 440.0f, AudioEngine::PlaybackPattern::Random);
+}
+
+void BufferSizeTuner::start()
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr || phase != Phase::idle)
+        return;
+
+    tunedDeviceName = device->getName();
+    tunedSampleRate = device->getCurrentSampleRate();
+
+    // Down from the current size, which is the device's default until tuned
+    int startingSize = device->getCurrentBufferSizeSamples();
+    candidateSizes.clear();
+    for (int size : device->getAvailableBufferSizes())
+        if (size <= startingSize)
+            candidateSizes.add(size);
+    if (!candidateSizes.contains(startingSize))
+        candidateSizes.add(startingSize);
+    candidateSizes.sort();
+    std::reverse(candidateSizes.begin(), candidateSizes.end());
+
+    candidateIndex = 0;
+    bestSize = 0;
+    bestMeasurement = {};
+
+    juce::Logger::writeToLog("Tuning the buffer size of " + tunedDeviceName + " at " + juce::String(tunedSampleRate, 0)
+                             + " Hz, down from " + juce::String(startingSize) + " samples");
+
+    phase = Phase::settling;
+    deviceManager.addAudioCallback(this);
+    tryCandidate();
+}
+
+void BufferSizeTuner::tryCandidate()
+{
+    if (candidateIndex >= candidateSizes.size() || !setBufferSize(candidateSizes[candidateIndex]))
+    {
+        finish();
+        return;
+    }
+
+    phase = Phase::settling;
+    startTimer(kSettleMilliseconds);
+}
+
+void BufferSizeTuner::timerCallback()
+{
+    loadEngine->dispatchPendingNotifications();  // Frees the graphs the load engine replaced
+
+    if (deviceManager.getCurrentAudioDevice() == nullptr)
+    {
+        // Closed or unplugged under us; tune again when one opens
+        tunedDeviceName = {};
+        finish();
+        return;
+    }
+
+    if (phase == Phase::settling)
+    {
+        startingXRuns = getXRunCount();
+        resetRequested = true;
+        phase = Phase::measuring;
+        startTimer(kMeasureMilliseconds);
+    }
+    else if (phase == Phase::measuring)
+    {
+        measurementFinished();
+    }
+}
+
+void BufferSizeTuner::measurementFinished()
+{
+    Measurement measurement;
+    measurement.worstLoad = worstLoad.load();
+    measurement.lateCallbacks = lateCallbacks.load();
+    measurement.numCallbacks = numCallbacks.load();
+    int xruns = getXRunCount();
+    measurement.underruns = (startingXRuns >= 0 && xruns >= 0) ? xruns - startingXRuns : 0;
+
+    bool stable = measurement.numCallbacks > 0
+               && measurement.lateCallbacks == 0
+               && measurement.underruns == 0
+               && measurement.worstLoad <= kMaximumLoad;
+
+    int size = candidateSizes[candidateIndex];
+    juce::Logger::writeToLog("  " + juce::String(size) + " samples: worst load "
+                             + juce::String(juce::roundToInt(measurement.worstLoad * 100.0)) + "%, "
+                             + juce::String(measurement.underruns) + " underruns, "
+                             + juce::String(measurement.lateCallbacks) + " late callbacks in "
+                             + juce::String(measurement.numCallbacks) + (stable ? "" : " - unstable"));
+
+    // Smaller sizes only get tighter, so the first failure ends the search
+    if (!stable)
+    {
+        finish();
+        return;
+    }
+
+    bestSize = size;
+    bestMeasurement = measurement;
+    candidateIndex++;
+    tryCandidate();
+}
+
+void BufferSizeTuner::finish()
+{
+    stopTimer();
+    phase = Phase::idle;
+    deviceManager.removeAudioCallback(this);
+    loadEngine->stopPlaying();
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    if (device == nullptr)
+        return;
+
+    // The starting size stays if nothing smaller passed (or even it didn't)
+    int chosenSize = bestSize > 0 ? bestSize : candidateSizes[0];
+    if (device->getCurrentBufferSizeSamples() != chosenSize)
+        setBufferSize(chosenSize);
+
+    chosenSize = device->getCurrentBufferSizeSamples();
+    juce::Logger::writeToLog("Buffer size for " + tunedDeviceName + " at " + juce::String(tunedSampleRate, 0) + " Hz: "
+                             + juce::String(chosenSize) + " samples ("
+                             + juce::String(1000.0 * chosenSize / tunedSampleRate, 1) + " ms)"
+                             + (bestSize > 0 ? ", worst load " + juce::String(juce::roundToInt(bestMeasurement.worstLoad * 100.0)) + "%"
+                                             : juce::String(", no size was stable under load")));
+
+    if (onTuned)
+        onTuned(chosenSize);
+}
+
+bool BufferSizeTuner::setBufferSize(int bufferSize)
+{
+    auto setup = deviceManager.getAudioDeviceSetup();
+    setup.bufferSize = bufferSize;
+    auto error = deviceManager.setAudioDeviceSetup(setup, true);
+    if (error.isNotEmpty())
+    {
+        juce::Logger::writeToLog("  " + juce::String(bufferSize) + " samples: " + error);
+        return false;
+    }
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    return device != nullptr && device->getCurrentBufferSizeSamples() == bufferSize;
+}
+
+int BufferSizeTuner::getXRunCount() const
+{
+    auto* device = deviceManager.getCurrentAudioDevice();
+    return device != nullptr ? device->getXRunCount() : -1;  // -1 where the device doesn't count them
+}
+
+// MARK: - (AudioIODeviceCallback)
+
+void BufferSizeTuner::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    int bufferSize = device->getCurrentBufferSizeSamples();
+    double sampleRate = device->getCurrentSampleRate();
+    int numChannels = juce::jmax(1, device->getActiveOutputChannels().countNumberOfSetBits());
+
+    loadEngine->prepareToPlay(bufferSize, sampleRate);
+    loadBuffer.setSize(numChannels, bufferSize);
+    loadSampleRate = sampleRate;
+    callbackPeriodSeconds = bufferSize / sampleRate;
+    resetRequested = true;
+}
+
+void BufferSizeTuner::audioDeviceStopped()
+{
+}
+
+void BufferSizeTuner::audioDeviceIOCallbackWithContext(const float* const*, int,
+                                                       float* const* outputChannelData, int numOutputChannels,
+                                                       int numSamples, const juce::AudioIODeviceCallbackContext&)
+{
+    double callbackStart = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+    if (resetRequested.exchange(false))
+    {
+        worstLoad = 0.0;
+        lateCallbacks = 0;
+        numCallbacks = 0;
+        lastCallbackStart = 0.0;
+    }
+
+    // A gap this long means the device ran dry, whether or not it counts underruns
+    if (lastCallbackStart > 0.0 && callbackStart - lastCallbackStart > kLateCallbackFactor * callbackPeriodSeconds)
+        lateCallbacks.store(lateCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    lastCallbackStart = callbackStart;
+
+    if (!loadEngine->isCurrentlyPlaying())
+        loadEngine->play(loadPlayback);
+    int numLoadSamples = juce::jmin(numSamples, loadBuffer.getNumSamples());
+    loadEngine->getNextAudioBlock(juce::AudioSourceChannelInfo(&loadBuffer, 0, numLoadSamples));
+
+    // The load is thrown away; the app's own callback supplies what's heard
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+        if (outputChannelData[channel] != nullptr)
+            juce::FloatVectorOperations::clear(outputChannelData[channel], numSamples);
+
+    double load = (juce::Time::getMillisecondCounterHiRes() * 0.001 - callbackStart) / (numSamples / loadSampleRate);
+    if (load > worstLoad.load(std::memory_order_relaxed))
+        worstLoad.store(load, std::memory_order_relaxed);
+    numCallbacks.store(numCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include "AudioEngine.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Finds the smallest device buffer size that plays reliably, for the lowest
+// latency between a click and the sound. Starting from the device's current
+// size, each smaller size the device offers is tried for a couple of seconds
+// while a second engine renders the heaviest sound the app can make (Warm,
+// full reverb tail, panning, fastest speed) alongside the real one. A size
+// passes if there are no underruns or late callbacks and that load stays
+// within kMaximumLoad of the buffer's duration, leaving the rest as a margin
+// for the real engine and the rest of the system. The smallest passing size
+// is kept.
+//
+// Once enabled, it tunes again whenever the device or sample rate changes.
+// Everything runs on the message thread, a step per timer callback. The load
+// engine is only built the first time tuning is enabled.
+class BufferSizeTuner : private juce::Timer,
+                        private juce::ChangeListener,
+                        private juce::AudioIODeviceCallback
+{
+public:
+    static constexpr int kSettleMilliseconds = 300;    // Ignored after each change, while the device restarts
+    static constexpr int kMeasureMilliseconds = 2000;  // Measured at each size
+    static constexpr double kMaximumLoad = 0.5;        // Of the buffer's duration, for the load engine
+    static constexpr double kLateCallbackFactor = 2.0; // A gap this many buffers long counts as an underrun
+
+    explicit BufferSizeTuner(juce::AudioDeviceManager& deviceManager);
+    ~BufferSizeTuner() override;
+
+    /** Tune now if a device is open, and again whenever the device or sample rate changes */
+    void setEnabled(bool shouldTune);
+    bool isEnabled() const;
+
+    bool isTuning() const;
+
+    /** Stop tuning, leaving the best size found so far; call before shutting the device manager down */
+    void shutdown();
+
+    // Called on the message thread with the chosen size once tuning finishes
+    std::function<void(int bufferSize)> onTuned;
+
+private:
+    struct Measurement
+    {
+        double worstLoad = 0.0;  // Of the buffer's duration
+        int lateCallbacks = 0;
+        int underruns = 0;       // Reported by the device, where it counts them
+        int numCallbacks = 0;
+    };
+
+    enum class Phase
+    {
+        idle,
+        settling,
+        measuring
+    };
+
+    juce::AudioDeviceManager& deviceManager;
+    bool enabled;
+    Phase phase;
+
+    juce::String tunedDeviceName;  // What the current size was tuned for
+    double tunedSampleRate;
+
+    juce::Array<int> candidateSizes;  // Largest first
+    int candidateIndex;
+    int bestSize;                     // Smallest size that passed, or 0
+    Measurement bestMeasurement;
+    int startingXRuns;
+
+    // The load, rendered in the tuner's own device callback and thrown away
+    std::unique_ptr<AudioEngine> loadEngine;  // Null until first enabled
+    AudioEngine::PreparedPlayback loadPlayback;
+    juce::AudioBuffer<float> loadBuffer;
+
+    // Written by the audio thread only; the message thread asks for a reset
+    std::atomic<bool> resetRequested { false };
+    std::atomic<double> worstLoad { 0.0 };
+    std::atomic<int> lateCallbacks { 0 };
+    std::atomic<int> numCallbacks { 0 };
+    double loadSampleRate = 44100.0;
+    double callbackPeriodSeconds = 0.0;
+    double lastCallbackStart = 0.0;
+
+    void createLoadEngine();
+    void start();
+    void tryCandidate();
+    void measurementFinished();
+    void finish();
+    bool setBufferSize(int bufferSize);
+    int getXRunCount() const;
+
+    void timerCallback() override;
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels,
+                                          int numSamples, const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BufferSizeTuner)
+};
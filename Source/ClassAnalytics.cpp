@@ -0,0 +1,515 @@
+#include "ClassAnalytics.h"
+#include "AudioEngine.h"
+#include "Session.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    constexpr juce::int64 kMillisecondsPerDay = 24 * 60 * 60 * 1000;
+
+    // 32 bits, as a dictionary fed by a whole school's sessions can outgrow 16
+    juce::uint32 indexOf(juce::StringArray& names, const juce::String& name)
+    {
+        int index = names.indexOf(name);
+        if (index < 0)
+        {
+            index = names.size();
+            names.add(name);
+        }
+        return static_cast<juce::uint32>(index);
+    }
+
+    // Weeks start on Monday; 1970-01-01 was a Thursday
+    juce::int64 getWeekStartDay(juce::int64 millisecondsSinceEpoch)
+    {
+        auto day = millisecondsSinceEpoch / kMillisecondsPerDay - (millisecondsSinceEpoch % kMillisecondsPerDay < 0 ? 1 : 0);
+        return day - ((day + 3) % 7 + 7) % 7;
+    }
+
+    juce::String getWeekName(juce::int64 weekStartDay)
+    {
+        // Midday, so the date is the same in any time zone
+        return juce::Time(weekStartDay * kMillisecondsPerDay + kMillisecondsPerDay / 2).formatted("%Y-%m-%d");
+    }
+
+    int getRootNoteIndex(double frequency)
+    {
+        // Semitones above A3 = 220 Hz, as QuizSession counts them
+        int noteIndex = frequency > 0.0 ? juce::roundToInt(12.0 * std::log2(frequency / 220.0)) : 0;
+        return juce::jlimit(0, ClassAnalytics::kMaxRootNoteIndex, noteIndex);
+    }
+
+    juce::String getRootNoteName(int noteIndex)
+    {
+        const char* noteNames[] = { "A", "A#", "B", "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#" };
+        return juce::String(noteNames[noteIndex % 12]) + juce::String(3 + (noteIndex + 9) / 12);
+    }
+
+    // Run body(threadIndex, begin, end) over equal slices of [0, numItems) on numThreads threads
+    template <typename Body>
+    void forEachSlice(size_t numItems, int numThreads, Body&& body)
+    {
+        auto numSlices = static_cast<size_t>(juce::jmax(1, numThreads));
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < numSlices; ++t)
+        {
+            auto begin = numItems * t / numSlices;
+            auto end = numItems * (t + 1) / numSlices;
+            threads.emplace_back([&body, t, begin, end] { body(static_cast<int>(t), begin, end); });
+        }
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    juce::String formatAccuracy(const ClassAnalytics::Tally& tally)
+    {
+        return juce::String(tally.getAccuracy(), 4);
+    }
+
+    // Indices of the names in sorted order, which for weeks is date order. Files are
+    // loaded in parallel, so the order names were first seen in varies between runs.
+    std::vector<int> getSortedOrder(const juce::StringArray& names)
+    {
+        std::vector<int> order(static_cast<size_t>(names.size()));
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = static_cast<int>(i);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return names[a].compareNatural(names[b]) < 0; });
+        return order;
+    }
+
+    juce::var tallyToVar(const juce::String& key, const juce::var& value, const ClassAnalytics::Tally& tally)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty(key, value);
+        object->setProperty("answers", tally.numAnswers);
+        object->setProperty("correct", tally.numCorrect);
+        object->setProperty("accuracy", tally.getAccuracy());
+        return juce::var(object);
+    }
+}
+
+// MARK: - (Columns)
+
+size_t ClassAnalytics::Answers::size() const
+{
+    return actual.size();
+}
+
+void ClassAnalytics::Answers::add(int actualMode, int guessedMode, int rootNoteIndex, const juce::String& patternName,
+                                  const juce::String& weekName, const juce::String& studentName)
+{
+    actual.push_back(static_cast<juce::uint8>(actualMode));
+    guess.push_back(static_cast<juce::uint8>(guessedMode));
+    root.push_back(static_cast<juce::uint8>(juce::jlimit(0, kMaxRootNoteIndex, rootNoteIndex)));
+    pattern.push_back(indexOf(patternNames, patternName));
+    week.push_back(indexOf(weekNames, weekName));
+    student.push_back(indexOf(studentNames, studentName));
+}
+
+void ClassAnalytics::Answers::append(const Answers& other)
+{
+    auto translate = [](juce::StringArray& names, const juce::StringArray& otherNames)
+    {
+        std::vector<juce::uint32> translation;
+        for (auto& name : otherNames)
+            translation.push_back(indexOf(names, name));
+        return translation;
+    };
+    auto patternTranslation = translate(patternNames, other.patternNames);
+    auto weekTranslation = translate(weekNames, other.weekNames);
+    auto studentTranslation = translate(studentNames, other.studentNames);
+
+    actual.insert(actual.end(), other.actual.begin(), other.actual.end());
+    guess.insert(guess.end(), other.guess.begin(), other.guess.end());
+    root.insert(root.end(), other.root.begin(), other.root.end());
+
+    auto appendTranslated = [](std::vector<juce::uint32>& column, const std::vector<juce::uint32>& otherColumn,
+                               const std::vector<juce::uint32>& translation)
+    {
+        column.reserve(column.size() + otherColumn.size());
+        for (auto index : otherColumn)
+            column.push_back(translation[index]);
+    };
+    appendTranslated(pattern, other.pattern, patternTranslation);
+    appendTranslated(week, other.week, weekTranslation);
+    appendTranslated(student, other.student, studentTranslation);
+}
+
+double ClassAnalytics::Tally::getAccuracy() const
+{
+    return numAnswers > 0 ? static_cast<double>(numCorrect) / static_cast<double>(numAnswers) : 0.0;
+}
+
+void ClassAnalytics::Tally::add(const Tally& other)
+{
+    numAnswers += other.numAnswers;
+    numCorrect += other.numCorrect;
+}
+
+juce::StringArray ClassAnalytics::getModeNames()
+{
+    static const juce::StringArray names = []
+    {
+        AudioEngine engine;
+        juce::StringArray modeNames;
+        for (auto mode : engine.getAllModes())
+            modeNames.add(engine.getModeName(mode));
+        return modeNames;
+    }();
+    return names;
+}
+
+// MARK: - (Loading)
+
+ClassAnalytics::Answers ClassAnalytics::load(const juce::Array<juce::File>& files, const juce::File& directory,
+                                             int numThreads, juce::StringArray& errors)
+{
+    auto modeNames = getModeNames();
+    std::atomic<int> nextFile { 0 };
+    std::mutex resultLock;
+    Answers result;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < juce::jmax(1, numThreads); ++t)
+    {
+        threads.emplace_back([&]
+        {
+            Answers answers;
+            juce::StringArray threadErrors;
+
+            for (int index = nextFile++; index < files.size(); index = nextFile++)
+            {
+                auto& file = files.getReference(index);
+                Session session;
+                juce::String error;
+                if (!Session::load(file, session, error))
+                {
+                    threadErrors.add(file.getRelativePathFrom(directory) + ": " + error);
+                    continue;
+                }
+
+                auto path = juce::StringArray::fromTokens(file.getRelativePathFrom(directory), "/\\", "");
+                auto studentName = path.size() > 1 ? path[0] : juce::String("(unsorted)");
+
+                auto startTime = session.started.toMilliseconds();
+                juce::int64 cachedWeekStart = std::numeric_limits<juce::int64>::min();
+                juce::String weekName;
+
+                for (auto& event : session.events)
+                {
+                    if (event.action != "guess")
+                        continue;
+
+                    int actualMode = modeNames.indexOf(event.properties["actual"].toString());
+                    int guessedMode = modeNames.indexOf(event.properties["guess"].toString());
+                    if (actualMode < 0 || guessedMode < 0)
+                        continue;
+
+                    auto time = startTime + static_cast<juce::int64>(static_cast<double>(event.samplePosition) * 1000.0 / session.sampleRate);
+                    auto weekStart = getWeekStartDay(time);
+                    if (weekStart != cachedWeekStart)
+                    {
+                        cachedWeekStart = weekStart;
+                        weekName = getWeekName(weekStart);
+                    }
+
+                    answers.add(actualMode, guessedMode, getRootNoteIndex(event.properties["root"]),
+                                event.properties["pattern"].toString(), weekName, studentName);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(resultLock);
+            result.append(answers);
+            errors.addArray(threadErrors);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    return result;
+}
+
+ClassAnalytics::Answers ClassAnalytics::synthesize(juce::int64 numAnswers, juce::int64 seed, int numThreads)
+{
+    constexpr int kNumStudents = 30;
+    constexpr int kNumWeeks = 12;
+
+    Answers answers;
+    AudioEngine engine;
+    for (auto pattern : engine.getAllPatterns())
+        answers.patternNames.add(engine.getPatternName(pattern));
+    auto thisWeek = getWeekStartDay(juce::Time::currentTimeMillis());
+    for (int week = kNumWeeks - 1; week >= 0; --week)
+        answers.weekNames.add(getWeekName(thisWeek - 7 * week));
+    for (int student = 1; student <= kNumStudents; ++student)
+        answers.studentNames.add("Student " + juce::String(student));
+
+    auto size = static_cast<size_t>(juce::jmax<juce::int64>(0, numAnswers));
+    answers.actual.resize(size);
+    answers.guess.resize(size);
+    answers.root.resize(size);
+    answers.pattern.resize(size);
+    answers.week.resize(size);
+    answers.student.resize(size);
+
+    int numModes = getModeNames().size();
+    int numPatterns = answers.patternNames.size();
+
+    // Later weeks and simpler patterns are answered better, so the tables have something to show
+    forEachSlice(size, numThreads, [&](int thread, size_t begin, size_t end)
+    {
+        juce::Random random(seed + thread);
+        for (auto i = begin; i < end; ++i)
+        {
+            int actual = random.nextInt(numModes);
+            int pattern = random.nextInt(numPatterns);
+            int week = random.nextInt(kNumWeeks);
+            double accuracy = 0.45 + 0.03 * week - 0.04 * pattern;
+            int guess = actual;
+            if (random.nextDouble() >= accuracy)
+                guess = (actual + 1 + random.nextInt(numModes - 1)) % numModes;
+
+            answers.actual[i] = static_cast<juce::uint8>(actual);
+            answers.guess[i] = static_cast<juce::uint8>(guess);
+            answers.root[i] = static_cast<juce::uint8>(12 + random.nextInt(13));
+            answers.pattern[i] = static_cast<juce::uint32>(pattern);
+            answers.week[i] = static_cast<juce::uint32>(week);
+            answers.student[i] = static_cast<juce::uint32>(random.nextInt(kNumStudents));
+        }
+    });
+
+    return answers;
+}
+
+// MARK: - (Aggregation)
+
+ClassAnalytics::Tables ClassAnalytics::aggregate(const Answers& answers, int numThreads)
+{
+    auto emptyTables = [&answers]
+    {
+        Tables tables;
+        tables.numModes = getModeNames().size();
+        tables.confusion.assign(static_cast<size_t>(tables.numModes * tables.numModes), 0);
+        tables.byRoot.resize(kMaxRootNoteIndex + 1);
+        tables.byPattern.resize(static_cast<size_t>(answers.patternNames.size()));
+        tables.byWeek.resize(static_cast<size_t>(answers.weekNames.size()));
+        tables.byStudent.resize(static_cast<size_t>(answers.studentNames.size()));
+        return tables;
+    };
+
+    std::vector<Tables> partials(static_cast<size_t>(juce::jmax(1, numThreads)));
+    for (auto& partial : partials)
+        partial = emptyTables();
+
+    // Each thread counts its own slice into its own tables; nothing is shared until they're summed
+    forEachSlice(answers.size(), numThreads, [&](int thread, size_t begin, size_t end)
+    {
+        auto& tables = partials[static_cast<size_t>(thread)];
+        auto numModes = static_cast<size_t>(tables.numModes);
+        auto* actual = answers.actual.data();
+        auto* guess = answers.guess.data();
+        auto* root = answers.root.data();
+        auto* pattern = answers.pattern.data();
+        auto* week = answers.week.data();
+        auto* student = answers.student.data();
+
+        for (auto i = begin; i < end; ++i)
+        {
+            tables.confusion[actual[i] * numModes + guess[i]]++;
+
+            juce::int64 correct = actual[i] == guess[i] ? 1 : 0;
+            tables.byRoot[root[i]].numAnswers++;
+            tables.byRoot[root[i]].numCorrect += correct;
+            tables.byPattern[pattern[i]].numAnswers++;
+            tables.byPattern[pattern[i]].numCorrect += correct;
+            tables.byWeek[week[i]].numAnswers++;
+            tables.byWeek[week[i]].numCorrect += correct;
+            tables.byStudent[student[i]].numAnswers++;
+            tables.byStudent[student[i]].numCorrect += correct;
+        }
+    });
+
+    auto tables = emptyTables();
+    for (auto& partial : partials)
+    {
+        for (size_t i = 0; i < tables.confusion.size(); ++i)
+            tables.confusion[i] += partial.confusion[i];
+
+        auto addAll = [](std::vector<Tally>& sums, const std::vector<Tally>& tallies)
+        {
+            for (size_t i = 0; i < sums.size(); ++i)
+                sums[i].add(tallies[i]);
+        };
+        addAll(tables.byRoot, partial.byRoot);
+        addAll(tables.byPattern, partial.byPattern);
+        addAll(tables.byWeek, partial.byWeek);
+        addAll(tables.byStudent, partial.byStudent);
+    }
+
+    for (auto& tally : tables.byPattern)
+        tables.total.add(tally);
+    return tables;
+}
+
+// MARK: - (Export)
+
+bool ClassAnalytics::writeCsv(const Answers& answers, const Tables& tables, const juce::File& directory)
+{
+    if (!directory.createDirectory())
+        return false;
+
+    auto modeNames = getModeNames();
+    juce::String confusion = "actual \\ guess";
+    for (auto& name : modeNames)
+        confusion << "," << name;
+    confusion << "\n";
+    for (int actual = 0; actual < tables.numModes; ++actual)
+    {
+        confusion << modeNames[actual];
+        for (int guess = 0; guess < tables.numModes; ++guess)
+            confusion << "," << tables.confusion[static_cast<size_t>(actual * tables.numModes + guess)];
+        confusion << "\n";
+    }
+
+    juce::String byRoot = "root,frequency,answers,correct,accuracy\n";
+    for (int root = 0; root <= kMaxRootNoteIndex; ++root)
+    {
+        auto& tally = tables.byRoot[static_cast<size_t>(root)];
+        if (tally.numAnswers > 0)
+            byRoot << getRootNoteName(root) << "," << juce::String(220.0 * std::pow(2.0, root / 12.0), 2) << ","
+                   << tally.numAnswers << "," << tally.numCorrect << "," << formatAccuracy(tally) << "\n";
+    }
+
+    // Names are quoted, as patterns and students may contain commas
+    auto writeTallies = [](const juce::String& heading, const juce::StringArray& names,
+                           const std::vector<Tally>& tallies, const std::vector<int>& order)
+    {
+        juce::String csv = heading + ",answers,correct,accuracy\n";
+        for (int index : order)
+        {
+            auto& tally = tallies[static_cast<size_t>(index)];
+            csv << names[index].quoted() << "," << tally.numAnswers << "," << tally.numCorrect << "," << formatAccuracy(tally) << "\n";
+        }
+        return csv;
+    };
+
+    return directory.getChildFile("confusion.csv").replaceWithText(confusion)
+        && directory.getChildFile("accuracy_by_root.csv").replaceWithText(byRoot)
+        && directory.getChildFile("accuracy_by_pattern.csv").replaceWithText(
+               writeTallies("pattern", answers.patternNames, tables.byPattern, getSortedOrder(answers.patternNames)))
+        && directory.getChildFile("accuracy_by_week.csv").replaceWithText(
+               writeTallies("week", answers.weekNames, tables.byWeek, getSortedOrder(answers.weekNames)))
+        && directory.getChildFile("accuracy_by_student.csv").replaceWithText(
+               writeTallies("student", answers.studentNames, tables.byStudent, getSortedOrder(answers.studentNames)));
+}
+
+bool ClassAnalytics::writeJson(const Answers& answers, const Tables& tables, const juce::File& file)
+{
+    auto modeNames = getModeNames();
+
+    juce::Array<juce::var> modes, confusion, byRoot, byPattern, byWeek, byStudent;
+    for (int actual = 0; actual < tables.numModes; ++actual)
+    {
+        modes.add(modeNames[actual]);
+        juce::Array<juce::var> row;
+        for (int guess = 0; guess < tables.numModes; ++guess)
+            row.add(tables.confusion[static_cast<size_t>(actual * tables.numModes + guess)]);
+        confusion.add(row);
+    }
+
+    for (int root = 0; root <= kMaxRootNoteIndex; ++root)
+        if (tables.byRoot[static_cast<size_t>(root)].numAnswers > 0)
+            byRoot.add(tallyToVar("root", getRootNoteName(root), tables.byRoot[static_cast<size_t>(root)]));
+    for (int i : getSortedOrder(answers.patternNames))
+        byPattern.add(tallyToVar("pattern", answers.patternNames[i], tables.byPattern[static_cast<size_t>(i)]));
+    for (int i : getSortedOrder(answers.weekNames))
+        byWeek.add(tallyToVar("week", answers.weekNames[i], tables.byWeek[static_cast<size_t>(i)]));
+    for (int i : getSortedOrder(answers.studentNames))
+        byStudent.add(tallyToVar("student", answers.studentNames[i], tables.byStudent[static_cast<size_t>(i)]));
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("answers", tables.total.numAnswers);
+    root->setProperty("correct", tables.total.numCorrect);
+    root->setProperty("accuracy", tables.total.getAccuracy());
+    root->setProperty("modes", modes);
+    root->setProperty("confusion", confusion);  // [actual][guess]
+    root->setProperty("byRoot", byRoot);
+    root->setProperty("byPattern", byPattern);
+    root->setProperty("byWeek", byWeek);
+    root->setProperty("byStudent", byStudent);
+
+    file.getParentDirectory().createDirectory();
+    return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
+
+void ClassAnalytics::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    settings.directory = args.getExistingFolderForOption("--analytics");
+    settings.outputDirectory = args.containsOption("--out") ? args.getFileForOption("--out")
+                                                            : settings.directory.getChildFile("Analytics");
+    if (args.containsOption("--threads"))
+        settings.numThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+    if (args.containsOption("--synthetic"))
+        settings.numSyntheticAnswers = juce::jmax<juce::int64>(0, args.getValueForOption("--synthetic").getLargeIntValue());
+    if (args.containsOption("--seed"))
+        settings.seed = args.getValueForOption("--seed").getLargeIntValue();
+
+    // Skip what an earlier run exported
+    juce::Array<juce::File> files;
+    for (auto& file : settings.directory.findChildFiles(juce::File::findFiles, true, "*.json"))
+        if (!file.isAChildOf(settings.outputDirectory))
+            files.add(file);
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    juce::StringArray errors;
+    auto answers = load(files, settings.directory, settings.numThreads, errors);
+    auto loadSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    std::cout << "Read " << answers.size() << " answers from " << files.size() - errors.size() << " sessions of "
+              << answers.studentNames.size() << " students in " << juce::String(loadSeconds, 2) << " s" << std::endl;
+    for (int i = 0; i < juce::jmin(errors.size(), 10); ++i)
+        std::cout << "      skipped " << errors[i] << std::endl;
+    if (errors.size() > 10)
+        std::cout << "      ... and " << errors.size() - 10 << " more" << std::endl;
+
+    if (settings.numSyntheticAnswers > 0)
+    {
+        answers.append(synthesize(settings.numSyntheticAnswers, settings.seed, settings.numThreads));
+        std::cout << "Added " << settings.numSyntheticAnswers << " synthetic answers (seed " << settings.seed << ")" << std::endl;
+    }
+
+    startTime = juce::Time::getMillisecondCounterHiRes();
+    auto tables = aggregate(answers, settings.numThreads);
+    auto aggregateSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    std::cout << "Aggregated " << tables.total.numAnswers << " answers on " << settings.numThreads << " threads in "
+              << juce::String(aggregateSeconds * 1000.0, 1) << " ms; "
+              << juce::String(tables.total.getAccuracy() * 100.0, 1) << "% correct" << std::endl;
+
+    // The most common mistakes, across the whole class
+    struct Confusion { juce::int64 count; int actual; int guess; };
+    std::vector<Confusion> confusions;
+    for (int actual = 0; actual < tables.numModes; ++actual)
+        for (int guess = 0; guess < tables.numModes; ++guess)
+            if (actual != guess)
+                confusions.push_back({ tables.confusion[static_cast<size_t>(actual * tables.numModes + guess)], actual, guess });
+    std::sort(confusions.begin(), confusions.end(), [](const Confusion& a, const Confusion& b) { return a.count > b.count; });
+
+    auto modeNames = getModeNames();
+    for (size_t i = 0; i < confusions.size() && i < 3 && confusions[i].count > 0; ++i)
+        std::cout << "      " << modeNames[confusions[i].actual] << " heard as " << modeNames[confusions[i].guess]
+                  << ": " << confusions[i].count << std::endl;
+
+    if (!writeCsv(answers, tables, settings.outputDirectory)
+        || !writeJson(answers, tables, settings.outputDirectory.getChildFile("analytics.json")))
+        juce::ConsoleApplication::fail("Could not write to " + settings.outputDirectory.getFullPathName(), 1);
+
+    std::cout << "Wrote " << settings.outputDirectory.getFullPathName() << std::endl;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Class-wide statistics over many students' saved sessions (see Session):
+// which modes are confused with which, and how accuracy varies by pattern,
+// root, week and student.
+//
+// Every answer is one row of a set of columns, with text (pattern, week,
+// student) stored as small indices into a dictionary, so aggregating scans a
+// few contiguous bytes per answer. Loading parses files on every core into
+// separate column sets that are then appended; aggregating splits the rows
+// between threads, each counting into its own tables, which are then summed.
+class ClassAnalytics
+{
+public:
+    static constexpr int kMaxRootNoteIndex = 127;  // Semitones above A3; higher roots are counted here
+
+    struct Answers
+    {
+        std::vector<juce::uint8> actual;     // Index into getModeNames()
+        std::vector<juce::uint8> guess;      // Index into getModeNames()
+        std::vector<juce::uint8> root;       // Semitones above A3
+        std::vector<juce::uint32> pattern;   // Index into patternNames
+        std::vector<juce::uint32> week;      // Index into weekNames
+        std::vector<juce::uint32> student;   // Index into studentNames
+
+        juce::StringArray patternNames;
+        juce::StringArray weekNames;         // Date of the Monday starting the week, YYYY-MM-DD
+        juce::StringArray studentNames;
+
+        size_t size() const;
+        void add(int actualMode, int guessedMode, int rootNoteIndex, const juce::String& patternName,
+                 const juce::String& weekName, const juce::String& studentName);
+
+        /** Append another set's rows, translating its dictionary indices into this set's */
+        void append(const Answers& other);
+    };
+
+    struct Tally
+    {
+        juce::int64 numAnswers = 0;
+        juce::int64 numCorrect = 0;
+
+        double getAccuracy() const;
+        void add(const Tally& other);
+    };
+
+    struct Tables
+    {
+        int numModes = 0;
+        std::vector<juce::int64> confusion;  // [actual * numModes + guess]
+        std::vector<Tally> byRoot;           // Indexed by root
+        std::vector<Tally> byPattern;        // Indexed like Answers::patternNames
+        std::vector<Tally> byWeek;           // Indexed like Answers::weekNames
+        std::vector<Tally> byStudent;        // Indexed like Answers::studentNames
+        Tally total;
+    };
+
+    struct Settings
+    {
+        juce::File directory;        // Session files, in a subdirectory per student
+        juce::File outputDirectory;  // CSV files and analytics.json
+        int numThreads = juce::SystemStats::getNumCpus();
+        juce::int64 numSyntheticAnswers = 0;  // Random answers added, for timing large classes
+        juce::int64 seed = juce::Time::currentTimeMillis();
+    };
+
+    /** The modes in the order of the confusion matrix */
+    static juce::StringArray getModeNames();
+
+    /**
+     * Read the guesses from session files on numThreads threads
+     * @param files Session files, each counted for the student named by its first directory below directory
+     * @param errors Receives a message for each file that could not be read
+     */
+    static Answers load(const juce::Array<juce::File>& files, const juce::File& directory, int numThreads, juce::StringArray& errors);
+
+    /** Random answers, spread over a few patterns, weeks and students */
+    static Answers synthesize(juce::int64 numAnswers, juce::int64 seed, int numThreads);
+
+    static Tables aggregate(const Answers& answers, int numThreads);
+
+    /** confusion.csv and accuracy_by_<root|pattern|week|student>.csv; false if any could not be written */
+    static bool writeCsv(const Answers& answers, const Tables& tables, const juce::File& directory);
+    static bool writeJson(const Answers& answers, const Tables& tables, const juce::File& file);
+
+    /** Entry point for the --analytics command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
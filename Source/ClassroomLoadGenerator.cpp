@@ -0,0 +1,198 @@
+#include "ClassroomLoadGenerator.h"
+#include "ClassroomServer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    const char* const kModeNames[] = { "Ionian", "Dorian", "Phrygian", "Lydian", "Mixolydian", "Aeolian", "Locrian" };
+
+    // The same exercise list for every client, so clients overlap in what they ask for
+    juce::String getExerciseRequest(int exerciseIndex)
+    {
+        juce::Random random(exerciseIndex + 1);
+        juce::String request;
+        request << "QUESTION mode=" << kModeNames[random.nextInt(7)]
+                << " pattern=" << random.nextInt(5)
+                << " root=" << 12 + random.nextInt(13)
+                << " speed=" << juce::String(1.0 + 0.5 * random.nextInt(3), 1);
+        return request;
+    }
+}
+
+double ClassroomLoadGenerator::Result::getPercentile(double percent) const
+{
+    if (latenciesMs.empty())
+        return 0.0;
+
+    auto index = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(latenciesMs.size()))) - 1;
+    return latenciesMs[juce::jlimit<size_t>(0, latenciesMs.size() - 1, index)];
+}
+
+ClassroomLoadGenerator::ClassroomLoadGenerator(Settings settings)
+    : settings(settings)
+{
+}
+
+ClassroomLoadGenerator::Result ClassroomLoadGenerator::run()
+{
+    ClassroomProtocol::ignoreBrokenPipes();
+
+    auto numClients = static_cast<size_t>(juce::jmax(1, settings.numClients));
+    std::vector<std::vector<double>> latencies(numClients);
+    std::vector<juce::String> errors(numClients);
+    std::vector<double> bytesReceived(numClients, 0.0);
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < numClients; ++i)
+        clients.emplace_back([this, i, &latencies, &errors, &bytesReceived]
+        {
+            runClient(static_cast<int>(i), latencies[i], errors[i], bytesReceived[i]);
+        });
+
+    for (auto& client : clients)
+        client.join();
+
+    Result result;
+    result.elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    for (size_t i = 0; i < numClients; ++i)
+    {
+        result.latenciesMs.insert(result.latenciesMs.end(), latencies[i].begin(), latencies[i].end());
+        result.megabytesReceived += bytesReceived[i] / (1024.0 * 1024.0);
+        if (errors[i].isNotEmpty())
+        {
+            if (result.numErrors++ == 0)
+                result.firstError = "client " + juce::String(i) + ": " + errors[i];
+        }
+    }
+    std::sort(result.latenciesMs.begin(), result.latenciesMs.end());
+    return result;
+}
+
+void ClassroomLoadGenerator::runClient(int clientIndex, std::vector<double>& latencies,
+                                       juce::String& error, double& bytesReceived) const
+{
+    juce::StreamingSocket socket;
+    if (!socket.connect(settings.address, settings.port, 5000))
+    {
+        error = "could not connect";
+        return;
+    }
+
+    ClassroomProtocol::Reader reader(socket);
+    juce::Random random(clientIndex);
+    std::vector<float> samples;
+    juce::String line;
+
+    for (int question = 0; question < settings.questionsPerClient; ++question)
+    {
+        auto request = getExerciseRequest(random.nextInt(juce::jmax(1, settings.numDistinctExercises)));
+        auto sent = juce::Time::getMillisecondCounterHiRes();
+
+        if (!ClassroomProtocol::writeLine(socket, request) || !reader.readLine(line))
+        {
+            error = "disconnected";
+            return;
+        }
+
+        // AUDIO <id> <sampleRate> <numChannels> <numSamples> cached|rendered
+        auto words = juce::StringArray::fromTokens(line, " ", "");
+        if (words[0] != "AUDIO" || words.size() < 6)
+        {
+            error = "unexpected reply: " + line;
+            return;
+        }
+
+        auto numSamples = static_cast<size_t>(words[3].getIntValue()) * static_cast<size_t>(words[4].getIntValue());
+        samples.resize(numSamples);
+        if (!reader.readBytes(samples.data(), sizeof(float) * numSamples))
+        {
+            error = "audio cut short";
+            return;
+        }
+
+        latencies.push_back(juce::Time::getMillisecondCounterHiRes() - sent);
+        bytesReceived += static_cast<double>(sizeof(float) * numSamples);
+
+        // Answer with a guess, as a student would
+        if (!ClassroomProtocol::writeLine(socket, "ANSWER " + words[1] + " " + kModeNames[random.nextInt(7)])
+            || !reader.readLine(line) || !line.startsWith("RESULT"))
+        {
+            error = "bad answer reply: " + line;
+            return;
+        }
+    }
+
+    ClassroomProtocol::writeLine(socket, "QUIT");
+}
+
+juce::String ClassroomLoadGenerator::fetchStats() const
+{
+    juce::StreamingSocket socket;
+    juce::String line;
+    if (socket.connect(settings.address, settings.port, 5000))
+    {
+        ClassroomProtocol::Reader reader(socket);
+        if (ClassroomProtocol::writeLine(socket, "STATS"))
+            reader.readLine(line);
+        ClassroomProtocol::writeLine(socket, "QUIT");
+    }
+    return line;
+}
+
+void ClassroomLoadGenerator::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--address"))
+        settings.address = args.getValueForOption("--address");
+    if (args.containsOption("--port"))
+        settings.port = args.getValueForOption("--port").getIntValue();
+    if (args.containsOption("--clients"))
+        settings.numClients = args.getValueForOption("--clients").getIntValue();
+    if (args.containsOption("--questions"))
+        settings.questionsPerClient = args.getValueForOption("--questions").getIntValue();
+    if (args.containsOption("--distinct"))
+        settings.numDistinctExercises = args.getValueForOption("--distinct").getIntValue();
+
+    if (settings.numClients < 1 || settings.questionsPerClient < 1 || settings.numDistinctExercises < 1)
+        juce::ConsoleApplication::fail("--clients, --questions and --distinct must be at least 1", 1);
+
+    // Without a port, test against a server in this process
+    std::unique_ptr<ClassroomServer> localServer;
+    if (settings.port == 0)
+    {
+        ClassroomServer::Settings serverSettings;
+        serverSettings.port = 0;
+        serverSettings.address = settings.address;
+        serverSettings.cache.pitchShiftRoots = args.containsOption("--pitch-shift");
+        localServer = std::make_unique<ClassroomServer>(serverSettings);
+
+        juce::String error;
+        if (!localServer->start(error))
+            juce::ConsoleApplication::fail(error, 1);
+        settings.port = localServer->getPort();
+        std::cout << "Started a local server on port " << settings.port << std::endl;
+    }
+
+    ClassroomLoadGenerator generator(settings);
+    auto result = generator.run();
+
+    std::cout << settings.numClients << " clients x " << settings.questionsPerClient << " questions ("
+              << settings.numDistinctExercises << " distinct) in " << result.elapsedSeconds << " s: "
+              << "p50 " << juce::String(result.getPercentile(50.0), 1) << " ms, "
+              << "p99 " << juce::String(result.getPercentile(99.0), 1) << " ms, "
+              << "max " << juce::String(result.getPercentile(100.0), 1) << " ms, "
+              << juce::String(static_cast<double>(result.latenciesMs.size()) / juce::jmax(0.001, result.elapsedSeconds), 1)
+              << " questions/s, " << juce::String(result.megabytesReceived, 1) << " MB received" << std::endl;
+    std::cout << generator.fetchStats() << std::endl;
+
+    if (localServer != nullptr)
+        localServer->stop();
+
+    if (result.numErrors > 0)
+        juce::ConsoleApplication::fail(juce::String(result.numErrors) + " clients failed, first " + result.firstError, 1);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// Simulated student stations for the classroom server. Each client connects,
+// asks a series of questions drawn from a fixed set of distinct exercises,
+// receives the full audio of each and answers it, timing every question from
+// request to last sample received.
+class ClassroomLoadGenerator
+{
+public:
+    struct Settings
+    {
+        juce::String address = "127.0.0.1";
+        int port = 0;
+        int numClients = 30;
+        int questionsPerClient = 20;
+        int numDistinctExercises = 8;  // Smaller means more cache sharing
+    };
+
+    struct Result
+    {
+        std::vector<double> latenciesMs;  // One per question, sorted
+        int numErrors = 0;
+        juce::String firstError;
+        double elapsedSeconds = 0.0;
+        double megabytesReceived = 0.0;
+
+        double getPercentile(double percent) const;
+    };
+
+    explicit ClassroomLoadGenerator(Settings settings);
+
+    /** Run every client to completion; blocks */
+    Result run();
+
+    /** Ask the server for its STATS line */
+    juce::String fetchStats() const;
+
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    Settings settings;
+
+    void runClient(int clientIndex, std::vector<double>& latencies, juce::String& error, double& bytesReceived) const;
+};
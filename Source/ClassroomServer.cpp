@@ -0,0 +1,458 @@
+#include "ClassroomServer.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+// MARK: - (Protocol)
+
+namespace ClassroomProtocol
+{
+    Reader::Reader(juce::StreamingSocket& socket)
+        : socket(socket)
+    {
+    }
+
+    bool Reader::fill(const std::atomic<bool>* shouldStop)
+    {
+        start = 0;
+        end = 0;
+
+        // Poll so that a stop request is noticed while the peer is quiet
+        for (;;)
+        {
+            if (shouldStop != nullptr && shouldStop->load())
+                return false;
+
+            int ready = socket.waitUntilReady(true, 100);
+            if (ready < 0)
+                return false;
+            if (ready == 0)
+                continue;
+
+            int numRead = socket.read(buffer, static_cast<int>(sizeof(buffer)), false);
+            if (numRead <= 0)
+                return false;  // Closed by the peer
+
+            end = numRead;
+            return true;
+        }
+    }
+
+    bool Reader::readLine(juce::String& line, const std::atomic<bool>* shouldStop)
+    {
+        juce::MemoryOutputStream text;
+        for (;;)
+        {
+            if (start == end && !fill(shouldStop))
+                return false;
+
+            while (start < end)
+            {
+                char c = buffer[start++];
+                if (c == '\n')
+                {
+                    line = text.toString().trimEnd();  // Tolerates \r\n
+                    return true;
+                }
+                if (text.getDataSize() >= static_cast<size_t>(kMaxLineLength))
+                    return false;  // Not a client speaking this protocol; don't buffer without end
+                text.writeByte(c);
+            }
+        }
+    }
+
+    bool Reader::readBytes(void* destination, size_t numBytes)
+    {
+        auto* output = static_cast<char*>(destination);
+        while (numBytes > 0)
+        {
+            if (start == end && !fill(nullptr))
+                return false;
+
+            auto numToCopy = juce::jmin(numBytes, static_cast<size_t>(end - start));
+            std::copy(buffer + start, buffer + start + numToCopy, output);
+            start += static_cast<int>(numToCopy);
+            output += numToCopy;
+            numBytes -= numToCopy;
+        }
+        return true;
+    }
+
+    namespace
+    {
+        bool writeAll(juce::StreamingSocket& socket, const void* data, size_t numBytes)
+        {
+            // send() may write less than asked for
+            auto* bytes = static_cast<const char*>(data);
+            while (numBytes > 0)
+            {
+                int numWritten = socket.write(bytes, static_cast<int>(juce::jmin(numBytes, static_cast<size_t>(1 << 20))));
+                if (numWritten <= 0)
+                    return false;
+                bytes += numWritten;
+                numBytes -= static_cast<size_t>(numWritten);
+            }
+            return true;
+        }
+    }
+
+    bool writeLine(juce::StreamingSocket& socket, const juce::String& line)
+    {
+        auto text = line + "\n";
+        return writeAll(socket, text.toRawUTF8(), text.getNumBytesAsUTF8());
+    }
+
+    bool writeSamples(juce::StreamingSocket& socket, const float* samples, int numSamples)
+    {
+        if (!juce::ByteOrder::isBigEndian())
+            return writeAll(socket, samples, sizeof(float) * static_cast<size_t>(numSamples));
+
+        uint32_t converted[1024];
+        for (int offset = 0; offset < numSamples; offset += 1024)
+        {
+            int count = juce::jmin(1024, numSamples - offset);
+            for (int i = 0; i < count; ++i)
+            {
+                uint32_t bits;
+                std::memcpy(&bits, samples + offset + i, sizeof(bits));
+                converted[i] = juce::ByteOrder::swap(bits);
+            }
+            if (!writeAll(socket, converted, sizeof(uint32_t) * static_cast<size_t>(count)))
+                return false;
+        }
+        return true;
+    }
+
+    std::map<juce::String, juce::String> parseOptions(const juce::StringArray& words)
+    {
+        std::map<juce::String, juce::String> options;
+        for (int i = 1; i < words.size(); ++i)
+            options[words[i].upToFirstOccurrenceOf("=", false, false).toLowerCase()]
+                = words[i].fromFirstOccurrenceOf("=", false, false);
+        return options;
+    }
+
+    bool isLoopbackAddress(const juce::String& address)
+    {
+        return address.startsWith("127.") || address == "::1" || address.startsWith("::ffff:127.");
+    }
+
+    void ignoreBrokenPipes()
+    {
+       #if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+        // A client that disconnects mid-stream must fail the write, not end the process
+        std::signal(SIGPIPE, SIG_IGN);
+       #endif
+    }
+}
+
+// MARK: - (Connection)
+
+class ClassroomServer::Connection : public juce::Thread
+{
+public:
+    Connection(ClassroomServer& server, std::unique_ptr<juce::StreamingSocket> socket, int clientNumber)
+        : juce::Thread("Classroom client " + juce::String(clientNumber))
+        , server(server)
+        , socket(std::move(socket))
+        , reader(*this->socket)
+    {
+    }
+
+    ~Connection() override
+    {
+        disconnect();
+    }
+
+    void disconnect()
+    {
+        shouldStop = true;
+        socket->close();
+        stopThread(5000);
+    }
+
+private:
+    ClassroomServer& server;
+    std::unique_ptr<juce::StreamingSocket> socket;
+    ClassroomProtocol::Reader reader;
+    std::atomic<bool> shouldStop { false };
+
+    std::map<int, AudioEngine::ModeType> openQuestions;  // Asked but not yet answered
+    int nextQuestionId = 1;
+    juce::Random random;
+
+    void run() override
+    {
+        juce::String line;
+        while (!threadShouldExit() && reader.readLine(line, &shouldStop))
+        {
+            if (line.isNotEmpty() && !handle(line))
+                break;
+        }
+        socket->close();
+        server.numClients--;
+    }
+
+    // Returns false to end the connection
+    bool handle(const juce::String& line)
+    {
+        auto words = juce::StringArray::fromTokens(line, " ", "");
+        auto command = words[0].toUpperCase();
+
+        if (command == "QUESTION")
+            return sendQuestion(ClassroomProtocol::parseOptions(words));
+
+        if (command == "ANSWER")
+            return answer(words);
+
+        if (command == "STATS")
+            return ClassroomProtocol::writeLine(*socket, server.getStatsLine());
+
+        if (command == "QUIT")
+            return false;
+
+        if (command == "SHUTDOWN")
+        {
+            // A station on the LAN mustn't be able to stop the class
+            if (!server.settings.allowRemoteShutdown && !ClassroomProtocol::isLoopbackAddress(socket->getHostName()))
+                return ClassroomProtocol::writeLine(*socket, "ERROR SHUTDOWN is only accepted from the server's machine");
+
+            ClassroomProtocol::writeLine(*socket, "BYE");
+            server.shutdownRequested = true;
+            return false;
+        }
+
+        return ClassroomProtocol::writeLine(*socket, "ERROR Unknown command " + words[0]);
+    }
+
+    bool sendQuestion(const std::map<juce::String, juce::String>& options)
+    {
+        RenderCache::Key key;
+        key.mode = server.modes[static_cast<size_t>(random.nextInt(static_cast<int>(server.modes.size())))];
+        key.rootNoteIndex = 12 + random.nextInt(13);  // Root slider range
+        key.speedPercent = 100;
+
+        for (auto& [name, value] : options)
+        {
+            if (name == "mode")
+            {
+                int index = server.modeNames.indexOf(value, true);
+                if (index < 0)
+                    return ClassroomProtocol::writeLine(*socket, "ERROR Unknown mode " + value);
+                key.mode = server.modes[static_cast<size_t>(index)];
+            }
+            else if (name == "pattern")
+            {
+                int index = value.getIntValue();
+                if (value.isEmpty() || !value.containsOnly("0123456789") || index >= server.numPatterns)
+                    return ClassroomProtocol::writeLine(*socket, "ERROR Pattern must be 0 to " + juce::String(server.numPatterns - 1));
+                key.pattern = static_cast<AudioEngine::PlaybackPattern>(index);
+            }
+            else if (name == "root")
+            {
+                int index = value.getIntValue();
+                if (value.isEmpty() || !value.containsOnly("0123456789") || index > RenderCache::kMaxRootNoteIndex)
+                    return ClassroomProtocol::writeLine(*socket, "ERROR Root must be 0 to " + juce::String(RenderCache::kMaxRootNoteIndex));
+                key.rootNoteIndex = index;
+            }
+            else if (name == "speed")
+            {
+                auto speed = value.getDoubleValue();
+                if (speed < 0.5 || speed > 3.0)
+                    return ClassroomProtocol::writeLine(*socket, "ERROR Speed must be 0.5 to 3.0");
+                key.speedPercent = juce::roundToInt(speed * 10.0) * 10;  // Speed slider step
+            }
+            else
+            {
+                return ClassroomProtocol::writeLine(*socket, "ERROR Unknown option " + name);
+            }
+        }
+
+        bool wasCached = false;
+        auto audio = server.cache.get(key, wasCached);
+
+        // Ids only grow, so the first entry is the oldest question
+        if (static_cast<int>(openQuestions.size()) >= ClassroomProtocol::kMaxOpenQuestions)
+            openQuestions.erase(openQuestions.begin());
+
+        int id = nextQuestionId++;
+        openQuestions[id] = key.mode;
+        server.numQuestions++;
+
+        juce::String header;
+        header << "AUDIO " << id << " " << juce::roundToInt(server.cache.getSampleRate())
+               << " " << audio->getNumChannels() << " " << audio->getNumSamples()
+               << (wasCached ? " cached" : " rendered");
+
+        return ClassroomProtocol::writeLine(*socket, header)
+            && ClassroomProtocol::writeSamples(*socket, audio->getReadPointer(0), audio->getNumSamples());
+    }
+
+    bool answer(const juce::StringArray& words)
+    {
+        auto found = openQuestions.find(words[1].getIntValue());
+        if (words.size() < 3 || found == openQuestions.end())
+            return ClassroomProtocol::writeLine(*socket, "ERROR No open question " + words[1]);
+
+        auto modeIndex = std::find(server.modes.begin(), server.modes.end(), found->second) - server.modes.begin();
+        auto actual = server.modeNames[static_cast<int>(modeIndex)];
+        bool correct = words[2].equalsIgnoreCase(actual);
+        openQuestions.erase(found);
+
+        server.numAnswers++;
+        if (correct)
+            server.numCorrect++;
+
+        return ClassroomProtocol::writeLine(*socket, juce::String("RESULT ") + (correct ? "correct " : "incorrect ") + actual);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Connection)
+};
+
+// MARK: - (Server)
+
+ClassroomServer::ClassroomServer(Settings settings)
+    : juce::Thread("Classroom server")
+    , settings(settings)
+    , cache(settings.cache)
+{
+    AudioEngine names;
+    names.loadUserPatterns(AudioEngine::getUserPatternFile());
+    modes = names.getAllModes();
+    for (auto mode : modes)
+        modeNames.add(names.getModeName(mode));
+    numPatterns = static_cast<int>(names.getAllPatterns().size());
+}
+
+ClassroomServer::~ClassroomServer()
+{
+    stop();
+}
+
+bool ClassroomServer::start(juce::String& error)
+{
+    ClassroomProtocol::ignoreBrokenPipes();
+
+    if (!listener.createListener(settings.port, settings.address))
+    {
+        error = "Could not listen on " + settings.address + ":" + juce::String(settings.port);
+        return false;
+    }
+
+    startThread();
+    return true;
+}
+
+void ClassroomServer::stop()
+{
+    // Closing the listener wakes the accept loop
+    signalThreadShouldExit();
+    listener.close();
+    stopThread(5000);
+
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.clear();
+}
+
+bool ClassroomServer::isRunning() const
+{
+    return isThreadRunning() && !shutdownRequested;
+}
+
+int ClassroomServer::getPort() const
+{
+    return listener.getBoundPort();
+}
+
+juce::String ClassroomServer::getStatsLine() const
+{
+    auto cacheStats = cache.getStats();
+
+    juce::String line;
+    line << "STATS clients=" << numClients.load()
+         << " questions=" << numQuestions.load()
+         << " answers=" << numAnswers.load()
+         << " correct=" << numCorrect.load()
+         << " cache_hits=" << cacheStats.hits
+         << " cache_shared=" << cacheStats.shared
+         << " renders=" << cacheStats.renders
+         << " cache_entries=" << cacheStats.entries
+         << " cache_mb=" << juce::String(static_cast<double>(cacheStats.bytes) / (1024.0 * 1024.0), 1);
+    return line;
+}
+
+void ClassroomServer::run()
+{
+    int clientNumber = 0;
+    while (!threadShouldExit())
+    {
+        std::unique_ptr<juce::StreamingSocket> socket(listener.waitForNextConnection());
+        if (socket == nullptr)
+            break;  // Listener closed
+
+        removeFinishedConnections();
+
+        numClients++;
+        auto connection = std::make_unique<Connection>(*this, std::move(socket), ++clientNumber);
+        connection->startThread();
+
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.push_back(std::move(connection));
+    }
+}
+
+void ClassroomServer::removeFinishedConnections()
+{
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                     [](const std::unique_ptr<Connection>& connection)
+                                     { return !connection->isThreadRunning(); }),
+                      connections.end());
+}
+
+// MARK: - (Command line)
+
+void ClassroomServer::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--port"))
+        settings.port = args.getValueForOption("--port").getIntValue();
+    if (args.containsOption("--address"))
+        settings.address = args.getValueForOption("--address");
+    if (args.containsOption("--rate"))
+        settings.cache.sampleRate = args.getValueForOption("--rate").getDoubleValue();
+    if (args.containsOption("--threads"))
+        settings.cache.numThreads = args.getValueForOption("--threads").getIntValue();
+    if (args.containsOption("--cache-mb"))
+        settings.cache.maximumBytes = static_cast<size_t>(args.getValueForOption("--cache-mb").getIntValue()) * 1024 * 1024;
+    settings.cache.pitchShiftRoots = args.containsOption("--pitch-shift");
+    settings.allowRemoteShutdown = args.containsOption("--allow-remote-shutdown");
+
+    if (settings.cache.sampleRate < 8000.0 || settings.cache.sampleRate > 192000.0)
+        juce::ConsoleApplication::fail("--rate must be between 8000 and 192000", 1);
+
+    ClassroomServer server(settings);
+    juce::String error;
+    if (!server.start(error))
+        juce::ConsoleApplication::fail(error, 1);
+
+    std::cout << "Classroom server listening on " << settings.address << ":" << server.getPort()
+              << " (" << juce::jmax(1, settings.cache.numThreads) << " render threads, "
+              << settings.cache.sampleRate << " Hz" << (settings.cache.pitchShiftRoots ? ", pitch-shifting roots" : "") << ")" << std::endl;
+
+    // Runs until a client sends SHUTDOWN or the process is stopped
+    auto lastReport = juce::Time::getMillisecondCounter();
+    while (server.isRunning())
+    {
+        juce::Thread::sleep(100);
+        if (juce::Time::getMillisecondCounter() - lastReport >= 10000)
+        {
+            lastReport = juce::Time::getMillisecondCounter();
+            std::cout << server.getStatsLine() << std::endl;
+        }
+    }
+
+    std::cout << server.getStatsLine() << std::endl;
+    server.stop();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AudioEngine.h"
+#include "RenderCache.h"
+
+// Line-based protocol between the classroom server and student stations.
+// Requests and replies are single lines of space-separated words; audio
+// follows its AUDIO line as raw little-endian float32 samples.
+//
+//   QUESTION [mode=<name>] [pattern=<index>] [root=<0-36>] [speed=<0.5-3.0>]
+//       -> AUDIO <id> <sampleRate> <numChannels> <numSamples> cached|rendered, then the samples
+//          (mode is chosen at random unless given; the client is not told which)
+//   ANSWER <id> <mode name>   -> RESULT correct|incorrect <actual mode name>
+//                                (only the last kMaxOpenQuestions unanswered ids can be answered)
+//   STATS                     -> STATS <name>=<value> ...
+//   QUIT                      -> connection closed
+//   SHUTDOWN                  -> BYE, then the server stops (only from this machine,
+//                                unless the server allows remote shutdown)
+//
+// Any malformed request gets ERROR <message> and the connection stays open.
+// A line longer than kMaxLineLength ends the connection.
+namespace ClassroomProtocol
+{
+    constexpr int kDefaultPort = 48620;
+    constexpr int kMaxLineLength = 4096;   // Bytes, far longer than any valid request or reply
+    constexpr int kMaxOpenQuestions = 64;  // Per connection; asking more forgets the oldest unanswered one
+
+    // Buffered reads from a socket, so lines can be read without a call per byte
+    class Reader
+    {
+    public:
+        explicit Reader(juce::StreamingSocket& socket);
+
+        /**
+         * Read up to the next newline
+         * @return false if the connection closed, shouldStop became true or the line passed kMaxLineLength
+         */
+        bool readLine(juce::String& line, const std::atomic<bool>* shouldStop = nullptr);
+
+        /** Read exactly numBytes; false if the connection closed first */
+        bool readBytes(void* destination, size_t numBytes);
+
+    private:
+        juce::StreamingSocket& socket;
+        char buffer[8192];
+        int start = 0;
+        int end = 0;
+
+        bool fill(const std::atomic<bool>* shouldStop);
+    };
+
+    bool writeLine(juce::StreamingSocket& socket, const juce::String& line);
+
+    /** Write samples as little-endian float32 */
+    bool writeSamples(juce::StreamingSocket& socket, const float* samples, int numSamples);
+
+    /** Whether a peer address from juce::StreamingSocket::getHostName() is this machine */
+    bool isLoopbackAddress(const juce::String& address);
+
+    /** Parse "name=value" words after the first into a map */
+    std::map<juce::String, juce::String> parseOptions(const juce::StringArray& words);
+
+    /** Make writes to a disconnected peer fail instead of raising SIGPIPE */
+    void ignoreBrokenPipes();
+}
+
+// Headless exercise server for a room of student stations on one machine or
+// LAN segment. Each client connection gets its own thread; audio comes from a
+// shared RenderCache, so thirty students asking for the same exercise cost
+// one render.
+class ClassroomServer : private juce::Thread
+{
+public:
+    struct Settings
+    {
+        int port = ClassroomProtocol::kDefaultPort;  // 0 picks any free port
+        juce::String address = "127.0.0.1";
+        bool allowRemoteShutdown = false;  // Accept SHUTDOWN from other machines too
+        RenderCache::Settings cache;
+    };
+
+    explicit ClassroomServer(Settings settings);
+    ~ClassroomServer() override;
+
+    /** Start listening; on failure returns false with a reason in error */
+    bool start(juce::String& error);
+
+    /** Disconnect every client and stop listening */
+    void stop();
+
+    bool isRunning() const;
+    int getPort() const;
+    juce::String getStatsLine() const;
+
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    class Connection;
+
+    Settings settings;
+    RenderCache cache;
+    juce::StreamingSocket listener;
+
+    std::vector<AudioEngine::ModeType> modes;
+    juce::StringArray modeNames;  // Same order as modes
+    int numPatterns;
+
+    std::mutex connectionsMutex;
+    std::vector<std::unique_ptr<Connection>> connections;
+
+    std::atomic<bool> shutdownRequested { false };
+    std::atomic<int> numClients { 0 };
+    std::atomic<int> numQuestions { 0 };
+    std::atomic<int> numAnswers { 0 };
+    std::atomic<int> numCorrect { 0 };
+
+    void run() override;  // Accepts connections
+    void removeFinishedConnections();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClassroomServer)
+};
@@ -0,0 +1,131 @@
+#include "CommandLineTools.h"
+#include "ClassAnalytics.h"
+#include "ClassroomLoadGenerator.h"
+#include "ClassroomServer.h"
+#include "EngineStress.h"
+#include "MarkdownBenchmark.h"
+#include "PitchShifter.h"
+#include "QuizSimulator.h"
+#include "RealtimeAudit.h"
+#include "RenderVerifier.h"
+#include "SessionReplay.h"
+#include "VisualizerComponent.h"
+
+juce::ConsoleApplication CommandLineTools::create()
+{
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand("--help|-h", "Usage: ModeTrainer [command] [options]", false);
+
+    app.addCommand({ "--verify-renders",
+                     "--verify-renders [--rates=44100,48000,96000] [--tolerance=<cents>] [--verbose]",
+                     "Render every mode, pattern and root offline and check the pitches played.",
+                     "Each exercise is split into notes at envelope onsets, each note's frequency is estimated "
+                     "with an FFT and compared with the expected interval sequence. Exits with status 1 on any mismatch.",
+                     [](const juce::ArgumentList& args) { RenderVerifier::runFromCommandLine(args); } });
+
+    app.addCommand({ "--rt-audit",
+                     "--rt-audit [--abort]",
+                     "Drive every engine feature through the real-time audit and report violations.",
+                     "Plays every mode and pattern at several sample rates and block sizes, with speed and pattern "
+                     "changes, stops, restarts, timbre changes, panning, reverb, MIDI mirroring and 1, 2 and 8 output channels, and fails if the audio callback allocated, freed or "
+                     "locked a mutex. Requires a build with MODETRAINER_RT_AUDIT=1. With --abort, the first violation "
+                     "aborts with a stack trace.",
+                     [](const juce::ArgumentList& args) { RealtimeAudit::runFromCommandLine(args); } });
+
+    app.addCommand({ "--verify-pitch-shift",
+                     "--verify-pitch-shift [--rates=22050,44100,48000] [--speed=3]",
+                     "Check pitch-shifted exercises against rendering each root directly.",
+                     "Renders every mode and non-random pattern once at A6 as sustained tones, shifts it to every lower "
+                     "root and renders that root directly. Fails if any note of a shifted exercise, after removing the "
+                     "expected tone under the note envelope, leaves more than -70 dB of error (aliasing, interpolation "
+                     "noise or misplaced envelope), differs in pitch from the direct render by more than 1 cent, or starts "
+                     "elsewhere. Reports the audio kept each way and the time per shift and per render.",
+                     [](const juce::ArgumentList& args) { PitchShifter::runFromCommandLine(args); } });
+
+    app.addCommand({ "--stress",
+                     "--stress [--seconds=5] [--threads=4] [--block-sizes=32,64,256,1024] [--seed=<n>]",
+                     "Fire random playback commands at the engine from several threads while another renders it.",
+                     "For each block size, --threads threads send plays, stops, speed and pattern changes while a "
+                     "simulated audio thread renders blocks of varying length. Fails if any block has a non-finite "
+                     "sample or one beyond full scale, the engine's playback state is ever inconsistent, or a "
+                     "playback is reported finished twice or not at all. Reports the commands per second handled. "
+                     "Build with ThreadSanitizer or AddressSanitizer to check for races and memory errors too.",
+                     [](const juce::ArgumentList& args) { EngineStress::runFromCommandLine(args); } });
+
+    app.addCommand({ "--simulate-sessions",
+                     "--simulate-sessions [--sessions=1000] [--questions=10] [--threads=<n>] [--accuracy=0.7] [--rate=8000] [--speed=3] [--seed=<n>]",
+                     "Play whole quiz sessions with a simulated student on a virtual clock.",
+                     "Each session runs the real quiz logic and engine: questions are played and rendered offline, "
+                     "answered correctly with probability --accuracy after a random think, and followed through the "
+                     "feedback delay, with the odd practice play, early stop and settings change. The clock jumps over "
+                     "anything silent. Fails if the status, score, question or root ever differs from what the student "
+                     "should see, a playback never finishes or a callback is left scheduled.",
+                     [](const juce::ArgumentList& args) { QuizSimulator::runFromCommandLine(args); } });
+
+    app.addCommand({ "--replay",
+                     "--replay=<session.json|directory> [--update-golden] [--tolerance=<largest sample difference>]",
+                     "Re-render recorded sessions and compare them with their golden files.",
+                     "Renders each session's audio offline from its seed and recorded events, and passes if its SHA-256 "
+                     "matches <name>.golden.sha256, or if no sample differs from <name>.golden.wav by more than "
+                     "--tolerance (0 by default, i.e. bit-exact). --update-golden writes the golden files instead.",
+                     [](const juce::ArgumentList& args) { SessionReplay::runFromCommandLine(args); } });
+
+    app.addCommand({ "--server",
+                     "--server [--port=48620] [--address=127.0.0.1] [--threads=<n>] [--rate=44100] [--cache-mb=256] [--pitch-shift] [--allow-remote-shutdown]",
+                     "Serve exercises to student stations over TCP.",
+                     "Accepts QUESTION, ANSWER, STATS, QUIT and SHUTDOWN requests, one per line, and streams each "
+                     "exercise back as float32 PCM. Renders run on a pool of --threads workers and are shared between "
+                     "clients through a cache of up to --cache-mb megabytes. With --pitch-shift, each mode, pattern and "
+                     "speed is rendered once and pitch-shifted to every root. Runs until a client on this machine sends SHUTDOWN, "
+                     "or any client with --allow-remote-shutdown.",
+                     [](const juce::ArgumentList& args) { ClassroomServer::runFromCommandLine(args); } });
+
+    app.addCommand({ "--loadgen",
+                     "--loadgen [--port=<n>] [--address=127.0.0.1] [--clients=30] [--questions=20] [--distinct=8] [--pitch-shift]",
+                     "Simulate a classroom of clients against the exercise server and report latency.",
+                     "Each client asks --questions questions drawn from --distinct exercises and answers each one. "
+                     "Reports p50, p99 and maximum time from request to last sample received, and the server's "
+                     "cache statistics. Without --port, a server is started in this process, with --pitch-shift as for --server.",
+                     [](const juce::ArgumentList& args) { ClassroomLoadGenerator::runFromCommandLine(args); } });
+
+    app.addCommand({ "--markdown-bench",
+                     "--markdown-bench [--max-mb=1] [--golden=<directory>] [--update-golden]",
+                     "Measure the Markdown converter on a generated corpus and check its output.",
+                     "Converts the README, books, nested lists and code fences from 1 KB to --max-mb, and lines of "
+                     "unterminated emphasis and unbalanced links, serially and in parallel, reporting MB/s and peak "
+                     "memory (Linux). Fails if the two outputs differ, if a family's time grows faster than "
+                     "size^1.4, or if the HTML doesn't match the golden hashes in --golden. --update-golden writes them.",
+                     [](const juce::ArgumentList& args) { MarkdownBenchmark::runFromCommandLine(args); } });
+
+    app.addCommand({ "--visualizer-bench",
+                     "--visualizer-bench [--width=8192] [--frames=600]",
+                     "Time the visualizer's analysis and painting at the widest window.",
+                     "Feeds the visualizer a frame's worth of engine output before each of --frames display frames, "
+                     "then times its analysis and a software paint at --width pixels. Reports the mean and p99 of each "
+                     "and fails if together they take more than 5% of one core at 60 fps.",
+                     [](const juce::ArgumentList& args) { VisualizerComponent::runFromCommandLine(args); } });
+
+    app.addCommand({ "--analytics",
+                     "--analytics=<directory> [--out=<directory>] [--threads=<n>] [--synthetic=<answers>] [--seed=<n>]",
+                     "Aggregate the answers in a class's saved sessions into confusion matrices and accuracy tables.",
+                     "Reads every session under <directory>, counting each for the student named by its first "
+                     "subdirectory, and writes confusion.csv, accuracy_by_<root|pattern|week|student>.csv and "
+                     "analytics.json to --out (<directory>/Analytics by default). --synthetic adds that many random "
+                     "answers, to time the aggregation for a large class.",
+                     [](const juce::ArgumentList& args) { ClassAnalytics::runFromCommandLine(args); } });
+
+    return app;
+}
+
+bool CommandLineTools::runIfRequested(const juce::String& commandLine, int& exitCode)
+{
+    juce::ArgumentList args("ModeTrainer", commandLine);
+    auto app = create();
+
+    if (args.size() == 0 || app.findCommand(args, true) == nullptr)
+        return false;
+
+    exitCode = app.findAndRunCommand(args, true);
+    return true;
+}
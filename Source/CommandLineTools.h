@@ -0,0 +1,19 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Headless tools that run instead of the GUI when the app is launched with
+// one of their options as the first argument, e.g. "ModeTrainer --verify-renders".
+namespace CommandLineTools
+{
+    /** All registered command line tools */
+    juce::ConsoleApplication create();
+
+    /**
+     * Run the tool matching the command line, if there is one
+     * @param commandLine Arguments passed to the application
+     * @param exitCode Set to the tool's exit code when a tool ran
+     * @return true if a tool handled the command line
+     */
+    bool runIfRequested(const juce::String& commandLine, int& exitCode);
+}
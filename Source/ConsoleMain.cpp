@@ -0,0 +1,27 @@
+#include <juce_events/juce_events.h>
+#include "ConsoleTrainer.h"
+#include "StartupTrace.h"
+
+// Entry point of the console trainer (ModeTrainerConsole.jucer). Unlike
+// Main.cpp there's no JUCEApplication or window: the message manager is
+// created here, and the trainer runs its loop only while playing to a device.
+int main(int argc, char* argv[])
+{
+    StartupTrace::begin();
+    juce::ScopedJuceInitialiser_GUI messageManager;  // Timers and callAsync, with no GUI modules linked
+
+    juce::ConsoleApplication app;
+    app.addHelpCommand("--help|-h", "Usage: ModeTrainerConsole [options]", false);
+    app.addDefaultCommand({ "",
+                            "[--null-audio] [--root=C5] [--random-root] [--pattern=Ascending] [--speed=1] [--flat-loudness] [--seed=<n>] [--stats]",
+                            "Practise identifying modes in the terminal.",
+                            "Opens the default audio output and plays quiz questions. Press space for a question and 1-7 "
+                            "to answer it (or, between questions, to hear that mode), s to stop, h for help and q to quit. "
+                            "--root is a note from A4 to A5 and --pattern any pattern name, including those in the user "
+                            "pattern file. --flat-loudness plays every note at the same level. With --null-audio no device "
+                            "is opened and each playback is rendered offline on a virtual clock, so keys can be piped in "
+                            "for automated tests. --stats prints the startup trace and peak memory on quitting.",
+                            [](const juce::ArgumentList& args) { ConsoleTrainer::runFromCommandLine(args); } });
+
+    return app.findAndRunCommand(argc, argv);
+}
@@ -0,0 +1,375 @@
+#include "ConsoleTrainer.h"
+#include "StartupTrace.h"
+#include <cerrno>
+#include <iostream>
+#include <poll.h>
+#include <sys/resource.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr int kEndOfInput = -1;
+    constexpr int kNoKey = -2;
+    constexpr int kKeyPollMilliseconds = 100;  // How soon the key reader notices it should stop
+    constexpr double kMaximumPlaybackSeconds = 60.0;  // Offline, a playback still going after this has hung
+
+    const char* const kNoteNames[] = { "A", "A#", "B", "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#" };
+
+    // Scientific pitch names, e.g. C5, for QuizSession note indices (A3 = 0)
+    juce::String getNoteName(int noteIndex)
+    {
+        return juce::String(kNoteNames[noteIndex % 12]) + juce::String(3 + (noteIndex + 9) / 12);
+    }
+
+    int parseNoteName(const juce::String& name)
+    {
+        for (int note = 11; note >= 0; --note)  // Sharps before the naturals they start with
+        {
+            if (!name.startsWithIgnoreCase(kNoteNames[note]))
+                continue;
+            auto octave = name.substring(juce::String(kNoteNames[note]).length());
+            if (!octave.containsOnly("0123456789") || octave.isEmpty())
+                return -1;
+            return note + 12 * (octave.getIntValue() - 3 - (note + 9) / 12);
+        }
+        return -1;
+    }
+
+    // Keys arrive one at a time, unechoed, while this exists. Ctrl-C comes
+    // through as a key too, so quitting always restores the terminal. Input
+    // that isn't a terminal, e.g. a pipe, is read as it is.
+    class RawTerminal
+    {
+    public:
+        RawTerminal()
+            : isTerminal(isatty(STDIN_FILENO) != 0 && tcgetattr(STDIN_FILENO, &saved) == 0)
+        {
+            if (!isTerminal)
+                return;
+
+            auto raw = saved;
+            raw.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO | ISIG));
+            raw.c_cc[VMIN] = 1;
+            raw.c_cc[VTIME] = 0;
+            tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        }
+
+        ~RawTerminal()
+        {
+            if (isTerminal)
+                tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        }
+
+    private:
+        termios saved {};
+        bool isTerminal;
+
+        JUCE_DECLARE_NON_COPYABLE(RawTerminal)
+    };
+
+    /** The next key, waiting up to timeoutMilliseconds (or forever if negative); kNoKey on timeout */
+    int readKey(int timeoutMilliseconds)
+    {
+        pollfd input { STDIN_FILENO, POLLIN, 0 };
+        int ready = poll(&input, 1, timeoutMilliseconds);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+            return kNoKey;
+
+        unsigned char key = 0;
+        return ready > 0 && read(STDIN_FILENO, &key, 1) == 1 ? key : kEndOfInput;
+    }
+
+    // Reads keys off the message thread, which has to keep running timers
+    // and playback notifications meanwhile, and hands each one over to it
+    class KeyReader : public juce::Thread
+    {
+    public:
+        explicit KeyReader(std::function<void(int)> onKeyToCall)
+            : juce::Thread("Key Reader")
+            , onKey(std::move(onKeyToCall))
+        {
+        }
+
+        ~KeyReader() override
+        {
+            stopThread(2 * kKeyPollMilliseconds);
+        }
+
+        void run() override
+        {
+            while (!threadShouldExit())
+            {
+                int key = readKey(kKeyPollMilliseconds);
+                if (key == kNoKey)
+                    continue;
+
+                juce::MessageManager::callAsync([callback = onKey, key] { callback(key); });
+                if (key == kEndOfInput)
+                    return;
+            }
+        }
+
+    private:
+        std::function<void(int)> onKey;
+    };
+}
+
+ConsoleTrainer::ConsoleTrainer(const Settings& settingsToUse)
+: settings(settingsToUse)
+, quiz(engine, settingsToUse.nullAudio ? static_cast<QuizScheduler&>(virtualScheduler) : realTimeScheduler, settingsToUse.seed)
+{
+    for (auto& error : engine.loadUserPatterns(AudioEngine::getUserPatternFile()))
+        std::cout << "Pattern file: " << error << std::endl;
+    engine.setRandomSeed(settings.seed);
+    engine.setPlaybackSpeed(settings.playbackSpeed);
+    engine.setLoudnessCompensationEnabled(settings.evenLoudness);
+    StartupTrace::mark("Engine created");
+}
+
+ConsoleTrainer::~ConsoleTrainer()
+{
+    engine.onPlaybackFinished = nullptr;  // It points at the quiz, which goes first
+}
+
+juce::String ConsoleTrainer::run()
+{
+    for (auto pattern : engine.getAllPatterns())
+        if (engine.getPatternName(pattern).equalsIgnoreCase(settings.patternName))
+            settings.quiz.pattern = pattern;
+    if (!engine.getPatternName(settings.quiz.pattern).equalsIgnoreCase(settings.patternName))
+        return "No pattern called \"" + settings.patternName + "\"";
+    quiz.setSettings(settings.quiz);
+
+    if (!settings.nullAudio)
+        return runWithDevice();
+
+    runOffline();
+    return {};
+}
+
+// MARK: - (Playing)
+
+juce::String ConsoleTrainer::runWithDevice()
+{
+    auto error = deviceManager.initialiseWithDefaultDevices(0, 2);
+    if (error.isEmpty() && deviceManager.getCurrentAudioDevice() == nullptr)
+        error = "no output device found";
+    if (error.isNotEmpty())
+        return "Couldn't open the audio device: " + error + " (use --null-audio to run without one)";
+    StartupTrace::mark("Audio device opened");
+
+    deviceManager.addAudioCallback(this);
+    quiz.onStatusChanged = [this] { printStatus(); };
+    quiz.prepareNextQuestion();
+    printHelp();
+    StartupTrace::mark("Ready for keys");
+
+    {
+        RawTerminal terminal;
+        KeyReader keyReader([safeThis = juce::WeakReference<ConsoleTrainer>(this)](int key)
+        {
+            if (safeThis != nullptr && !safeThis->handleKey(key))
+                juce::MessageManager::getInstance()->stopDispatchLoop();
+        });
+        keyReader.startThread();
+        juce::MessageManager::getInstance()->runDispatchLoop();
+    }
+
+    quiz.onStatusChanged = nullptr;
+    deviceManager.removeAudioCallback(this);
+    deviceManager.closeAudioDevice();
+    printResources();
+    return {};
+}
+
+void ConsoleTrainer::runOffline()
+{
+    juce::AudioBuffer<float> buffer(2, settings.nullBlockSize);
+    engine.prepareToPlay(settings.nullBlockSize, settings.nullSampleRate);
+    quiz.onStatusChanged = [this] { printStatus(); };
+    quiz.prepareNextQuestion();
+    printHelp();
+    StartupTrace::mark("Ready for keys");
+
+    RawTerminal terminal;
+    while (handleKey(readKey(-1)))
+    {
+        // Nothing is heard, so the clock jumps to the end of each playback and
+        // past the feedback, and the next key finds the quiz ready for it
+        renderUntilSilent(buffer);
+        virtualScheduler.advanceBy(QuizSession::kFeedbackMilliseconds);
+    }
+
+    quiz.onStatusChanged = nullptr;
+    printResources();
+}
+
+void ConsoleTrainer::renderUntilSilent(juce::AudioBuffer<float>& buffer)
+{
+    auto blockMilliseconds = buffer.getNumSamples() * 1000.0 / settings.nullSampleRate;
+    auto deadline = virtualScheduler.getMillisecondCounter() + kMaximumPlaybackSeconds * 1000.0;
+    while (engine.isCurrentlyPlaying() && virtualScheduler.getMillisecondCounter() < deadline)
+    {
+        engine.getNextAudioBlock(juce::AudioSourceChannelInfo(buffer));
+        virtualScheduler.advanceBy(blockMilliseconds);
+        engine.dispatchPendingNotifications();
+    }
+}
+
+void ConsoleTrainer::audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                                      float* const* outputChannelData, int numOutputChannels, int numSamples,
+                                                      const juce::AudioIODeviceCallbackContext& context)
+{
+    juce::ignoreUnused(inputChannelData, numInputChannels, context);
+
+    // Refers to the device's buffers, without allocating
+    juce::AudioBuffer<float> output(outputChannelData, numOutputChannels, numSamples);
+    engine.getNextAudioBlock(juce::AudioSourceChannelInfo(output));
+}
+
+void ConsoleTrainer::audioDeviceAboutToStart(juce::AudioIODevice* device)
+{
+    engine.prepareToPlay(device->getCurrentBufferSizeSamples(), device->getCurrentSampleRate());
+}
+
+void ConsoleTrainer::audioDeviceStopped()
+{
+    engine.releaseResources();
+}
+
+// MARK: - (Keys and output)
+
+bool ConsoleTrainer::handleKey(int key)
+{
+    auto modes = engine.getAllModes();
+    switch (key)
+    {
+        case kEndOfInput:
+        case 'q':
+        case 'Q':
+        case 3:   // Ctrl-C
+        case 4:   // Ctrl-D
+        case 27:  // Escape
+            return false;
+
+        case ' ':
+        case 'p':
+        case 'P':
+            if (!quiz.playQuestion())
+                std::cout << "Still playing; press s to stop it first." << std::endl;
+            return true;
+
+        case 's':
+        case 'S':
+            quiz.stop();
+            return true;
+
+        case 'h':
+        case 'H':
+        case '?':
+            printHelp();
+            return true;
+
+        default:
+            break;
+    }
+
+    int modeIndex = key - '1';
+    if (modeIndex >= 0 && modeIndex < static_cast<int>(modes.size()))
+    {
+        if (!quiz.chooseMode(modes[static_cast<size_t>(modeIndex)]))
+            std::cout << "Still playing; press s to stop it first." << std::endl;
+    }
+    return true;
+}
+
+void ConsoleTrainer::printHelp() const
+{
+    auto root = quiz.getSettings().randomizeRoot ? juce::String("random") : getNoteName(quiz.getSettings().rootNoteIndex);
+    std::cout << "Mode Trainer: root " << root << ", " << engine.getPatternName(quiz.getSettings().pattern)
+              << ", speed " << settings.playbackSpeed << "x" << (settings.nullAudio ? ", no audio" : "") << std::endl;
+
+    auto modes = engine.getAllModes();
+    for (size_t i = 0; i < modes.size(); ++i)
+        std::cout << "  " << (i + 1) << " " << engine.getModeName(modes[i]) << std::endl;
+    std::cout << "Space plays a question to answer with 1-" << modes.size()
+              << "; between questions 1-" << modes.size() << " plays that mode. s stops, h shows this, q quits." << std::endl;
+}
+
+void ConsoleTrainer::printStatus() const
+{
+    switch (quiz.getStatus())
+    {
+        case QuizSession::Status::instructions:
+            break;  // The help already says what to do
+        case QuizSession::Status::playingForPractice:
+            std::cout << quiz.getStatusText() << std::endl;
+            break;
+        case QuizSession::Status::playingForGuess:
+            std::cout << "Playing a question (root " << getNoteName(quiz.getSettings().rootNoteIndex) << ")..." << std::endl;
+            break;
+        case QuizSession::Status::waitingForGuess:
+            std::cout << "Which mode was it?" << std::endl;
+            break;
+        case QuizSession::Status::correctGuess:
+        case QuizSession::Status::incorrectGuess:
+        {
+            int answered = quiz.getNumAnswered();
+            std::cout << quiz.getStatusText() << " Score: " << quiz.getScore() << "/" << answered
+                      << " (" << juce::roundToInt(100.0 * quiz.getScore() / juce::jmax(1, answered)) << "%)" << std::endl;
+            break;
+        }
+    }
+}
+
+void ConsoleTrainer::printResources() const
+{
+    std::cout << "Final score: " << quiz.getScore() << "/" << quiz.getNumAnswered() << std::endl;
+    if (!settings.reportResources)
+        return;
+
+    // Kilobytes on Linux, bytes on macOS
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+   #if JUCE_MAC
+    auto peakBytes = static_cast<double>(usage.ru_maxrss);
+   #else
+    auto peakBytes = static_cast<double>(usage.ru_maxrss) * 1024.0;
+   #endif
+
+    std::cout << StartupTrace::getSummary()
+              << "Peak resident memory: " << juce::String(peakBytes / (1024.0 * 1024.0), 1) << " MB" << std::endl;
+}
+
+// MARK: - (Command line)
+
+void ConsoleTrainer::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    settings.nullAudio = args.containsOption("--null-audio");
+    settings.reportResources = args.containsOption("--stats");
+    settings.evenLoudness = !args.containsOption("--flat-loudness");
+    settings.quiz.randomizeRoot = args.containsOption("--random-root");
+
+    if (args.containsOption("--root"))
+    {
+        auto name = args.getValueForOption("--root");
+        auto noteIndex = parseNoteName(name);
+        if (noteIndex < QuizSession::kMinRootNoteIndex || noteIndex > QuizSession::kMaxRootNoteIndex)
+            juce::ConsoleApplication::fail("--root must be a note from " + getNoteName(QuizSession::kMinRootNoteIndex)
+                                           + " to " + getNoteName(QuizSession::kMaxRootNoteIndex) + ", e.g. C5; got \"" + name + "\"", 1);
+        settings.quiz.rootNoteIndex = noteIndex;
+    }
+    if (args.containsOption("--pattern"))
+        settings.patternName = args.getValueForOption("--pattern");
+    if (args.containsOption("--speed"))
+        settings.playbackSpeed = juce::jlimit(0.5f, 3.0f, args.getValueForOption("--speed").getFloatValue());
+    if (args.containsOption("--seed"))
+        settings.seed = args.getValueForOption("--seed").getLargeIntValue();
+
+    ConsoleTrainer trainer(settings);
+    auto error = trainer.run();
+    if (error.isNotEmpty())
+        juce::ConsoleApplication::fail(error, 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include "AudioEngine.h"
+#include "QuizScheduler.h"
+#include "QuizSession.h"
+
+// The quiz in a terminal, for practice stations reached over SSH or with too
+// little memory for the GUI and the web view the About box brings with it.
+// It plays through the same AudioEngine and QuizSession as the app, opens the
+// default audio device itself, and takes each answer as a single keystroke:
+// 1 to 7 for the modes, space for a question, s to stop and q to quit.
+//
+// It's built as its own executable (ModeTrainerConsole.jucer, ConsoleMain.cpp)
+// without any graphics modules, for a cold start under 100 ms and under 20 MB
+// resident.
+//
+// With a null audio device nothing is opened. Each playback is rendered
+// offline to its end as soon as it starts, on a virtual clock that also skips
+// the feedback delay, so a script can pipe keys in and check what's printed.
+class ConsoleTrainer : private juce::AudioIODeviceCallback
+{
+public:
+    struct Settings
+    {
+        bool nullAudio = false;
+        QuizSession::Settings quiz;
+        juce::String patternName = "Ascending";  // Built-in or from the user pattern file
+        float playbackSpeed = 1.0f;
+        bool evenLoudness = true;
+        juce::int64 seed = juce::Time::currentTimeMillis();
+        bool reportResources = false;  // Print the startup trace and peak memory on quitting
+
+        // Rendering with the null device; low, as nothing is heard
+        double nullSampleRate = 8000.0;
+        int nullBlockSize = 256;
+    };
+
+    explicit ConsoleTrainer(const Settings& settings);
+    ~ConsoleTrainer() override;
+
+    /**
+     * Play until the user quits or the input ends
+     * @return An error if the audio device or the pattern couldn't be used, or an empty string
+     */
+    juce::String run();
+
+    /** Entry point for ConsoleMain; call with a message manager but no loop running */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    Settings settings;
+    AudioEngine engine;
+    JuceQuizScheduler realTimeScheduler;
+    VirtualQuizScheduler virtualScheduler;
+    QuizSession quiz;
+    juce::AudioDeviceManager deviceManager;
+
+    juce::String runWithDevice();
+    void runOffline();
+    void renderUntilSilent(juce::AudioBuffer<float>& buffer);
+
+    /** Act on one key; false to quit */
+    bool handleKey(int key);
+    void printHelp() const;
+    void printStatus() const;
+    void printResources() const;
+
+    void audioDeviceIOCallbackWithContext(const float* const* inputChannelData, int numInputChannels,
+                                          float* const* outputChannelData, int numOutputChannels, int numSamples,
+                                          const juce::AudioIODeviceCallbackContext& context) override;
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(ConsoleTrainer)
+    JUCE_DECLARE_NON_COPYABLE(ConsoleTrainer)
+};
@@ -0,0 +1,100 @@
+#include "DspGraph.h"
+#include <deque>
+
+int DspGraph::addNode(std::unique_ptr<DspNode> node)
+{
+    nodes.push_back(std::move(node));
+    sources.emplace_back();
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+void DspGraph::connect(int sourceNode, int destinationNode)
+{
+    jassert(juce::isPositiveAndBelow(sourceNode, getNumNodes()));
+    jassert(juce::isPositiveAndBelow(destinationNode, getNumNodes()));
+    sources[static_cast<size_t>(destinationNode)].push_back(sourceNode);
+}
+
+bool DspGraph::build()
+{
+    // Kahn's algorithm: repeatedly take a node whose inputs have all been processed
+    auto numNodes = nodes.size();
+    std::vector<int> numUnprocessedInputs(numNodes, 0);
+    std::vector<std::vector<int>> destinations(numNodes);
+
+    for (size_t node = 0; node < numNodes; ++node)
+    {
+        for (int source : sources[node])
+        {
+            numUnprocessedInputs[node]++;
+            destinations[static_cast<size_t>(source)].push_back(static_cast<int>(node));
+        }
+    }
+
+    std::deque<int> ready;
+    for (size_t node = 0; node < numNodes; ++node)
+        if (numUnprocessedInputs[node] == 0)
+            ready.push_back(static_cast<int>(node));
+
+    processingOrder.clear();
+    while (!ready.empty())
+    {
+        int node = ready.front();
+        ready.pop_front();
+        processingOrder.push_back(node);
+
+        for (int destination : destinations[static_cast<size_t>(node)])
+            if (--numUnprocessedInputs[static_cast<size_t>(destination)] == 0)
+                ready.push_back(destination);
+    }
+
+    if (processingOrder.size() != numNodes)
+        return false;
+
+    inputs.assign(numNodes, {});
+    for (size_t node = 0; node < numNodes; ++node)
+        inputs[node].resize(sources[node].size(), nullptr);
+    outputIsSilent.assign(numNodes, 1);
+    return true;
+}
+
+void DspGraph::prepare(double sampleRate, int maximumBlockSize)
+{
+    jassert(processingOrder.size() == nodes.size()); // build() first
+
+    buffers.setSize(juce::jmax(1, getNumNodes()), juce::jmax(1, maximumBlockSize));
+    buffers.clear();
+
+    for (auto& node : nodes)
+        node->prepare(sampleRate, maximumBlockSize);
+
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = maximumBlockSize;
+}
+
+bool DspGraph::isPreparedFor(double sampleRate, int maximumBlockSize) const
+{
+    return preparedSampleRate == sampleRate && preparedBlockSize >= maximumBlockSize;
+}
+
+void DspGraph::process(const DspContext& context)
+{
+    jassert(context.numSamples <= preparedBlockSize);
+
+    for (int node : processingOrder)
+    {
+        auto index = static_cast<size_t>(node);
+        auto& nodeInputs = inputs[index];
+        const auto& nodeSources = sources[index];
+
+        for (size_t input = 0; input < nodeSources.size(); ++input)
+        {
+            auto source = nodeSources[input];
+            nodeInputs[input] = outputIsSilent[static_cast<size_t>(source)] ? nullptr : buffers.getReadPointer(source);
+        }
+
+        bool audible = nodes[index]->process(context, nodeInputs.data(), static_cast<int>(nodeInputs.size()),
+                                             buffers.getWritePointer(node));
+        outputIsSilent[index] = audible ? 0 : 1;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <memory>
+#include <vector>
+
+// What a graph is asked to render: one stretch of a block during which the
+// same note (or no note) is playing. The engine splits blocks at note
+// boundaries, so nodes never need to check for note changes themselves.
+struct DspContext
+{
+    const juce::AudioSourceChannelInfo* output = nullptr;  // Device buffer region being rendered
+    int offset = 0;                     // Position of this stretch within output
+    int numSamples = 0;
+
+    bool noteActive = false;            // False while stopped, e.g. for reverb tails
+    double frequency = 0.0;             // Hz
+    float noteGain = 1.0f;              // Loudness compensation for this note
+    double startAngle = 0.0;            // Oscillator phase at the first sample, in radians
+    double angleDelta = 0.0;            // Phase increment per sample
+    int samplesSinceNoteStart = 0;      // At the first sample
+    float samplesPerNote = 0.0f;
+    float panPosition = -1.0f;          // 0 to 1 across the channels, or negative for every channel
+};
+
+// A processing step that renders a whole stretch at a time, so the only
+// virtual calls are one per node per stretch.
+class DspNode
+{
+public:
+    virtual ~DspNode() = default;
+
+    /** Allocate anything the node needs; called off the audio thread */
+    virtual void prepare(double sampleRate, int maximumBlockSize) { juce::ignoreUnused(sampleRate, maximumBlockSize); }
+
+    /**
+     * Render one stretch
+     * @param context The stretch being rendered
+     * @param inputs Outputs of the nodes connected to this one, in connection order; nullptr for a silent input
+     * @param numInputs Number of inputs
+     * @param output Mono buffer of at least context.numSamples samples
+     * @return false if the output is silent, in which case it need not be written
+     */
+    virtual bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) = 0;
+};
+
+// A fixed set of nodes, run in dependency order with one mono buffer each.
+//
+// Graphs are assembled and prepared off the audio thread and never change
+// afterwards; to change the processing, build a new graph and swap it in.
+// process() doesn't allocate, lock or make per-sample virtual calls.
+class DspGraph
+{
+public:
+    /** @return Index of the node, for connect() */
+    int addNode(std::unique_ptr<DspNode> node);
+
+    /** Feed the output of one node into another; a node's inputs are in the order they're connected */
+    void connect(int sourceNode, int destinationNode);
+
+    /**
+     * Sort the nodes into processing order
+     * @return false if the connections contain a cycle
+     */
+    bool build();
+
+    /** Allocate the buffers and prepare every node; call after build(), off the audio thread */
+    void prepare(double sampleRate, int maximumBlockSize);
+    bool isPreparedFor(double sampleRate, int maximumBlockSize) const;
+
+    void process(const DspContext& context);
+
+    int getNumNodes() const { return static_cast<int>(nodes.size()); }
+
+private:
+    std::vector<std::unique_ptr<DspNode>> nodes;
+    std::vector<std::vector<int>> sources;              // Input nodes of each node, in connection order
+    std::vector<int> processingOrder;
+    std::vector<std::vector<const float*>> inputs;      // Scratch input lists, sized in build()
+    std::vector<unsigned char> outputIsSilent;
+    juce::AudioBuffer<float> buffers;                   // One channel per node
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+};
@@ -0,0 +1,181 @@
+#include "DspNodes.h"
+#include <cmath>
+
+// MARK: - (Sources)
+
+OscillatorNode::OscillatorNode(Waveform waveform)
+    : waveform(waveform)
+    , sampleRate(44100.0)
+{
+}
+
+void OscillatorNode::prepare(double newSampleRate, int)
+{
+    sampleRate = newSampleRate;
+}
+
+bool OscillatorNode::process(const DspContext& context, const float* const*, int, float* output)
+{
+    if (!context.noteActive)
+        return false;
+
+    if (waveform == Waveform::Sine)
+    {
+        for (int sample = 0; sample < context.numSamples; ++sample)
+            output[sample] = static_cast<float>(std::sin(context.startAngle + sample * context.angleDelta));
+        return true;
+    }
+
+    // Naive saw with the discontinuity smoothed by a polynomial band-limited step
+    double phaseIncrement = context.frequency / sampleRate;
+    double phase = std::fmod(context.startAngle / juce::MathConstants<double>::twoPi, 1.0);
+    for (int sample = 0; sample < context.numSamples; ++sample)
+    {
+        double value = 2.0 * phase - 1.0;
+        if (phase < phaseIncrement)
+        {
+            double t = phase / phaseIncrement;
+            value -= t + t - t * t - 1.0;
+        }
+        else if (phase > 1.0 - phaseIncrement)
+        {
+            double t = (phase - 1.0) / phaseIncrement;
+            value -= t * t + t + t + 1.0;
+        }
+        output[sample] = static_cast<float>(value);
+
+        phase += phaseIncrement;
+        if (phase >= 1.0)
+            phase -= 1.0;
+    }
+    return true;
+}
+
+// MARK: - (Processors)
+
+float EnvelopeNode::getLevel(float samplesSinceNoteStart, float samplesPerNote)
+{
+    float attackTime = 0.05f * samplesPerNote;  // 5% attack
+    float releaseTime = 0.2f * samplesPerNote;  // 20% release
+
+    if (samplesSinceNoteStart < attackTime)
+        return samplesSinceNoteStart / attackTime;
+    if (samplesSinceNoteStart > samplesPerNote - releaseTime)
+        return (samplesPerNote - samplesSinceNoteStart) / releaseTime;
+    return 1.0f;
+}
+
+bool EnvelopeNode::process(const DspContext& context, const float* const* inputs, int numInputs, float* output)
+{
+    if (numInputs < 1 || inputs[0] == nullptr)
+        return false;
+
+    const float* input = inputs[0];
+    for (int sample = 0; sample < context.numSamples; ++sample)
+    {
+        float position = static_cast<float>(context.samplesSinceNoteStart + sample);
+        output[sample] = input[sample] * getLevel(position, context.samplesPerNote);
+    }
+    return true;
+}
+
+FilterNode::FilterNode(float cutoffRatio, float resonance)
+    : cutoffRatio(cutoffRatio)
+    , damping(1.0f / resonance)
+    , sampleRate(44100.0)
+    , state1(0.0f)
+    , state2(0.0f)
+{
+}
+
+void FilterNode::prepare(double newSampleRate, int)
+{
+    sampleRate = newSampleRate;
+    state1 = state2 = 0.0f;
+}
+
+bool FilterNode::process(const DspContext& context, const float* const* inputs, int numInputs, float* output)
+{
+    if (numInputs < 1 || inputs[0] == nullptr)
+    {
+        state1 = state2 = 0.0f;
+        return false;
+    }
+
+    // Coefficients once per stretch; the note can't change within one
+    double cutoff = juce::jlimit(20.0, sampleRate * 0.45, context.frequency * cutoffRatio);
+    float g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate));
+    float a1 = 1.0f / (1.0f + g * (g + damping));
+    float a2 = g * a1;
+    float a3 = g * a2;
+
+    // Branch-free inner loop on local copies of the state
+    const float* input = inputs[0];
+    float s1 = state1, s2 = state2;
+    for (int sample = 0; sample < context.numSamples; ++sample)
+    {
+        float v3 = input[sample] - s2;
+        float v1 = a1 * s1 + a2 * v3;
+        float v2 = s2 + a2 * s1 + a3 * v3;
+        s1 = 2.0f * v1 - s1;
+        s2 = 2.0f * v2 - s2;
+        output[sample] = v2;
+    }
+    state1 = s1;
+    state2 = s2;
+    return true;
+}
+
+GainNode::GainNode(float gain)
+    : gain(gain)
+{
+}
+
+bool GainNode::process(const DspContext& context, const float* const* inputs, int numInputs, float* output)
+{
+    if (numInputs < 1 || inputs[0] == nullptr)
+        return false;
+
+    juce::FloatVectorOperations::copyWithMultiply(output, inputs[0], gain * context.noteGain, context.numSamples);
+    return true;
+}
+
+// MARK: - (Effects)
+
+ReverbNode::ReverbNode(ReverbStage& reverb)
+    : reverb(reverb)
+{
+}
+
+void ReverbNode::prepare(double, int maximumBlockSize)
+{
+    silence.calloc(static_cast<size_t>(juce::jmax(1, maximumBlockSize)));
+}
+
+bool ReverbNode::process(const DspContext& context, const float* const* inputs, int numInputs, float* output)
+{
+    const float* input = (numInputs > 0 && inputs[0] != nullptr) ? inputs[0] : silence.get();
+    const float* wet = reverb.process(input, context.numSamples);
+    if (wet == nullptr)
+        return false;
+
+    juce::FloatVectorOperations::copy(output, wet, context.numSamples);
+    return true;
+}
+
+// MARK: - (Output)
+
+bool OutputNode::process(const DspContext& context, const float* const* inputs, int numInputs, float*)
+{
+    const auto& output = *context.output;
+    juce::AudioSourceChannelInfo region(output.buffer, output.startSample + context.offset, context.numSamples);
+
+    outputStage.setPosition(context.panPosition, output.buffer->getNumChannels());
+    outputStage.writeToOutput(region, numInputs > 0 ? inputs[0] : nullptr, context.numSamples);
+
+    for (int input = 1; input < numInputs; ++input)
+        if (inputs[input] != nullptr)
+            OutputStage::addToOutput(region, inputs[input], context.numSamples);
+
+    return false;  // Nothing downstream
+}
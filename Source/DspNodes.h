@@ -0,0 +1,103 @@
+#pragma once
+
+#include "DspGraph.h"
+#include "OutputStage.h"
+#include "ReverbStage.h"
+
+// The nodes AudioEngine builds its graphs from. Each handles silent (nullptr)
+// inputs by returning a silent output without touching its buffer.
+
+// MARK: - (Sources)
+
+class OscillatorNode : public DspNode
+{
+public:
+    enum class Waveform
+    {
+        Sine,
+        Saw  // Band-limited with PolyBLEP
+    };
+
+    explicit OscillatorNode(Waveform waveform);
+
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+
+private:
+    Waveform waveform;
+    double sampleRate;
+};
+
+// MARK: - (Processors)
+
+// Attack and release ramps at the start and end of each note (5% and 20% of its length)
+class EnvelopeNode : public DspNode
+{
+public:
+    /** Level at a position in a note, 0 to 1 */
+    static float getLevel(float samplesSinceNoteStart, float samplesPerNote);
+
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+};
+
+// Topology-preserving transform state-variable low-pass, with the cutoff
+// tracking the note's frequency
+class FilterNode : public DspNode
+{
+public:
+    /**
+     * @param cutoffRatio Cutoff as a multiple of the note's frequency
+     * @param resonance Q, where 0.707 is no resonant peak
+     */
+    FilterNode(float cutoffRatio, float resonance);
+
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+
+private:
+    float cutoffRatio;
+    float damping;  // 1 / Q
+    double sampleRate;
+    float state1, state2;
+};
+
+class GainNode : public DspNode
+{
+public:
+    explicit GainNode(float gain);
+
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+
+private:
+    float gain;
+};
+
+// MARK: - (Effects)
+
+// Runs the engine's reverb, which outlives any one graph so tails and loaded
+// rooms survive graph changes. Keeps running on silent input so tails decay.
+class ReverbNode : public DspNode
+{
+public:
+    explicit ReverbNode(ReverbStage& reverb);
+
+    void prepare(double sampleRate, int maximumBlockSize) override;
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+
+private:
+    ReverbStage& reverb;
+    juce::HeapBlock<float> silence;
+};
+
+// MARK: - (Output)
+
+// Writes to the device: input 0 is panned by the context's pan position, any
+// further inputs (e.g. reverb returns) go to every channel at full level.
+class OutputNode : public DspNode
+{
+public:
+    bool process(const DspContext& context, const float* const* inputs, int numInputs, float* output) override;
+
+private:
+    OutputStage outputStage;
+};
@@ -0,0 +1,239 @@
+#include "EngineStress.h"
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Filled from any thread without locking or allocating; messages are string literals
+    class ViolationLog
+    {
+    public:
+        void report(const char* message) noexcept
+        {
+            int index = numReported++;
+            if (index < static_cast<int>(messages.size()))
+                messages[static_cast<size_t>(index)] = message;
+        }
+
+        juce::StringArray getMessages() const
+        {
+            juce::StringArray result;
+            int numKept = juce::jmin(numReported.load(), static_cast<int>(messages.size()));
+            for (int i = 0; i < numKept; ++i)
+                result.add(messages[static_cast<size_t>(i)].load());
+            if (numReported > numKept)
+                result.add("... and " + juce::String(numReported - numKept) + " more");
+            return result;
+        }
+
+    private:
+        std::atomic<int> numReported { 0 };
+        std::array<std::atomic<const char*>, 16> messages {};
+    };
+
+    const char* checkSamples(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* samples = buffer.getReadPointer(channel);
+            for (int i = 0; i < numSamples; ++i)
+            {
+                if (!std::isfinite(samples[i]))
+                    return "non-finite sample";
+                if (std::abs(samples[i]) > EngineStress::kMaximumAmplitude)
+                    return "sample beyond full scale";
+            }
+        }
+        return nullptr;
+    }
+}
+
+double EngineStress::Result::getCommandsPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(numCommands) / seconds : 0.0;
+}
+
+EngineStress::Result EngineStress::run(const Settings& settings, int blockSize)
+{
+    Result result;
+    result.blockSize = blockSize;
+
+    AudioEngine engine;
+    ViolationLog violations;
+    std::atomic<juce::int64> numFinished { 0 };
+    std::atomic<juce::int64> numBlocks { 0 };
+    std::atomic<juce::int64> numCommands { 0 };
+    std::atomic<juce::int64> numRejected { 0 };
+    std::atomic<juce::uint32> lastFinishedId { 0 };
+
+    // Delivered on this thread, which stands in for the message thread
+    engine.onPlaybackFinished = [&]
+    {
+        auto id = engine.getFinishedPlayId();
+        if (id <= lastFinishedId.load())
+            violations.report("playback reported finished twice, or out of order");
+        lastFinishedId = id;
+        numFinished++;
+    };
+    engine.setRandomSeed(settings.seed);
+    engine.setMidiMirroringEnabled(true);
+    engine.prepareToPlay(blockSize, settings.sampleRate);
+
+    auto modes = engine.getAllModes();
+    auto patterns = engine.getAllPatterns();
+
+    // The simulated device: mostly full blocks, but some shorter, and some
+    // longer than it said it would deliver, which the engine renders in chunks
+    std::atomic<bool> audioShouldStop { false };
+    std::thread audioThread([&]
+    {
+        juce::Random random(settings.seed ^ blockSize);
+        juce::AudioBuffer<float> buffer(2, blockSize * 2);
+        while (!audioShouldStop.load())
+        {
+            int choice = random.nextInt(10);
+            int numSamples = choice < 7 ? blockSize : (choice < 9 ? 1 + random.nextInt(blockSize) : blockSize * 2);
+            engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, numSamples));
+
+            if (auto* problem = checkSamples(buffer, numSamples))
+                violations.report(problem);
+            if (auto* problem = engine.checkPlaybackState())
+                violations.report(problem);
+            numBlocks++;
+        }
+    });
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    auto endTime = startTime + settings.secondsPerBlockSize * 1000.0;
+
+    std::vector<std::thread> commandThreads;
+    for (int t = 0; t < settings.numCommandThreads; ++t)
+    {
+        commandThreads.emplace_back([&, t]
+        {
+            juce::Random random(settings.seed + t + 1);
+            while (juce::Time::getMillisecondCounterHiRes() < endTime)
+            {
+                bool accepted = true;
+                int choice = random.nextInt(20);
+                if (choice < 8)
+                {
+                    auto mode = modes[static_cast<size_t>(random.nextInt(static_cast<int>(modes.size())))];
+                    auto pattern = patterns[static_cast<size_t>(random.nextInt(static_cast<int>(patterns.size())))];
+                    float rootFrequency = 110.0f * std::pow(2.0f, random.nextFloat() * 3.0f);
+                    accepted = engine.play(engine.preparePlayback(mode, rootFrequency, pattern)) != 0;
+                }
+                else if (choice < 11)
+                {
+                    accepted = engine.stopPlaying();
+                }
+                else if (choice < 16)
+                {
+                    engine.setPlaybackSpeed(0.5f + random.nextFloat() * 2.5f);
+                }
+                else
+                {
+                    engine.setPlaybackPattern(patterns[static_cast<size_t>(random.nextInt(static_cast<int>(patterns.size())))]);
+                }
+
+                if (accepted)
+                {
+                    numCommands++;
+                }
+                else
+                {
+                    // The queue is full until the next block; let the audio thread run
+                    numRejected++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    while (juce::Time::getMillisecondCounterHiRes() < endTime)
+    {
+        engine.dispatchPendingNotifications();
+        juce::Thread::sleep(1);
+    }
+    for (auto& thread : commandThreads)
+        thread.join();
+    result.seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    // Quietly now: one playback, played to the end, is reported exactly once
+    engine.setPlaybackSpeed(3.0f);
+    engine.dispatchPendingNotifications();
+    auto finishedBefore = numFinished.load();
+    juce::uint32 finalId = 0;
+    while ((finalId = engine.play(engine.preparePlayback(modes[0], 440.0f, patterns[0]))) == 0)
+        juce::Thread::sleep(1);
+
+    auto deadline = juce::Time::getMillisecondCounterHiRes() + 10000.0;
+    while (engine.isCurrentlyPlaying() && juce::Time::getMillisecondCounterHiRes() < deadline)
+    {
+        engine.dispatchPendingNotifications();
+        juce::Thread::sleep(1);
+    }
+    engine.dispatchPendingNotifications();
+    engine.dispatchPendingNotifications();
+
+    if (engine.isCurrentlyPlaying())
+        violations.report("the final playback never finished");
+    else if (numFinished.load() - finishedBefore != 1 || lastFinishedId.load() != finalId)
+        violations.report("the final playback was not reported finished exactly once");
+
+    audioShouldStop = true;
+    audioThread.join();
+
+    result.numCommands = numCommands.load();
+    result.numRejected = numRejected.load();
+    result.numBlocks = numBlocks.load();
+    result.numFinished = numFinished.load();
+    result.violations = violations.getMessages();
+    return result;
+}
+
+void EngineStress::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--seconds"))
+        settings.secondsPerBlockSize = juce::jmax(0.1, args.getValueForOption("--seconds").getDoubleValue());
+    if (args.containsOption("--threads"))
+        settings.numCommandThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+    if (args.containsOption("--seed"))
+        settings.seed = args.getValueForOption("--seed").getLargeIntValue();
+    if (args.containsOption("--block-sizes"))
+    {
+        settings.blockSizes.clear();
+        for (auto& size : juce::StringArray::fromTokens(args.getValueForOption("--block-sizes"), ",", ""))
+            if (size.getIntValue() > 0)
+                settings.blockSizes.add(size.getIntValue());
+        if (settings.blockSizes.isEmpty())
+            juce::ConsoleApplication::fail("No valid block sizes in --block-sizes", 1);
+    }
+
+    std::cout << "Stressing the engine with " << settings.numCommandThreads << " command threads for "
+              << settings.secondsPerBlockSize << " s per block size (seed " << settings.seed << ")" << std::endl;
+
+    int numFailed = 0;
+    for (int blockSize : settings.blockSizes)
+    {
+        auto result = run(settings, blockSize);
+        bool passed = result.violations.isEmpty();
+        if (!passed)
+            numFailed++;
+
+        std::cout << (passed ? "ok    " : "FAIL  ") << "block " << blockSize << ": "
+                  << result.numCommands << " commands (" << juce::roundToInt(result.getCommandsPerSecond()) << "/s), "
+                  << result.numRejected << " refused while the queue was full, "
+                  << result.numBlocks << " blocks, " << result.numFinished << " playbacks finished" << std::endl;
+        for (auto& violation : result.violations)
+            std::cout << "      " << violation << std::endl;
+    }
+
+    if (numFailed > 0)
+        juce::ConsoleApplication::fail(juce::String(numFailed) + " block sizes broke an invariant", 1);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "AudioEngine.h"
+
+// Drives one AudioEngine from several threads at once, the way the app's
+// message thread drives it while the device renders, but as fast as possible.
+// A simulated audio thread renders blocks of varying length around each block
+// size; command threads fire random plays, stops, speed and pattern changes;
+// the calling thread delivers finished notifications as the message thread
+// would. Every block is checked for non-finite or out-of-range samples and
+// for an inconsistent playback state (AudioEngine::checkPlaybackState()), and
+// every finished notification for a playback reported twice or out of order.
+// Each run ends quietly with one more playback, which must be reported
+// exactly once.
+//
+// Everything the threads share goes through the engine's command queue or
+// atomics, so a build with ThreadSanitizer or AddressSanitizer should report
+// nothing; any report is a bug in the engine.
+class EngineStress
+{
+public:
+    static constexpr float kMaximumAmplitude = 1.0f;
+
+    struct Settings
+    {
+        double secondsPerBlockSize = 5.0;
+        int numCommandThreads = 4;
+        juce::Array<int> blockSizes { 32, 64, 256, 1024 };
+        double sampleRate = 48000.0;
+        juce::int64 seed = juce::Time::currentTimeMillis();
+    };
+
+    struct Result
+    {
+        int blockSize = 0;
+        double seconds = 0.0;
+        juce::int64 numCommands = 0;  // Accepted by the engine
+        juce::int64 numRejected = 0;  // Refused while the command queue was full
+        juce::int64 numBlocks = 0;
+        juce::int64 numFinished = 0;  // Finished notifications delivered
+        juce::StringArray violations;
+
+        double getCommandsPerSecond() const;
+    };
+
+    /** Stress a new engine at one block size */
+    static Result run(const Settings& settings, int blockSize);
+
+    /** Entry point for the --stress command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
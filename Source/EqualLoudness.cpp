@@ -0,0 +1,87 @@
+#include "EqualLoudness.h"
+#include <cmath>
+
+namespace
+{
+    // ISO 226:2003 table 1: frequency, loudness perception exponent, magnitude
+    // of the linear transfer function, and threshold of hearing
+    struct ContourPoint
+    {
+        double frequency;
+        double exponent;
+        double transfer;
+        double threshold;
+    };
+
+    const ContourPoint kContour[] = {
+        {    20.0, 0.532, -31.6, 78.5 }, {    25.0, 0.506, -27.2, 68.7 }, {    31.5, 0.480, -23.0, 59.5 },
+        {    40.0, 0.455, -19.1, 51.1 }, {    50.0, 0.432, -15.9, 44.0 }, {    63.0, 0.409, -13.0, 37.5 },
+        {    80.0, 0.387, -10.3, 31.5 }, {   100.0, 0.367,  -8.1, 26.5 }, {   125.0, 0.349,  -6.2, 22.1 },
+        {   160.0, 0.330,  -4.5, 17.9 }, {   200.0, 0.315,  -3.1, 14.4 }, {   250.0, 0.301,  -2.0, 11.4 },
+        {   315.0, 0.288,  -1.1,  8.6 }, {   400.0, 0.276,  -0.4,  6.2 }, {   500.0, 0.267,   0.0,  4.4 },
+        {   630.0, 0.259,   0.3,  3.0 }, {   800.0, 0.253,   0.5,  2.2 }, {  1000.0, 0.250,   0.0,  2.4 },
+        {  1250.0, 0.246,  -2.7,  3.5 }, {  1600.0, 0.244,  -4.1,  1.7 }, {  2000.0, 0.243,  -1.0, -1.3 },
+        {  2500.0, 0.243,   1.7, -4.2 }, {  3150.0, 0.243,   2.5, -6.0 }, {  4000.0, 0.242,   1.2, -5.4 },
+        {  5000.0, 0.242,  -2.1, -1.5 }, {  6300.0, 0.245,  -7.1,  6.0 }, {  8000.0, 0.254, -11.2, 12.6 },
+        { 10000.0, 0.271, -10.7, 13.9 }, { 12500.0, 0.301,  -3.1, 12.3 }
+    };
+    constexpr int kNumContourPoints = static_cast<int>(sizeof(kContour) / sizeof(kContour[0]));
+
+    double getLevelAtPoint(const ContourPoint& point, double phons)
+    {
+        double af = 4.47e-3 * (std::pow(10.0, 0.025 * phons) - 1.15)
+                  + std::pow(0.4 * std::pow(10.0, (point.threshold + point.transfer) / 10.0 - 9.0), point.exponent);
+        return 10.0 / point.exponent * std::log10(af) - point.transfer + 94.0;
+    }
+}
+
+EqualLoudness::EqualLoudness()
+{
+    gains.fill(1.0f);
+}
+
+double EqualLoudness::getSoundPressureLevel(double frequency, double phons)
+{
+    if (frequency <= kContour[0].frequency)
+        return getLevelAtPoint(kContour[0], phons);
+    if (frequency >= kContour[kNumContourPoints - 1].frequency)
+        return getLevelAtPoint(kContour[kNumContourPoints - 1], phons);
+
+    // Linear in log frequency between the standard's points
+    int above = 1;
+    while (kContour[above].frequency < frequency)
+        ++above;
+    auto& lower = kContour[above - 1];
+    auto& upper = kContour[above];
+    double position = std::log(frequency / lower.frequency) / std::log(upper.frequency / lower.frequency);
+    return getLevelAtPoint(lower, phons) + position * (getLevelAtPoint(upper, phons) - getLevelAtPoint(lower, phons));
+}
+
+void EqualLoudness::prepare(double sampleRate, double tuningFrequency)
+{
+    if (sampleRate == preparedSampleRate && tuningFrequency == tuning)
+        return;
+
+    preparedSampleRate = sampleRate;
+    tuning = tuningFrequency;
+
+    double referenceLevel = getSoundPressureLevel(tuning, kListeningPhons);
+    for (int note = 0; note < kNumNotes; ++note)
+    {
+        double frequency = tuning * std::pow(2.0, (note - 69) / 12.0);
+        double boost = juce::jmin(kMaxBoostDecibels, getSoundPressureLevel(frequency, kListeningPhons) - referenceLevel);
+        gains[static_cast<size_t>(note)] = frequency < sampleRate / 2.0 ? juce::Decibels::decibelsToGain(static_cast<float>(boost)) : 0.0f;
+    }
+}
+
+float EqualLoudness::getGain(double frequency) const
+{
+    if (frequency <= 0.0 || frequency >= preparedSampleRate / 2.0)
+        return 0.0f;
+
+    // Between the notes either side, for tones off the tuning's semitones
+    double note = juce::jlimit(0.0, static_cast<double>(kNumNotes - 1), 69.0 + 12.0 * std::log2(frequency / tuning));
+    auto below = juce::jmin(static_cast<int>(note), kNumNotes - 2);
+    auto fraction = static_cast<float>(note - below);
+    return gains[static_cast<size_t>(below)] + fraction * (gains[static_cast<size_t>(below) + 1] - gains[static_cast<size_t>(below)]);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+// Per-note gains that make pure tones of every pitch sound about as loud as
+// the tuning note, from the ISO 226:2003 equal-loudness contours. On the
+// 60-phon contour used here, A3 (220 Hz) needs 6.0 dB more level than A4 to
+// sound as loud and A2 14.5 dB more (capped at kMaxBoostDecibels), while
+// around 3 kHz needs 6.4 dB less, so without this low roots sound weak.
+//
+// The gains are worked out once per sample rate and tuning for every MIDI
+// note, so finding a note's gain costs one logarithm and a table lookup, and
+// nothing is done per sample.
+class EqualLoudness
+{
+public:
+    static constexpr double kListeningPhons = 60.0;     // Contour for a quiet practice room
+    static constexpr double kMaxBoostDecibels = 12.0;   // For notes far below the ear's best range
+    static constexpr int kNumNotes = 128;               // MIDI notes
+
+    EqualLoudness();
+
+    /** Rebuild the table if the sample rate or tuning changed; not on the audio thread */
+    void prepare(double sampleRate, double tuningFrequency = 440.0);
+
+    /**
+     * Gain for a tone relative to one at the tuning frequency; 0 at or above
+     * Nyquist. Safe on the audio thread.
+     */
+    float getGain(double frequency) const;
+
+    /** Sound pressure level, in dB, of a tone heard at the given loudness level (ISO 226:2003, 20 Hz to 12.5 kHz) */
+    static double getSoundPressureLevel(double frequency, double phons);
+
+private:
+    double preparedSampleRate = 0.0;
+    double tuning = 440.0;
+    std::array<float, kNumNotes> gains;  // By MIDI note, A4 = 69 at the tuning frequency
+};
@@ -0,0 +1,168 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    constexpr int kNumFramesKept = 600;     // About 10 seconds at 60 Hz
+    constexpr int kRepaintEveryFrames = 15; // Overlay refresh rate, to keep its own cost down
+
+    std::atomic<bool> profilingEnabled { false };
+
+    // Message thread only
+    std::map<const juce::Component*, FrameProfiler::PaintStats> paintStats;
+    std::vector<double> frameTimes;
+    int nextFrame = 0;
+}
+
+void FrameProfiler::setEnabled(bool shouldBeEnabled)
+{
+    profilingEnabled.store(shouldBeEnabled, std::memory_order_relaxed);
+}
+
+bool FrameProfiler::isEnabled()
+{
+    return profilingEnabled.load(std::memory_order_relaxed);
+}
+
+void FrameProfiler::recordPaint(const juce::Component* component, const juce::String& name, double milliseconds)
+{
+    auto& stats = paintStats[component];
+    stats.name = name;
+    stats.numPaints++;
+    stats.totalMilliseconds += milliseconds;
+    stats.maxMilliseconds = juce::jmax(stats.maxMilliseconds, milliseconds);
+}
+
+void FrameProfiler::recordFrame(double milliseconds)
+{
+    if (frameTimes.size() < static_cast<size_t>(kNumFramesKept))
+    {
+        frameTimes.push_back(milliseconds);
+        return;
+    }
+
+    frameTimes[static_cast<size_t>(nextFrame)] = milliseconds;
+    nextFrame = (nextFrame + 1) % kNumFramesKept;
+}
+
+double FrameProfiler::getFramePercentile(double percentile)
+{
+    if (frameTimes.empty())
+        return 0.0;
+
+    auto sorted = frameTimes;
+    auto index = static_cast<size_t>(juce::jlimit(0.0, 1.0, percentile / 100.0) * static_cast<double>(sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(index), sorted.end());
+    return sorted[index];
+}
+
+int FrameProfiler::getNumFrames()
+{
+    return static_cast<int>(frameTimes.size());
+}
+
+std::vector<FrameProfiler::PaintStats> FrameProfiler::getPaintStats()
+{
+    std::vector<PaintStats> stats;
+    for (auto& [component, componentStats] : paintStats)
+        stats.push_back(componentStats);
+
+    std::sort(stats.begin(), stats.end(), [](const PaintStats& a, const PaintStats& b)
+    {
+        return a.totalMilliseconds > b.totalMilliseconds;
+    });
+    return stats;
+}
+
+void FrameProfiler::reset()
+{
+    paintStats.clear();
+    frameTimes.clear();
+    nextFrame = 0;
+}
+
+// MARK: - (Overlay)
+
+FrameProfilerOverlay::FrameProfilerOverlay()
+    : lastFrameSeconds(0.0)
+    , framesSinceRepaint(0)
+{
+    setInterceptsMouseClicks(false, false);
+    setAlwaysOnTop(true);
+    setVisible(false);
+}
+
+FrameProfilerOverlay::~FrameProfilerOverlay()
+{
+    FrameProfiler::setEnabled(false);
+}
+
+void FrameProfilerOverlay::toggle()
+{
+    bool show = !isVisible();
+    FrameProfiler::reset();
+    FrameProfiler::setEnabled(show);
+    lastFrameSeconds = 0.0;
+    setVisible(show);
+
+    if (show)
+        vBlankAttachment = juce::VBlankAttachment(this, [this](double timestampSeconds) { onVBlank(timestampSeconds); });
+    else
+        vBlankAttachment = juce::VBlankAttachment();
+}
+
+void FrameProfilerOverlay::onVBlank(double timestampSeconds)
+{
+    if (!isVisible())
+        return;
+
+    // The gap between display callbacks is how long the message thread took to
+    // get round to the next frame
+    if (lastFrameSeconds > 0.0)
+        FrameProfiler::recordFrame((timestampSeconds - lastFrameSeconds) * 1000.0);
+    lastFrameSeconds = timestampSeconds;
+
+    if (++framesSinceRepaint >= kRepaintEveryFrames)
+    {
+        framesSinceRepaint = 0;
+        repaint();
+    }
+}
+
+void FrameProfilerOverlay::paint(juce::Graphics& g)
+{
+    auto stats = FrameProfiler::getPaintStats();
+    auto numLines = 4 + juce::jmin(kMaxComponentsShown, static_cast<int>(stats.size()));
+
+    auto panel = getLocalBounds().removeFromTop(numLines * kLineHeight + 12).reduced(6);
+    g.setColour(juce::Colours::black.withAlpha(0.75f));
+    g.fillRoundedRectangle(panel.toFloat(), 4.0f);
+
+    auto text = panel.reduced(8, 4);
+    g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 12.0f, juce::Font::plain));
+    g.setColour(juce::Colours::white);
+
+    auto drawLine = [&](const juce::String& line)
+    {
+        g.drawText(line, text.removeFromTop(kLineHeight), juce::Justification::centredLeft, true);
+    };
+
+    drawLine("Frame ms over " + juce::String(FrameProfiler::getNumFrames()) + " frames:");
+    drawLine("  p50 " + juce::String(FrameProfiler::getFramePercentile(50.0), 2)
+             + "  p95 " + juce::String(FrameProfiler::getFramePercentile(95.0), 2)
+             + "  p99 " + juce::String(FrameProfiler::getFramePercentile(99.0), 2)
+             + "  max " + juce::String(FrameProfiler::getFramePercentile(100.0), 2));
+    drawLine("Paint ms (total / max / count):");
+
+    for (int i = 0; i < juce::jmin(kMaxComponentsShown, static_cast<int>(stats.size())); ++i)
+    {
+        auto& componentStats = stats[static_cast<size_t>(i)];
+        drawLine("  " + componentStats.name.substring(0, 28).paddedRight(' ', 28)
+                 + juce::String(componentStats.totalMilliseconds, 2).paddedLeft(' ', 8)
+                 + juce::String(componentStats.maxMilliseconds, 2).paddedLeft(' ', 7)
+                 + juce::String(componentStats.numPaints).paddedLeft(' ', 6));
+    }
+
+    drawLine("Ctrl/Cmd+Shift+P to hide");
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+// Paint and frame timing for the message thread. Components opt in by being
+// declared as Profiled<ComponentType>; while the overlay is hidden, profiling
+// costs them one flag check per paint.
+class FrameProfiler
+{
+public:
+    struct PaintStats
+    {
+        juce::String name;
+        int numPaints = 0;
+        double totalMilliseconds = 0.0;
+        double maxMilliseconds = 0.0;
+    };
+
+    static void setEnabled(bool shouldBeEnabled);
+    static bool isEnabled();
+
+    /** Record one paint() call; message thread only */
+    static void recordPaint(const juce::Component* component, const juce::String& name, double milliseconds);
+
+    /** Record the time between two consecutive display frames; message thread only */
+    static void recordFrame(double milliseconds);
+
+    /** @param percentile 0 to 100, over the most recent frames */
+    static double getFramePercentile(double percentile);
+    static int getNumFrames();
+
+    /** Paint statistics, slowest total first */
+    static std::vector<PaintStats> getPaintStats();
+
+    static void reset();
+};
+
+// A component whose paint() calls are timed while profiling is enabled
+template <typename ComponentType>
+class Profiled : public ComponentType
+{
+public:
+    using ComponentType::ComponentType;
+
+    void paint(juce::Graphics& g) override
+    {
+        if (!FrameProfiler::isEnabled())
+        {
+            ComponentType::paint(g);
+            return;
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        ComponentType::paint(g);
+        auto elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        FrameProfiler::recordPaint(this, describe(), elapsed * 1000.0);
+    }
+
+private:
+    juce::String describe() const
+    {
+        if (this->getName().isNotEmpty())
+            return this->getName();
+        if constexpr (std::is_base_of_v<juce::Button, ComponentType>)
+            return "Button \"" + this->getButtonText() + "\"";
+        else if constexpr (std::is_base_of_v<juce::Label, ComponentType>)
+            return "Label \"" + this->getText().substring(0, 24) + "\"";
+        else if constexpr (std::is_base_of_v<juce::Slider, ComponentType>)
+            return "Slider";
+        else if constexpr (std::is_base_of_v<juce::ComboBox, ComponentType>)
+            return "ComboBox \"" + this->getText() + "\"";
+        else
+            return "Component";
+    }
+};
+
+// Shows the slowest-painting components and frame time percentiles over the
+// top of its parent. Doesn't take mouse clicks. Give it no more than its panel
+// size, so its own repaints don't repaint the components under it.
+class FrameProfilerOverlay : public juce::Component
+{
+public:
+    static constexpr int kLineHeight = 16;
+    static constexpr int kMaxComponentsShown = 12;
+    static constexpr int kWidth = 380;
+    static constexpr int kHeight = (4 + kMaxComponentsShown) * kLineHeight + 12;
+
+    FrameProfilerOverlay();
+    ~FrameProfilerOverlay() override;
+
+    void paint(juce::Graphics& g) override;
+
+    /** Show or hide the overlay, enabling profiling only while it's shown */
+    void toggle();
+
+private:
+    juce::VBlankAttachment vBlankAttachment;  // Only attached while shown, so a hidden overlay costs no wakeups
+    double lastFrameSeconds;
+    int framesSinceRepaint;
+
+    void onVBlank(double timestampSeconds);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrameProfilerOverlay)
+};
@@ -0,0 +1,196 @@
+#include "LessonLibrary.h"
+#include "Trace.h"
+
+LessonLibrary::LessonLibrary(const juce::File& directoryToWatch)
+: juce::Thread("Lesson Library")
+, directory(directoryToWatch)
+{
+}
+
+LessonLibrary::~LessonLibrary()
+{
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    notify();
+    stopThread(10000);  // A lesson being converted is finished first
+}
+
+juce::File LessonLibrary::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("ModeTrainer")
+        .getChildFile("Lessons");
+}
+
+const juce::File& LessonLibrary::getDirectory() const
+{
+    return directory;
+}
+
+// MARK: - (Listeners)
+
+void LessonLibrary::addListener(Listener* listener)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    listeners.add(listener);
+    polling = true;
+
+    if (isThreadRunning())
+        notify();
+    else
+        startThread(juce::Thread::Priority::low);
+}
+
+void LessonLibrary::removeListener(Listener* listener)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    listeners.remove(listener);
+    polling = !listeners.isEmpty();
+}
+
+juce::StringArray LessonLibrary::getLessonNames() const
+{
+    const juce::ScopedLock sl(lock);
+    juce::StringArray names;
+    for (const auto& lesson : lessons)
+        names.add(lesson.first);
+    return names;
+}
+
+LessonLibrary::Blocks LessonLibrary::getLessonBlocks(const juce::String& name, int& version) const
+{
+    const juce::ScopedLock sl(lock);
+    auto lesson = lessons.find(name);
+    if (lesson == lessons.end())
+    {
+        version = 0;
+        return {};
+    }
+    version = lesson->second.version;
+    return lesson->second.blocks;
+}
+
+void LessonLibrary::handleAsyncUpdate()
+{
+    std::vector<Change> changes;
+    bool namesChanged = false;
+    {
+        const juce::ScopedLock sl(lock);
+        std::swap(changes, pendingChanges);
+        std::swap(namesChanged, lessonNamesChanged);
+    }
+
+    if (namesChanged)
+        listeners.call([](Listener& listener) { listener.lessonsChanged(); });
+    for (const auto& change : changes)
+        listeners.call([&change](Listener& listener) { listener.lessonChanged(change); });
+}
+
+// MARK: - (Polling)
+
+void LessonLibrary::run()
+{
+    while (!threadShouldExit())
+    {
+        if (!polling)
+        {
+            wait(-1);  // Until a listener is added
+            continue;
+        }
+        scan();
+        wait(kPollMilliseconds);
+    }
+}
+
+void LessonLibrary::scan()
+{
+    TRACE_SCOPE("LessonLibrary::scan");
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.md");
+    juce::StringArray found;
+    bool namesChanged = false;
+    bool anyChanged = false;
+
+    for (const auto& file : files)
+    {
+        if (threadShouldExit())
+            return;
+
+        auto name = file.getFileNameWithoutExtension();
+        found.add(name);
+
+        // Only the thread writes lessons, so it can read them without the lock
+        auto existing = lessons.find(name);
+        bool isNew = existing == lessons.end();
+        if (!isNew && existing->second.modified == file.getLastModificationTime() && existing->second.size == file.getSize())
+            continue;
+
+        Lesson lesson = isNew ? Lesson() : existing->second;
+        Change change;
+        if (!convert(file, lesson, change))
+            continue;
+
+        const juce::ScopedLock sl(lock);
+        lessons[name] = std::move(lesson);
+        if (isNew)
+            namesChanged = true;
+        else if (change.numRemoved > 0 || !change.inserted.empty())
+            pendingChanges.push_back(std::move(change));
+        anyChanged = true;
+    }
+
+    for (auto lesson = lessons.begin(); lesson != lessons.end();)
+    {
+        if (found.contains(lesson->first))
+        {
+            ++lesson;
+            continue;
+        }
+        const juce::ScopedLock sl(lock);
+        lesson = lessons.erase(lesson);
+        namesChanged = true;
+    }
+
+    if (namesChanged || anyChanged)
+    {
+        const juce::ScopedLock sl(lock);
+        lessonNamesChanged = lessonNamesChanged || namesChanged;
+        triggerAsyncUpdate();
+    }
+}
+
+bool LessonLibrary::convert(const juce::File& file, Lesson& lesson, Change& change)
+{
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+    lesson.modified = file.getLastModificationTime();
+
+    juce::MemoryBlock data;
+    if (!file.loadFileAsData(data))
+        return false;
+    lesson.size = static_cast<juce::int64>(data.getSize());
+
+    std::string markdown(static_cast<const char*>(data.getData()), data.getSize());
+    auto previous = lesson.blocks;
+    change.numBlocksConverted = static_cast<int>(converter.convertBlocks(markdown, lesson.blocks));
+
+    // The blocks replaced lie between the unchanged ones at either end
+    auto& blocks = lesson.blocks;
+    auto isSame = [](const MarkdownConverter::Block& a, const MarkdownConverter::Block& b)
+    {
+        return a.hash == b.hash && a.length == b.length;
+    };
+    size_t numSame = juce::jmin(previous.size(), blocks.size());
+    size_t prefix = 0;
+    while (prefix < numSame && isSame(previous[prefix], blocks[prefix]))
+        ++prefix;
+    size_t suffix = 0;
+    while (suffix < numSame - prefix && isSame(previous[previous.size() - 1 - suffix], blocks[blocks.size() - 1 - suffix]))
+        ++suffix;
+
+    change.lesson = file.getFileNameWithoutExtension();
+    change.firstBlock = static_cast<int>(prefix);
+    change.numRemoved = static_cast<int>(previous.size() - prefix - suffix);
+    change.inserted.assign(blocks.begin() + static_cast<std::ptrdiff_t>(prefix), blocks.end() - static_cast<std::ptrdiff_t>(suffix));
+    change.version = change.numRemoved > 0 || !change.inserted.empty() ? ++lesson.version : lesson.version;
+    change.milliseconds = juce::Time::getMillisecondCounterHiRes() - startTime;
+    return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include "MarkdownConverter.h"
+#include <atomic>
+#include <map>
+#include <vector>
+
+// Lessons written as Markdown files in a content directory, converted to HTML
+// and kept current while a teacher edits them. A background thread polls the
+// directory, as JUCE has no portable file watcher; a file whose size or
+// modification time changed is re-read and converted block by block (see
+// MarkdownConverter::convertBlocks), so only the blocks that were edited are
+// converted again and listeners are sent just the range of blocks replaced.
+//
+// The thread only polls while something listens, so the library costs nothing
+// while no lesson is on screen. Share one through juce::SharedResourcePointer
+// to keep the converted blocks between uses.
+class LessonLibrary : private juce::Thread,
+                      private juce::AsyncUpdater
+{
+public:
+    static constexpr int kPollMilliseconds = 250;
+
+    using Blocks = std::vector<MarkdownConverter::Block>;
+
+    // Blocks [firstBlock, firstBlock + numRemoved) of a lesson replaced by inserted
+    struct Change
+    {
+        juce::String lesson;
+        int version = 0;             // The lesson's version after the change, as given by getLessonBlocks()
+        int firstBlock = 0;
+        int numRemoved = 0;
+        Blocks inserted;
+        int numBlocksConverted = 0;  // Blocks whose markdown wasn't in the previous version
+        double milliseconds = 0.0;   // Reading and converting the file
+    };
+
+    // Called on the message thread
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+        virtual void lessonsChanged() = 0;  // Lessons added or removed
+        virtual void lessonChanged(const Change& change) = 0;
+    };
+
+    explicit LessonLibrary(const juce::File& directoryToWatch = getDefaultDirectory());
+    ~LessonLibrary() override;
+
+    static juce::File getDefaultDirectory();
+    const juce::File& getDirectory() const;
+
+    // Message thread. The first listener starts polling and the last one removed stops it.
+    void addListener(Listener* listener);
+    void removeListener(Listener* listener);
+
+    /** The lessons converted so far, sorted: each file's name without .md */
+    juce::StringArray getLessonNames() const;
+
+    /**
+     * A lesson's blocks as last converted
+     * @param name Lesson name
+     * @param version Set to the lesson's version, which each Change increments
+     * @return Blocks in order; empty if there is no such lesson
+     */
+    Blocks getLessonBlocks(const juce::String& name, int& version) const;
+
+private:
+    struct Lesson
+    {
+        juce::Time modified;
+        juce::int64 size = 0;
+        int version = 0;
+        Blocks blocks;
+    };
+
+    juce::File directory;
+    juce::ListenerList<Listener> listeners;
+    std::atomic<bool> polling { false };
+    MarkdownConverter converter;  // Used by the thread
+
+    // Written by the thread, read on the message thread
+    juce::CriticalSection lock;
+    std::map<juce::String, Lesson> lessons;
+    std::vector<Change> pendingChanges;
+    bool lessonNamesChanged = false;
+
+    void run() override;
+    void scan();
+
+    /** Convert a file's new contents; false if it couldn't be read */
+    bool convert(const juce::File& file, Lesson& lesson, Change& change);
+
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LessonLibrary)
+};
@@ -1,6 +1,8 @@
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "MainComponent.h"
+#include "CommandLineTools.h"
+#include "StartupTrace.h"
 
 class ModeTrainerApplication : public juce::JUCEApplication
 {
@@ -13,8 +15,20 @@ public:
 
     void initialise(const juce::String& commandLine) override
     {
+        // Headless tools run instead of the GUI
+        int exitCode = 0;
+        if (CommandLineTools::runIfRequested(commandLine, exitCode))
+        {
+            setApplicationReturnValue(exitCode);
+            quit();
+            return;
+        }
+
         // This method is where you should put your application's initialisation code..
-        mainWindow.reset(new MainWindow(getApplicationName()));
+        StartupTrace::begin();
+        
+        mainWindow.reset(new MainWindow(getApplicationName(), MainComponent::LaunchOptions::fromCommandLine(commandLine)));
+        StartupTrace::mark("Main window shown");
     }
 
     void shutdown() override
@@ -40,7 +54,7 @@ public:
     class MainWindow : public juce::DocumentWindow
     {
     public:
-        MainWindow(juce::String name)
+        MainWindow(juce::String name, const MainComponent::LaunchOptions& options)
             : DocumentWindow(name,
                            juce::Desktop::getInstance().getDefaultLookAndFeel()
                                                        .findColour(juce::ResizableWindow::backgroundColourId),
@@ -48,7 +62,7 @@ public:
         {
             setUsingNativeTitleBar(true);
             
-            mainComponent = new MainComponent();
+            mainComponent = new MainComponent(options);
             setContentOwned(mainComponent, true);
             
 
@@ -56,7 +70,7 @@ public:
             setFullScreen(true);
 #else
             setResizable(true, true);
-            centreWithSize(800, 600);
+            centreWithSize(MainComponent::kDefaultWindowWidth, MainComponent::kDefaultWindowHeight);
 #endif
 
             setVisible(true);
@@ -1,17 +1,47 @@
 #include "MainComponent.h"
 #include "AboutDialog.h"
+#include "RealtimeAudit.h"
+#include <algorithm>
 
-MainComponent::MainComponent()
+MainComponent::LaunchOptions MainComponent::LaunchOptions::fromCommandLine(const juce::String& commandLine)
+{
+    juce::ArgumentList args("ModeTrainer", commandLine);
+    LaunchOptions options;
+    if (args.containsOption("--seed"))
+        options.sessionSeed = args.getValueForOption("--seed").getLargeIntValue();
+    if (args.containsOption("--suspend-after"))
+        options.idleSuspendSeconds = args.getValueForOption("--suspend-after").getIntValue();
+    options.tuneBufferSize = args.containsOption("--tune-buffer");
+    options.trace = args.containsOption("--trace");
+    return options;
+}
+
+MainComponent::MainComponent(const LaunchOptions& options)
 : audioEngine()
-, random(juce::Time::currentTimeMillis())
-, score(0)
-, totalQuestions(0)
-, currentMode(AudioEngine::ModeType::Ionian)
-, lastPlayedMode(AudioEngine::ModeType::Ionian)
-, gameActive(false)
-, isPracticeMode(false)
+, random(options.sessionSeed + 1)
+, quiz(audioEngine, quizScheduler, options.sessionSeed)
+, audioReady(false)
+, firstPaintDone(false)
+, tuneBufferSize(options.tuneBufferSize)
 {
+    if (options.trace)
+        Trace::setEnabled(true);
+    
+    session.seed = options.sessionSeed;
+    session.started = juce::Time::getCurrentTime();
+    audioEngine.setRandomSeed(options.sessionSeed);
+    
+    // Nothing needs the device while idle; it's reopened by the next thing played
+    deviceSuspender.setIdleTimeout(options.idleSuspendSeconds);
+    deviceSuspender.canSuspend = [this] { return !audioEngine.isCurrentlyPlaying() && !bufferSizeTuner.isTuning(); };
+    deviceSuspender.onSuspended = [this] { visualizer.setPaused(true); };
+    
+    // Each tuned size is a new format for the session
+    bufferSizeTuner.onTuned = [this](int) { recordDeviceFormat(); };
+    
     setSize(kDefaultWindowWidth, kDefaultWindowHeight);
+    setOpaque(true); // paint() fills everything, so nothing behind needs repainting
+    setWantsKeyboardFocus(true);
     
     // Set up title label
     titleLabel.setText("Musical Mode Trainer", juce::dontSendNotification);
@@ -48,15 +78,11 @@ MainComponent::MainComponent()
     for (size_t i = 0; i < modes.size(); ++i)
     {
         auto mode = modes[i];
-        auto button = std::make_unique<juce::TextButton>();
+        auto button = std::make_unique<Profiled<juce::TextButton>>();
         button->setButtonText(audioEngine.getModeName(mode));
         button->onClick = [this, i] { 
             // Use index to get mode from current order
-            auto mode = modeOrder[i];
-            if (gameActive) 
-                guessMode(mode); 
-            else 
-                practiceMode(mode); 
+            modeChosen(modeOrder[i]);
         };
         button->setEnabled(true); // Always enabled for practice mode
         modeButtons.push_back(std::move(button));
@@ -75,13 +101,15 @@ MainComponent::MainComponent()
     statusLabelFont.setHeight(16.0f);
     statusLabelFont.setBold(true);
     statusLabel.setFont(statusLabelFont);
-    showInstructionsText();
+    quiz.onStatusChanged = [this] { quizStatusChanged(); };
+    quiz.onEvent = [this](const juce::String& action, juce::NamedValueSet properties) { recordEvent(action, std::move(properties)); };
+    quizStatusChanged();
     addAndMakeVisible(statusLabel);
     
     // Set up root note slider (now using note indices instead of frequencies)
     // Range: 12-24 represents A4 to A5 (one octave)
-    rootNoteSlider.setRange(12.0, 24.0, 1.0); 
-    rootNoteSlider.setValue(15.0); // C5 (15 semitones above A3)
+    rootNoteSlider.setRange(QuizSession::kMinRootNoteIndex, QuizSession::kMaxRootNoteIndex, 1.0);
+    rootNoteSlider.setValue(quiz.getSettings().rootNoteIndex); // C5 (15 semitones above A3)
     rootNoteSlider.setSliderStyle(juce::Slider::LinearHorizontal);
     rootNoteSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, true, 60, 20); // true = read-only
     
@@ -90,6 +118,7 @@ MainComponent::MainComponent()
         return frequencyToNoteName(noteNameToFrequency(static_cast<int>(value)));
     };
     
+    rootNoteSlider.onValueChange = [this] { updateQuizSettings(); };
     addAndMakeVisible(rootNoteSlider);
     
     rootNoteLabel.setText("Root Note:", juce::dontSendNotification);
@@ -105,13 +134,21 @@ MainComponent::MainComponent()
     speedSlider.setSliderStyle(juce::Slider::LinearHorizontal);
     speedSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, true, 60, 20); // true = read-only
     speedSlider.setTextValueSuffix("x");
-    speedSlider.onValueChange = [this] { audioEngine.setPlaybackSpeed(static_cast<float>(speedSlider.getValue())); };
+    speedSlider.onValueChange = [this]
+    {
+        audioEngine.setPlaybackSpeed(static_cast<float>(speedSlider.getValue()));
+        recordEvent("speed", {{ "value", speedSlider.getValue() }});
+    };
     addAndMakeVisible(speedSlider);
     
     speedLabel.setText("Speed:", juce::dontSendNotification);
     speedLabel.setJustificationType(juce::Justification::centredRight);
     addAndMakeVisible(speedLabel);
     
+    // User-defined patterns are listed after the built-in ones
+    for (auto& error : audioEngine.loadUserPatterns(AudioEngine::getUserPatternFile()))
+        juce::Logger::writeToLog("Patterns.txt: " + error);
+    
     // Set up pattern selection ComboBox
     auto patterns = audioEngine.getAllPatterns();
     for (size_t i = 0; i < patterns.size(); ++i)
@@ -119,12 +156,62 @@ MainComponent::MainComponent()
         patternComboBox.addItem(audioEngine.getPatternName(patterns[i]), static_cast<int>(i + 1));
     }
     patternComboBox.setSelectedId(1); // Default to Ascending
+    patternComboBox.onChange = [this] { updateQuizSettings(); };
     addAndMakeVisible(patternComboBox);
     
     patternLabel.setText("Pattern:", juce::dontSendNotification);
     patternLabel.setJustificationType(juce::Justification::centredRight);
     addAndMakeVisible(patternLabel);
     
+    // Set up timbre selection ComboBox
+    auto timbres = audioEngine.getAllTimbres();
+    for (size_t i = 0; i < timbres.size(); ++i)
+    {
+        timbreComboBox.addItem(audioEngine.getTimbreName(timbres[i]), static_cast<int>(i + 1));
+    }
+    timbreComboBox.setSelectedId(1, juce::dontSendNotification); // Default to Pure
+    timbreComboBox.onChange = [this]
+    {
+        auto timbres = audioEngine.getAllTimbres();
+        auto index = static_cast<size_t>(timbreComboBox.getSelectedId() - 1);
+        if (index < timbres.size())
+        {
+            audioEngine.setTimbre(timbres[index]);
+            recordEvent("timbre", {{ "name", audioEngine.getTimbreName(timbres[index]) }});
+        }
+    };
+    addAndMakeVisible(timbreComboBox);
+    
+    loudnessToggle.setButtonText("Even loudness");
+    loudnessToggle.setToggleState(true, juce::dontSendNotification); // Low notes as loud as high ones by default
+    loudnessToggle.setClickingTogglesState(true);
+    loudnessToggle.onClick = [this]
+    {
+        audioEngine.setLoudnessCompensationEnabled(loudnessToggle.getToggleState());
+        recordEvent("loudness", {{ "on", loudnessToggle.getToggleState() }});
+    };
+    audioEngine.setLoudnessCompensationEnabled(loudnessToggle.getToggleState());
+    addAndMakeVisible(loudnessToggle);
+    
+    timbreLabel.setText("Sound:", juce::dontSendNotification);
+    timbreLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(timbreLabel);
+    
+    // Set up MIDI device selection
+    midiLabel.setText("MIDI:", juce::dontSendNotification);
+    midiLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(midiLabel);
+    
+    midiInputComboBox.onChange = [this] { midiInputChanged(); };
+    midiOutputComboBox.onChange = [this] { midiOutputChanged(); };
+    addAndMakeVisible(midiInputComboBox);
+    addAndMakeVisible(midiOutputComboBox);
+    refreshMidiDeviceLists();
+    midiDeviceListConnection = juce::MidiDeviceListConnection::make([this] { refreshMidiDeviceLists(); });
+    
+    // MIDI answer keys take the same path as the mode buttons
+    midiController.onModeKeyPressed = [this](AudioEngine::ModeType mode) { modeChosen(mode); };
+    
     // Set up randomize buttons checkbox
     randomizeModeButtonsCheckbox.setButtonText("Randomize button order on each turn");
     randomizeModeButtonsCheckbox.setToggleState(false, juce::dontSendNotification); // Off by default
@@ -153,6 +240,7 @@ MainComponent::MainComponent()
     
     // Ensure it's clickable
     randomizeRootCheckbox.setClickingTogglesState(true);
+    randomizeRootCheckbox.onClick = [this] { updateQuizSettings(); };
     
     addAndMakeVisible(randomizeRootCheckbox);
     
@@ -161,6 +249,50 @@ MainComponent::MainComponent()
     rootSelectionLabel.setJustificationType(juce::Justification::centredRight);
     addAndMakeVisible(rootSelectionLabel);
     
+    // Set up per-degree panning toggle
+    speakersLabel.setText("Speakers:", juce::dontSendNotification);
+    speakersLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(speakersLabel);
+    
+    degreePanningToggle.setButtonText("Spread notes by pitch");
+    degreePanningToggle.setToggleState(false, juce::dontSendNotification); // Every speaker plays every note by default
+    degreePanningToggle.setClickingTogglesState(true);
+    degreePanningToggle.onClick = [this]
+    {
+        audioEngine.setDegreePanningEnabled(degreePanningToggle.getToggleState());
+        recordEvent("panning", {{ "on", degreePanningToggle.getToggleState() }});
+    };
+    addAndMakeVisible(degreePanningToggle);
+    
+    // Set up reverb controls
+    reverbLabel.setText("Reverb:", juce::dontSendNotification);
+    reverbLabel.setJustificationType(juce::Justification::centredRight);
+    addAndMakeVisible(reverbLabel);
+    
+    reverbToggle.setToggleState(false, juce::dontSendNotification); // Dry by default
+    reverbToggle.setClickingTogglesState(true);
+    reverbToggle.onClick = [this]
+    {
+        audioEngine.getReverb().setEnabled(reverbToggle.getToggleState());
+        recordEvent("reverb", {{ "on", reverbToggle.getToggleState() }});
+    };
+    updateReverbToggleText();
+    addAndMakeVisible(reverbToggle);
+    
+    reverbLoadButton.setButtonText("Load Room...");
+    reverbLoadButton.onClick = [this] { chooseReverbImpulseResponse(); };
+    addAndMakeVisible(reverbLoadButton);
+    
+    reverbTailToggle.setButtonText("Short tail (less CPU)");
+    reverbTailToggle.setToggleState(audioEngine.getReverb().isTailLimited(), juce::dontSendNotification);
+    reverbTailToggle.setClickingTogglesState(true);
+    reverbTailToggle.onClick = [this]
+    {
+        audioEngine.getReverb().setTailLimited(reverbTailToggle.getToggleState());
+        recordEvent("reverbTail", {{ "on", reverbTailToggle.getToggleState() }});
+    };
+    addAndMakeVisible(reverbTailToggle);
+    
     // Set up light mode toggle
 	colorsLabel.setText("Colors:", juce::dontSendNotification);
 	colorsLabel.setJustificationType(juce::Justification::centredRight);
@@ -191,18 +323,44 @@ MainComponent::MainComponent()
     optionsLabel.setFont(difficultyFont);
     addAndMakeVisible(optionsLabel);
     
+    // Labels whose text never changes are cached as images, so repainting the
+    // window around them doesn't redraw their text
+    for (auto* label : { &titleLabel, &optionsLabel, &rootNoteLabel, &rootSelectionLabel, &speedLabel,
+                         &patternLabel, &timbreLabel, &modeButtonsLabel, &colorsLabel, &midiLabel,
+                         &speakersLabel, &reverbLabel })
+        label->setBufferedToImage(true);
+    
+    // The starting settings, so a replay doesn't depend on the defaults of the day
+    recordEvent("speed", {{ "value", speedSlider.getValue() }});
+    recordEvent("timbre", {{ "name", audioEngine.getTimbreName(audioEngine.getTimbre()) }});
+    recordEvent("loudness", {{ "on", loudnessToggle.getToggleState() }});
+    recordEvent("panning", {{ "on", degreePanningToggle.getToggleState() }});
+    recordEvent("reverbRoom", {{ "file", juce::String() }});
+    recordEvent("reverbTail", {{ "on", reverbTailToggle.getToggleState() }});
+    recordEvent("reverb", {{ "on", reverbToggle.getToggleState() }});
+    
+    addChildComponent(visualizer);  // Shown by resized() when there's room
+    addChildComponent(frameProfilerOverlay);
+    
+    // Nothing can be played until the audio device is open
+    setPlayControlsEnabled(false);
+    updateQuizSettings();
+    setStatusWithText(QuizSession::Status::instructions, "Opening audio device...");
+    
     // Some platforms require permissions to open input channels so request that here
     if (juce::RuntimePermissions::isRequired(juce::RuntimePermissions::recordAudio)
         && !juce::RuntimePermissions::isGranted(juce::RuntimePermissions::recordAudio))
     {
         juce::RuntimePermissions::request(juce::RuntimePermissions::recordAudio,
-                                          [&](bool granted) { setAudioChannels(granted ? 2 : 0, 2); });
+                                          [this](bool granted) { startAudioDevice(granted ? 2 : 0); });
     }
     else
     {
-        setAudioChannels(0, 2);
+        startAudioDevice(0);
     }
     
+    StartupTrace::mark("Main component constructed");
+    
     // Force initial layout to ensure buttons are visible
     juce::MessageManager::callAsync([this]()
                                     {
@@ -217,6 +375,7 @@ MainComponent::MainComponent()
         
         resized();
         repaint();
+        grabKeyboardFocus(); // So shortcuts work before anything is clicked
     });
 }
 
@@ -226,16 +385,51 @@ MainComponent::~MainComponent()
     patternComboBox.setLookAndFeel(nullptr);
     setLookAndFeel(nullptr);
     
+    // The device manager mustn't be shut down while it's still being opened
+    if (audioStartupThread.joinable())
+        audioStartupThread.join();
+    deviceSuspender.shutdown();
+    bufferSizeTuner.shutdown();
+    
     shutdownAudio();
+    
+    // Whatever led up to quitting, e.g. a stutter just before it
+    if (Trace::isEnabled())
+    {
+        auto traceFile = Trace::getDefaultFile();
+        if (Trace::writeChromeJson(traceFile))
+            juce::Logger::writeToLog("Trace written to " + traceFile.getFullPathName());
+    }
+    
+    // Runs where nothing was ever played aren't worth keeping
+    for (auto& event : session.events)
+    {
+        if (event.action == "play")
+        {
+            session.save(session.getDefaultFile());
+            break;
+        }
+    }
 }
 
 void MainComponent::paint(juce::Graphics& g)
 {
+    TRACE_SCOPE("MainComponent::paint");
     g.fillAll(getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
+    
+    if (!firstPaintDone)
+    {
+        firstPaintDone = true;
+        StartupTrace::mark("First paint");
+    }
 }
 
 void MainComponent::resized()
 {
+    TRACE_SCOPE("MainComponent::resized");
+    frameProfilerOverlay.setBounds(getLocalBounds().removeFromTop(FrameProfilerOverlay::kHeight)
+                                                    .removeFromRight(FrameProfilerOverlay::kWidth));
+    
     auto area = getLocalBounds();
     auto windowHorizontalMargin = 24;
     
@@ -313,20 +507,92 @@ void MainComponent::resized()
     layOutLabelAndControl(rootSelectionLabel, randomizeRootCheckbox);
     layOutLabelAndControl(speedLabel, speedSlider);
     layOutLabelAndControl(patternLabel, patternComboBox);
+    
+    // Timbre and loudness compensation side by side
+    auto timbreArea = area.removeFromTop(35).reduced(24, 0);
+    timbreLabel.setBounds(timbreArea.removeFromLeft(100));
+    auto timbreControlWidth = (timbreArea.getWidth() - controlSpacing) / 2;
+    timbreComboBox.setBounds(timbreArea.removeFromLeft(timbreControlWidth));
+    timbreArea.removeFromLeft(controlSpacing);
+    loudnessToggle.setBounds(timbreArea);
+    
+    // MIDI input and output side by side
+    auto midiArea = area.removeFromTop(35).reduced(24, 0);
+    midiLabel.setBounds(midiArea.removeFromLeft(100));
+    auto midiComboWidth = (midiArea.getWidth() - controlSpacing) / 2;
+    midiInputComboBox.setBounds(midiArea.removeFromLeft(midiComboWidth).reduced(0, 6));
+    midiArea.removeFromLeft(controlSpacing);
+    midiOutputComboBox.setBounds(midiArea.reduced(0, 6));
+    
+    layOutLabelAndControl(speakersLabel, degreePanningToggle);
+    
+    // Reverb toggle, room loading and tail length side by side
+    auto reverbArea = area.removeFromTop(35).reduced(24, 0);
+    reverbLabel.setBounds(reverbArea.removeFromLeft(100));
+    auto reverbControlWidth = (reverbArea.getWidth() - 2*controlSpacing) / 3;
+    reverbToggle.setBounds(reverbArea.removeFromLeft(reverbControlWidth));
+    reverbArea.removeFromLeft(controlSpacing);
+    reverbLoadButton.setBounds(reverbArea.removeFromLeft(reverbControlWidth).reduced(0, 5));
+    reverbArea.removeFromLeft(controlSpacing);
+    reverbTailToggle.setBounds(reverbArea);
 	layOutLabelAndControl(modeButtonsLabel, randomizeModeButtonsCheckbox);
 	layOutLabelAndControl(colorsLabel, lightModeToggle);
     
+    // Visualizer takes whatever height is left, if there's enough to be useful
+    area.removeFromTop(10);
+    auto visualizerArea = area.reduced(windowHorizontalMargin, 0).withTrimmedBottom(12);
+    visualizer.setBounds(visualizerArea);
+    visualizer.setVisible(visualizerArea.getHeight() >= 60);
+    
 	// Small layout tweaks
     patternComboBox.setBounds(patternComboBox.getBounds().reduced(0, 6));
+    timbreComboBox.setBounds(timbreComboBox.getBounds().reduced(0, 6));
     auto checkboxNudgeX = -4;
     auto checkboxNudgeY = 1;
     randomizeRootCheckbox.setBounds(randomizeRootCheckbox.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
 	randomizeModeButtonsCheckbox.setBounds(randomizeModeButtonsCheckbox.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
 	lightModeToggle.setBounds(lightModeToggle.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
+    degreePanningToggle.setBounds(degreePanningToggle.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
+    reverbToggle.setBounds(reverbToggle.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
+    loudnessToggle.setBounds(loudnessToggle.getBounds().translated(checkboxNudgeX, checkboxNudgeY));
+}
+
+bool MainComponent::keyPressed(const juce::KeyPress& key)
+{
+    if (key == juce::KeyPress('p', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        frameProfilerOverlay.toggle();
+        return true;
+    }
+    if (key == juce::KeyPress('t', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        toggleTracing();
+        return true;
+    }
+    return false;
+}
+
+void MainComponent::toggleTracing()
+{
+    // The first press starts recording; the next writes what was recorded and stops
+    if (!Trace::isEnabled())
+    {
+        Trace::setEnabled(true);
+        juce::Logger::writeToLog("Tracing started");
+        return;
+    }
+    
+    Trace::setEnabled(false);
+    auto traceFile = Trace::getDefaultFile();
+    if (Trace::writeChromeJson(traceFile))
+        juce::Logger::writeToLog("Trace written to " + traceFile.getFullPathName());
+    else
+        juce::Logger::writeToLog("Couldn't write " + traceFile.getFullPathName());
 }
 
 void MainComponent::showAboutDialog()
 {
+    TRACE_SCOPE("MainComponent::showAboutDialog");
     juce::DialogWindow::LaunchOptions options;
     options.content.setOwned(new AboutDialog());
     options.content->setSize(600, 500);
@@ -340,9 +606,9 @@ void MainComponent::showAboutDialog()
     options.launchAsync();
 }
 
-void MainComponent::setStatusWithText(GameStatus status, juce::String text)
+void MainComponent::setStatusWithText(QuizSession::Status status, juce::String text)
 {
-	gameStatus = status;
+	displayedStatus = status;
 	statusLabel.setText(text, juce::dontSendNotification);
 	updateStatusLabelColour();
 }
@@ -351,23 +617,23 @@ void MainComponent::updateStatusLabelColour()
 {
 	juce::Colour textColor = getLookAndFeel().findColour(juce::Label::textColourId);
 	CustomLookAndFeel &lookAndFeel = currentLookAndFeel.get();
-	switch (gameStatus) {
-		case GameStatus::instructions:
+	switch (displayedStatus) {
+		case QuizSession::Status::instructions:
 			textColor = lookAndFeel.getInstructionsColour();
 			break;
-		case GameStatus::playingForPractice:
+		case QuizSession::Status::playingForPractice:
 			textColor = lookAndFeel.getPlayingForPracticeColour();
 			break;
-		case GameStatus::playingForGuess:
+		case QuizSession::Status::playingForGuess:
 			textColor = lookAndFeel.getPlayingForGuessColour();
 			break;
-		case GameStatus::waitingForGuess:
+		case QuizSession::Status::waitingForGuess:
 			textColor = lookAndFeel.getWaitingForGuessColour();
 			break;
-		case GameStatus::correctGuess:
+		case QuizSession::Status::correctGuess:
 			textColor = lookAndFeel.getCorrectGuessColour();
 			break;
-		case GameStatus::incorrectGuess:
+		case QuizSession::Status::incorrectGuess:
 			textColor = lookAndFeel.getIncorrectGuessColour();
 			break;
 		default:
@@ -378,64 +644,52 @@ void MainComponent::updateStatusLabelColour()
 
 // MARK: - (Game play)
 
-void MainComponent::guessMode(AudioEngine::ModeType guessedMode)
+void MainComponent::modeChosen(AudioEngine::ModeType mode)
 {
-    if (!gameActive)
-        return;
+    TRACE_SCOPE("MainComponent::modeChosen");
+    if (!audioReady)
+        return; // MIDI answers can arrive before the device is open
     
-    totalQuestions++;
-    bool correct = (guessedMode == currentMode);
+    bool answering = quiz.isQuestionActive();
+    if (!quiz.chooseMode(mode))
+        return;
     
-    if (correct)
+    if (answering)
     {
-        score++;
-		setStatusWithText(GameStatus::correctGuess, "Correct! That was " + audioEngine.getModeName(currentMode) + ".");
+        // Every degree can be marked now it's been answered
+        visualizer.setScale(audioEngine.getScaleFrequencies(quiz.getCurrentMode(), quiz.getCurrentRootFrequency()));
     }
     else
     {
-		setStatusWithText(GameStatus::incorrectGuess, "Incorrect. That was " + audioEngine.getModeName(currentMode) + 
-						  ", you guessed " + audioEngine.getModeName(guessedMode) + ".");
+        ensureAudioRunning();
+        visualizer.setScale(audioEngine.getScaleFrequencies(mode, static_cast<float>(noteNameToFrequency(quiz.getSettings().rootNoteIndex))));
     }
     
-    // Update score display
-    scoreLabel.setText("Score: " + juce::String(score) + "/" + juce::String(totalQuestions) + 
-                       " (" + juce::String(static_cast<int>((static_cast<float>(score) / totalQuestions) * 100)) + "%)", 
-                       juce::dontSendNotification);
-    
-    gameActive = false;
-    
-    // After a short delay, show the instruction for next turn
-    juce::Timer::callAfterDelay(2000, [this]() {
-        if (!gameActive) { // Only update if still not in game
-			showInstructionsText();
-        }
-    });
-    
     // Buttons stay enabled for practice mode
 }
 
-void MainComponent::showInstructionsText()
+void MainComponent::quizStatusChanged()
 {
-	setStatusWithText(GameStatus::instructions, "Click \"Play Random Scale\" to test your knowledge, or click any mode button to hear that scale.");
+    setStatusWithText(quiz.getStatus(), quiz.getStatusText());
+    
+    // Update score display
+    int score = quiz.getScore();
+    int totalQuestions = quiz.getNumAnswered();
+    if (totalQuestions == 0)
+        scoreLabel.setText("Score: 0/0", juce::dontSendNotification);
+    else
+        scoreLabel.setText("Score: " + juce::String(score) + "/" + juce::String(totalQuestions) + 
+                           " (" + juce::String(static_cast<int>((static_cast<float>(score) / totalQuestions) * 100)) + "%)", 
+                           juce::dontSendNotification);
 }
 
-void MainComponent::practiceMode(AudioEngine::ModeType mode)
+void MainComponent::updateQuizSettings()
 {
-    if (audioEngine.isCurrentlyPlaying() || gameActive)
-        return;
-    
-    // Convert note index to frequency
-    int noteIndex = static_cast<int>(rootNoteSlider.getValue());
-    float rootFreq = static_cast<float>(noteNameToFrequency(noteIndex));
-    audioEngine.onPlaybackFinished = [this]() {
-        // Show instructions when playback finishes
-        if (!gameActive && !audioEngine.isCurrentlyPlaying()) {
-            showInstructionsText();
-        }
-    };
-    audioEngine.playMode(mode, rootFreq, AudioEngine::PlaybackPattern::Ascending);
-    
-	setStatusWithText(GameStatus::playingForPractice, "Playing " + audioEngine.getModeName(mode) + "... Try to remember how this sounds...");
+    QuizSession::Settings settings;
+    settings.rootNoteIndex = static_cast<int>(rootNoteSlider.getValue());
+    settings.randomizeRoot = randomizeRootCheckbox.getToggleState();
+    settings.pattern = getSelectedPattern();
+    quiz.setSettings(settings);
 }
 
 AudioEngine::PlaybackPattern MainComponent::getSelectedPattern() const
@@ -455,6 +709,7 @@ AudioEngine::PlaybackPattern MainComponent::getSelectedPattern() const
 void MainComponent::randomizeButtonOrder()
 {
     auto modes = audioEngine.getAllModes();
+    auto previousOrder = modeOrder;
     
     if (randomizeModeButtonsCheckbox.getToggleState())
     {
@@ -474,10 +729,11 @@ void MainComponent::randomizeButtonOrder()
         modeOrder = modes;
     }
     
-    // Update button text to match current order
+    // Update the text of buttons whose mode moved, so only they repaint
     for (size_t i = 0; i < modeButtons.size() && i < modeOrder.size(); ++i)
     {
-        modeButtons[i]->setButtonText(audioEngine.getModeName(modeOrder[i]));
+        if (modeOrder[i] != previousOrder[i])
+            modeButtons[i]->setButtonText(audioEngine.getModeName(modeOrder[i]));
     }
 }
 
@@ -485,70 +741,33 @@ void MainComponent::randomizeButtonOrder()
 
 void MainComponent::playRandomScale()
 {
-    if (audioEngine.isCurrentlyPlaying())
-        return;
-    
-    auto modes = audioEngine.getAllModes();
+    TRACE_SCOPE("MainComponent::playRandomScale");
     
-    // Avoid playing the same mode twice in a row
-    AudioEngine::ModeType newMode;
-    do {
-        int randomIndex = random.nextInt(static_cast<int>(modes.size()));
-        newMode = modes[randomIndex];
-    } while (newMode == lastPlayedMode && modes.size() > 1);
-    
-    currentMode = newMode;
-    lastPlayedMode = currentMode;
+    // The sound starts first; everything after this only updates the window
+    if (!quiz.playQuestion())
+        return;
+    ensureAudioRunning();
     
-    // Handle root pitch randomization
-    float rootFreq;
+    // Update slider to reflect a randomly chosen root
     if (randomizeRootCheckbox.getToggleState())
-    {
-        // Generate random note index within slider range
-        double minNote = rootNoteSlider.getMinimum();
-        double maxNote = rootNoteSlider.getMaximum();
-        int randomNoteIndex = static_cast<int>(minNote + random.nextDouble() * (maxNote - minNote));
-        
-        // Update slider to reflect the randomly chosen value
-        rootNoteSlider.setValue(randomNoteIndex, juce::dontSendNotification);
-        
-        // Convert note index to frequency
-        rootFreq = static_cast<float>(noteNameToFrequency(randomNoteIndex));
-    }
-    else
-    {
-        // Convert current slider value (note index) to frequency
-        int noteIndex = static_cast<int>(rootNoteSlider.getValue());
-        rootFreq = static_cast<float>(noteNameToFrequency(noteIndex));
-    }
+        rootNoteSlider.setValue(quiz.getSettings().rootNoteIndex, juce::dontSendNotification);
     
-    auto selectedPattern = getSelectedPattern();
-    audioEngine.onPlaybackFinished = [this]() {
-        statusLabel.setText("", juce::dontSendNotification);
-		setStatusWithText(GameStatus::waitingForGuess, "Click a mode button to enter your answer...");
-    };
-    audioEngine.playMode(currentMode, rootFreq, selectedPattern);
-    
-    gameActive = true;
-	setStatusWithText(GameStatus::playingForGuess, "Playing... Listen and select your answer below...");
+    // Marking every degree would give the answer away, so only the root until it's guessed
+    visualizer.setScale({ quiz.getCurrentRootFrequency() });
     
     // Randomize button order if checkbox is checked
     randomizeButtonOrder();
     
-    // Enable mode buttons
+    // Enable mode buttons; each repaints itself only if its state changes
     for (auto& button : modeButtons)
         button->setEnabled(true);
-    
-    // Force a layout update to make sure buttons appear
-    resized();
-    repaint();
 }
 
 void MainComponent::stopPlaying()
 {
-    audioEngine.stopPlaying();
-    showInstructionsText();
-    repaint();
+    TRACE_SCOPE("MainComponent::stopPlaying");
+    quiz.stop();
+    midiController.notesExpected();  // The note-off
 }
 
 juce::String MainComponent::frequencyToNoteName(double frequency) const
@@ -572,10 +791,7 @@ juce::String MainComponent::frequencyToNoteName(double frequency) const
 
 double MainComponent::noteNameToFrequency(int noteIndex) const
 {
-    // A3 = 220 Hz is note index 0
-    // Each semitone up multiplies frequency by 2^(1/12)
-    double a3 = 220.0;
-    return a3 * pow(2.0, noteIndex / 12.0);
+    return QuizSession::noteIndexToFrequency(noteIndex);
 }
 
 int MainComponent::frequencyToNoteIndex(double frequency) const
@@ -585,16 +801,295 @@ int MainComponent::frequencyToNoteIndex(double frequency) const
     return static_cast<int>(round(12.0 * log2(frequency / a3)));
 }
 
+// MARK: - (MIDI)
+
+void MainComponent::refreshMidiDeviceLists()
+{
+    auto selectedInput = midiInputIdentifiers[midiInputComboBox.getSelectedItemIndex()];
+    auto selectedOutput = midiOutputIdentifiers[midiOutputComboBox.getSelectedItemIndex()];
+    
+    // Item 0 is "none" (empty identifier); the virtual port uses a placeholder identifier
+    auto fillComboBox = [](juce::ComboBox& comboBox, juce::StringArray& identifiers,
+                           const juce::Array<juce::MidiDeviceInfo>& devices,
+                           const juce::String& noneText, const juce::String& selected) {
+        comboBox.clear(juce::dontSendNotification);
+        identifiers.clear();
+        
+        comboBox.addItem(noneText, 1);
+        identifiers.add({});
+#if ! JUCE_WINDOWS
+        comboBox.addItem("Virtual port (" + juce::String(MidiController::kVirtualPortName) + ")", 2);
+        identifiers.add("virtual");
+#endif
+        for (auto& device : devices)
+        {
+            comboBox.addItem(device.name, identifiers.size() + 1);
+            identifiers.add(device.identifier);
+        }
+        
+        comboBox.setSelectedItemIndex(juce::jmax(0, identifiers.indexOf(selected)), juce::dontSendNotification);
+    };
+    
+    fillComboBox(midiInputComboBox, midiInputIdentifiers, midiController.getAvailableInputs(), "No MIDI input", selectedInput);
+    fillComboBox(midiOutputComboBox, midiOutputIdentifiers, midiController.getAvailableOutputs(), "No MIDI output", selectedOutput);
+}
+
+void MainComponent::midiInputChanged()
+{
+    auto identifier = midiInputIdentifiers[midiInputComboBox.getSelectedItemIndex()];
+    bool opened = (identifier == "virtual") ? midiController.openVirtualInput()
+                                            : midiController.openInput(identifier);
+    if (!opened)
+        midiInputComboBox.setSelectedItemIndex(0, juce::dontSendNotification);
+}
+
+void MainComponent::midiOutputChanged()
+{
+    auto identifier = midiOutputIdentifiers[midiOutputComboBox.getSelectedItemIndex()];
+    bool opened = (identifier == "virtual") ? midiController.openVirtualOutput()
+                                            : midiController.openOutput(identifier);
+    if (!opened)
+        midiOutputComboBox.setSelectedItemIndex(0, juce::dontSendNotification);
+    
+    audioEngine.setMidiMirroringEnabled(midiController.isOutputOpen());
+}
+
+// MARK: - (Reverb)
+
+void MainComponent::chooseReverbImpulseResponse()
+{
+    reverbFileChooser = std::make_unique<juce::FileChooser>("Choose a room impulse response",
+                                                             juce::File::getSpecialLocation(juce::File::userHomeDirectory),
+                                                             "*.wav;*.aif;*.aiff;*.flac");
+    
+    auto flags = juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles;
+    reverbFileChooser->launchAsync(flags, [this](const juce::FileChooser& chooser)
+    {
+        auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+        
+        if (!audioEngine.getReverb().loadImpulseResponse(file))
+        {
+            juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,
+                                                   "Couldn't Load Room",
+                                                   "\"" + file.getFileName() + "\" isn't an audio file that can be read.");
+            return;
+        }
+        
+        recordEvent("reverbRoom", {{ "file", file.getFullPathName() }});
+        
+        // Loading a room implies wanting to hear it
+        reverbToggle.setToggleState(true, juce::sendNotification);
+        updateReverbToggleText();
+    });
+}
+
+void MainComponent::updateReverbToggleText()
+{
+    reverbToggle.setButtonText(audioEngine.getReverb().getImpulseResponseName());
+}
+
+// MARK: - (Session recording)
+
+void MainComponent::recordEvent(const juce::String& action, juce::NamedValueSet properties)
+{
+    // Takes effect from the next block the device renders
+    session.record(samplesRendered.load(std::memory_order_relaxed), action, std::move(properties));
+}
+
+void MainComponent::recordDeviceFormat()
+{
+    double sampleRate = deviceSampleRate;
+    int blockSize = deviceBlockSize;
+    int channels = juce::jmax(1, deviceChannels.load());
+    if (sampleRate <= 0.0)
+        return; // No device was opened
+    
+    // The first format is the session's; later changes are noted where they happened
+    bool isFirst = std::none_of(session.events.begin(), session.events.end(),
+                                [](const Session::Event& event) { return event.action == "format"; });
+    if (isFirst)
+    {
+        session.sampleRate = sampleRate;
+        session.blockSize = blockSize;
+        session.numChannels = channels;
+    }
+    recordEvent("format", {{ "sampleRate", sampleRate }, { "blockSize", blockSize }, { "channels", channels }});
+}
+
+// MARK: - (Idle suspension)
+
+void MainComponent::ensureAudioRunning()
+{
+    midiController.notesExpected();
+    deviceSuspender.noteActivity();
+    if (!deviceSuspender.isSuspended() || deviceSuspender.isResuming())
+        return;
+    
+    primeFirstBlocks();
+    deviceSuspender.resume([this] { visualizer.setPaused(false); });
+}
+
+void MainComponent::primeFirstBlocks()
+{
+    // Mirrored MIDI is timed by the callback that plays it, so it isn't primed
+    primedSamplesAvailable = 0;
+    primedReadPosition = 0;
+    if (midiController.isOutputOpen() || preparedBlockSize == 0)
+        return;
+    
+    // Nothing else calls the engine while the device is closed, so it can render here.
+    // The device thread started afterwards sees this before its first callback.
+    int numSamples = preparedBlockSize * kPrimedBlocks;
+    primedAudio.setSize(juce::jmax(1, deviceChannels.load()), numSamples, false, false, true);
+    primedAudio.clear();
+    for (int offset = 0; offset < numSamples; offset += preparedBlockSize)
+        audioEngine.getNextAudioBlock(juce::AudioSourceChannelInfo(&primedAudio, offset, preparedBlockSize));
+    
+    primedSamplesAvailable.store(numSamples, std::memory_order_release);
+}
+
+// MARK: - (Audio device startup)
+
+void MainComponent::startAudioDevice(int numInputChannels)
+{
+    // Opening a device can block for hundreds of milliseconds (e.g. PulseAudio),
+    // so it's done off the message thread. Nothing else touches the device
+    // manager until audioDeviceReady(), and the destructor waits for this thread.
+    audioStartupThread = std::thread([this, numInputChannels]
+    {
+        StartupTrace::mark("Audio device opening");
+        setAudioChannels(numInputChannels, kMaxOutputChannels);
+        StartupTrace::mark("Audio device opened");
+        
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)]
+        {
+            if (safeThis != nullptr)
+                safeThis->audioDeviceReady();
+        });
+    });
+}
+
+void MainComponent::audioDeviceReady()
+{
+    audioStartupThread.join();
+    audioReady = true;
+    recordDeviceFormat();
+    setPlayControlsEnabled(true);
+    quiz.showInstructions();
+    StartupTrace::mark("Play controls enabled");
+    deviceSuspender.noteActivity();
+    quiz.prepareNextQuestion();
+    
+    // Only now: until the startup thread is joined, nothing else may touch the device manager
+    bufferSizeTuner.setEnabled(tuneBufferSize);
+    
+    finishStartupTrace(0);
+}
+
+void MainComponent::setPlayControlsEnabled(bool shouldBeEnabled)
+{
+    playButton.setEnabled(shouldBeEnabled);
+    stopButton.setEnabled(shouldBeEnabled);
+    for (auto& button : modeButtons)
+        button->setEnabled(shouldBeEnabled);
+}
+
+void MainComponent::finishStartupTrace(int attempt)
+{
+    // Give the device a moment to make its first callback, which is only
+    // timestamped on the audio thread
+    double callbackTime = firstAudioCallbackTime;
+    if (callbackTime == 0.0 && attempt < 40)
+    {
+        juce::Timer::callAfterDelay(25, [safeThis = juce::Component::SafePointer<MainComponent>(this), attempt]
+        {
+            if (safeThis != nullptr)
+                safeThis->finishStartupTrace(attempt + 1);
+        });
+        return;
+    }
+    
+    if (callbackTime != 0.0)
+        StartupTrace::markAt("First audio callback", callbackTime);
+    
+    if (auto* app = juce::JUCEApplicationBase::getInstance())
+        StartupTrace::finish(app->getApplicationVersion());
+}
+
 // MARK: - (AudioAppComponent)
 
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    audioEngine.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    // Reopening after an idle suspend keeps the engine as it was, so primed
+    // audio carries on into the engine's next block without a discontinuity.
+    // Audio primed at another rate can't be played, so the playback it started
+    // is rendered again from its first note at this one; a new block size
+    // alone leaves the primed samples as good as they were.
+    bool reprime = sampleRate != preparedSampleRate
+                && primedSamplesAvailable.load() > 0 && primedReadPosition == 0;
+    if (sampleRate != preparedSampleRate || samplesPerBlockExpected != preparedBlockSize)
+    {
+        audioEngine.prepareToPlay(samplesPerBlockExpected, sampleRate);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = samplesPerBlockExpected;
+    }
+    audioTap.setSampleRate(sampleRate);
+    
+    deviceSampleRate = sampleRate;
+    deviceBlockSize = samplesPerBlockExpected;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        deviceChannels = device->getActiveOutputChannels().countNumberOfSetBits();
+
+    if (reprime)
+    {
+        audioEngine.restartPlayback();
+        primeFirstBlocks();
+    }
+    
+    // Mirrored MIDI notes are delayed to match when the audio is actually heard
+    int latencyInSamples = samplesPerBlockExpected;
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        latencyInSamples += device->getOutputLatencyInSamples();
+    midiController.setOutputTiming(sampleRate, latencyInSamples);
 }
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    audioEngine.getNextAudioBlock(bufferToFill);
+    RealtimeAudit::ScopedRealtimeSection realtimeSection;
+    Trace::setThreadName("Audio");
+    TRACE_SCOPE("MainComponent::getNextAudioBlock");
+    
+    if (firstAudioCallbackTime.load(std::memory_order_relaxed) == 0.0)
+        firstAudioCallbackTime = juce::Time::getMillisecondCounterHiRes();
+    deviceSuspender.audioCallbackStarted();
+    
+    // Blocks rendered while the device was reopening go out first
+    int numPrimed = 0;
+    int primedAvailable = primedSamplesAvailable.load(std::memory_order_acquire);
+    if (primedReadPosition < primedAvailable)
+    {
+        numPrimed = juce::jmin(bufferToFill.numSamples, primedAvailable - primedReadPosition);
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        {
+            if (channel < primedAudio.getNumChannels())
+                bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample, primedAudio, channel, primedReadPosition, numPrimed);
+            else
+                bufferToFill.buffer->clear(channel, bufferToFill.startSample, numPrimed);
+        }
+        primedReadPosition += numPrimed;
+    }
+    
+    if (numPrimed < bufferToFill.numSamples)
+        audioEngine.getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + numPrimed,
+                                                                   bufferToFill.numSamples - numPrimed));
+    midiController.mirrorNotes(audioEngine.getMidiOutputForLastBlock());
+    
+    if (bufferToFill.buffer->getNumChannels() > 0)
+        audioTap.push(bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample), bufferToFill.numSamples);
+    
+    samplesRendered.fetch_add(bufferToFill.numSamples, std::memory_order_relaxed);
 }
 
 void MainComponent::releaseResources()
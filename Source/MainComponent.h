@@ -4,19 +4,45 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "AudioEngine.h"
 #include "CustomLookAndFeel.h"
+#include "FrameProfiler.h"
+#include "AudioTap.h"
+#include "VisualizerComponent.h"
+#include "MidiController.h"
+#include "StartupTrace.h"
+#include "Session.h"
+#include "AudioDeviceSuspender.h"
+#include "BufferSizeTuner.h"
+#include "Trace.h"
+#include "QuizSession.h"
+#include <atomic>
+#include <thread>
 
 class MainComponent  : public juce::AudioAppComponent
 {
 public:
     // Window size constants
     static constexpr int kMinWindowWidth = 720;
-    static constexpr int kMinWindowHeight = 550;
+    static constexpr int kMinWindowHeight = 655;
     static constexpr int kDefaultWindowWidth = 800;
-    static constexpr int kDefaultWindowHeight = 550;
+    static constexpr int kDefaultWindowHeight = 860;  // Leaves room for the visualizer
     static constexpr int kMaxWindowWidth = 8192;
     static constexpr int kMaxWindowHeight = 8192;
     
-    MainComponent();
+    // Output channels requested from the device; fewer are used if it has fewer
+    static constexpr int kMaxOutputChannels = 8;
+    
+    // Settings given on the command line when the app is launched
+    struct LaunchOptions
+    {
+        juce::int64 sessionSeed = juce::Time::currentTimeMillis();  // "--seed=<n>"; every random choice comes from it
+        int idleSuspendSeconds = AudioDeviceSuspender::kDefaultIdleSeconds;  // "--suspend-after=<s>"; 0 never closes the device
+        bool tuneBufferSize = false;  // "--tune-buffer"; find the smallest stable buffer size for each device
+        bool trace = false;           // "--trace"; record trace events from launch (see Trace)
+
+        static LaunchOptions fromCommandLine(const juce::String& commandLine);
+    };
+    
+    explicit MainComponent(const LaunchOptions& options);
     ~MainComponent() override;
 
     void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
@@ -25,56 +51,94 @@ public:
 
     void paint(juce::Graphics& g) override;
     void resized() override;
+    bool keyPressed(const juce::KeyPress& key) override;
     
     void showAboutDialog();
     
 
 private:
     AudioEngine audioEngine;
-    juce::Random random;
-	
-	enum class GameStatus : int {
-		instructions,
-		playingForPractice,
-		playingForGuess,
-		waitingForGuess,
-		correctGuess,
-		incorrectGuess
-	};
-	
-    // Game state
-	GameStatus gameStatus;
-    int score;
-    int totalQuestions;
-    AudioEngine::ModeType currentMode;
-    AudioEngine::ModeType lastPlayedMode;
-    bool gameActive;
-    bool isPracticeMode;
+    MidiController midiController;
+    juce::Random random;  // For the button order; the quiz has its own
+    QuizSession::Status displayedStatus = QuizSession::Status::instructions;
+    
+    // The game itself; this component only shows it and forwards the controls
+    JuceQuizScheduler quizScheduler;
+    QuizSession quiz;
+    
+    // The audio device is opened on this thread so the window can appear first
+    std::thread audioStartupThread;
+    bool audioReady;  // Play controls are disabled until the device is open
+    bool firstPaintDone;
+    std::atomic<double> firstAudioCallbackTime { 0.0 };  // Set by the audio thread, for the startup trace
+    
+    // Everything played and answered, saved to Session::getDefaultDirectory() on exit
+    Session session;
+    std::atomic<juce::int64> samplesRendered { 0 };  // Counted by the audio thread, to timestamp events
+    std::atomic<double> deviceSampleRate { 0.0 };     // Set in prepareToPlay
+    std::atomic<int> deviceBlockSize { 0 };
+    std::atomic<int> deviceChannels { 0 };
+    
+    // The device is closed when idle. On resume, the first blocks are rendered
+    // here while it reopens and played before the engine is called again.
+    AudioDeviceSuspender deviceSuspender { deviceManager };
+    static constexpr int kPrimedBlocks = 2;
+    juce::AudioBuffer<float> primedAudio;
+    std::atomic<int> primedSamplesAvailable { 0 };
+    int primedReadPosition = 0;  // Audio thread, or any thread while the device is closed
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+    
+    // Optionally lowers the device's buffer size as far as it stays stable
+    BufferSizeTuner bufferSizeTuner { deviceManager };
+    bool tuneBufferSize;
 
     // UI Components
-    juce::TextButton playButton;
-    juce::TextButton stopButton;
-    juce::TextButton aboutButton;
-    std::vector<std::unique_ptr<juce::TextButton>> modeButtons;
+    Profiled<juce::TextButton> playButton;
+    Profiled<juce::TextButton> stopButton;
+    Profiled<juce::TextButton> aboutButton;
+    std::vector<std::unique_ptr<Profiled<juce::TextButton>>> modeButtons;
     std::vector<AudioEngine::ModeType> modeOrder; // Current order of modes in buttons
     
-    juce::Label titleLabel;
-    juce::Label scoreLabel;
-    juce::Label statusLabel;  // Combined status/feedback label
-    juce::Label rootNoteLabel;
-    juce::Label rootSelectionLabel;
-    juce::Label speedLabel;
-    juce::Label patternLabel;
-	juce::Label modeButtonsLabel;
-	juce::Label colorsLabel;
-    juce::Label optionsLabel;
-    
-    juce::Slider rootNoteSlider;
-    juce::Slider speedSlider;
-    juce::ComboBox patternComboBox;
-    juce::ToggleButton randomizeModeButtonsCheckbox;
-    juce::ToggleButton randomizeRootCheckbox;
-    juce::ToggleButton lightModeToggle;
+    Profiled<juce::Label> titleLabel;
+    Profiled<juce::Label> scoreLabel;
+    Profiled<juce::Label> statusLabel;  // Combined status/feedback label
+    Profiled<juce::Label> rootNoteLabel;
+    Profiled<juce::Label> rootSelectionLabel;
+    Profiled<juce::Label> speedLabel;
+    Profiled<juce::Label> patternLabel;
+    Profiled<juce::Label> timbreLabel;
+	Profiled<juce::Label> modeButtonsLabel;
+	Profiled<juce::Label> colorsLabel;
+    Profiled<juce::Label> optionsLabel;
+    Profiled<juce::Label> midiLabel;
+    Profiled<juce::Label> speakersLabel;
+    Profiled<juce::Label> reverbLabel;
+    
+    Profiled<juce::Slider> rootNoteSlider;
+    Profiled<juce::Slider> speedSlider;
+    Profiled<juce::ComboBox> patternComboBox;
+    Profiled<juce::ComboBox> timbreComboBox;
+    Profiled<juce::ToggleButton> loudnessToggle;
+    Profiled<juce::ComboBox> midiInputComboBox;
+    Profiled<juce::ComboBox> midiOutputComboBox;
+    juce::StringArray midiInputIdentifiers;   // Device identifier for each input item
+    juce::StringArray midiOutputIdentifiers;  // Device identifier for each output item
+    juce::MidiDeviceListConnection midiDeviceListConnection;
+    Profiled<juce::ToggleButton> randomizeModeButtonsCheckbox;
+    Profiled<juce::ToggleButton> randomizeRootCheckbox;
+    Profiled<juce::ToggleButton> lightModeToggle;
+    Profiled<juce::ToggleButton> degreePanningToggle;
+    Profiled<juce::ToggleButton> reverbToggle;
+    Profiled<juce::ToggleButton> reverbTailToggle;
+    Profiled<juce::TextButton> reverbLoadButton;
+    std::unique_ptr<juce::FileChooser> reverbFileChooser;
+    
+    AudioTap audioTap;  // First output channel, for the visualizer
+    VisualizerComponent visualizer { audioTap };
+    
+    FrameProfilerOverlay frameProfilerOverlay;  // Toggled with Ctrl/Cmd+Shift+P
+    void toggleTracing();                       // Ctrl/Cmd+Shift+T
     
     // Custom LookAndFeel
 	LightModeLookAndFeel lightModeLookAndFeel;
@@ -87,15 +151,28 @@ private:
 	}
 
     // Methods
-	void setStatusWithText(GameStatus status, juce::String text);
+	void setStatusWithText(QuizSession::Status status, juce::String text);
 	void updateStatusLabelColour();
+    void quizStatusChanged();
+    void updateQuizSettings();
     void playRandomScale();
     void stopPlaying();
-    void guessMode(AudioEngine::ModeType guessedMode);
-	void practiceMode(AudioEngine::ModeType mode);
-	void showInstructionsText();
+    void modeChosen(AudioEngine::ModeType mode);
     AudioEngine::PlaybackPattern getSelectedPattern() const;
     void randomizeButtonOrder();
+    void refreshMidiDeviceLists();
+    void midiInputChanged();
+    void midiOutputChanged();
+    void startAudioDevice(int numInputChannels);
+    void audioDeviceReady();
+    void setPlayControlsEnabled(bool shouldBeEnabled);
+    void finishStartupTrace(int attempt);
+    void chooseReverbImpulseResponse();
+    void updateReverbToggleText();
+    void recordEvent(const juce::String& action, juce::NamedValueSet properties = {});
+    void ensureAudioRunning();
+    void primeFirstBlocks();
+    void recordDeviceFormat();
     juce::String frequencyToNoteName(double frequency) const;
     double noteNameToFrequency(int noteIndex) const;
     int frequencyToNoteIndex(double frequency) const;
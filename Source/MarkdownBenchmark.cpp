@@ -0,0 +1,276 @@
+#include "MarkdownBenchmark.h"
+#include "MarkdownConverter.h"
+#include "BinaryData.h"
+#include <juce_cryptography/juce_cryptography.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    constexpr int kLinesPerPathologicalDocument = 16;
+    constexpr double kMinRepeatSeconds = 0.1;  // Small documents are converted repeatedly and the fastest time kept
+
+    // Resident memory as the kernel counts it. Only Linux can reset the peak,
+    // so elsewhere memory isn't reported.
+#if JUCE_LINUX
+    juce::int64 readStatusBytes(const char* field)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.rfind(field, 0) == 0)
+                return juce::String(line.substr(std::strlen(field))).getLargeIntValue() * 1024;
+        return 0;
+    }
+
+    void resetPeakMemory()
+    {
+        std::ofstream("/proc/self/clear_refs") << "5";
+    }
+
+    juce::int64 getCurrentMemory() { return readStatusBytes("VmRSS:"); }
+    juce::int64 getPeakMemory() { return readStatusBytes("VmHWM:"); }
+#else
+    void resetPeakMemory() {}
+    juce::int64 getCurrentMemory() { return 0; }
+    juce::int64 getPeakMemory() { return 0; }
+#endif
+
+    // Repeat until the whole text is at least size bytes
+    std::string tile(size_t size, const std::function<std::string(int)>& unit)
+    {
+        std::string text;
+        text.reserve(size + 4096);
+        for (int i = 0; text.size() < size; ++i)
+            text += unit(i);
+        return text;
+    }
+
+    // Identical lines of prefix then repeated, kLinesPerPathologicalDocument of them
+    std::string pathologicalDocument(size_t size, const std::string& prefix, const std::string& repeated)
+    {
+        auto lineLength = size / kLinesPerPathologicalDocument;
+        std::string line = prefix;
+        while (line.size() < lineLength)
+            line += repeated;
+        line += "\n";
+
+        std::string text;
+        for (int i = 0; i < kLinesPerPathologicalDocument; ++i)
+            text += line;
+        return text;
+    }
+
+    template <typename Function>
+    double timeFastest(Function&& function, std::string& output)
+    {
+        double fastest = 0.0;
+        double total = 0.0;
+        for (int run = 0; run == 0 || (total < kMinRepeatSeconds && run < 100); ++run)
+        {
+            auto start = juce::Time::getMillisecondCounterHiRes();
+            output = function();
+            auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+            fastest = run == 0 ? seconds : juce::jmin(fastest, seconds);
+            total += seconds;
+        }
+        return fastest;
+    }
+
+    juce::String formatBytes(double bytes)
+    {
+        if (bytes >= 1024.0 * 1024.0)
+            return juce::String(bytes / (1024.0 * 1024.0), 1) + " MB";
+        if (bytes >= 1024.0)
+            return juce::String(bytes / 1024.0, 1) + " KB";
+        return juce::String(static_cast<int>(bytes)) + " B";
+    }
+
+    juce::String formatSpeed(size_t bytes, double seconds)
+    {
+        return seconds > 0.0 ? juce::String(static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds, 2) + " MB/s" : juce::String("-");
+    }
+}
+
+// MARK: - (Corpus)
+
+std::vector<MarkdownBenchmark::Family> MarkdownBenchmark::createCorpus(const Settings& settings)
+{
+    std::vector<size_t> documentSizes;
+    for (size_t size = 1024; size <= settings.maxDocumentBytes; size *= 10)
+        documentSizes.push_back(size);
+
+    std::vector<size_t> lineSizes;
+    for (size_t length = 512; length <= kMaxPathologicalLineLength; length *= 2)
+        lineSizes.push_back(length * kLinesPerPathologicalDocument);
+
+    std::vector<Family> corpus;
+
+    corpus.push_back({ "readme", { static_cast<size_t>(BinaryData::README_mdSize) }, [](size_t)
+    {
+        return std::string(BinaryData::README_md, BinaryData::README_mdSize);
+    }});
+
+    // A lesson pack: chapters of README text between paragraphs, lists and code
+    corpus.push_back({ "book", documentSizes, [](size_t size)
+    {
+        std::string readme(BinaryData::README_md, BinaryData::README_mdSize);
+        return tile(size, [&readme](int chapter)
+        {
+            auto number = std::to_string(chapter + 1);
+            return "# Chapter " + number + "\n\n"
+                   "Each mode has a **characteristic degree**; listen for it in *every* exercise, "
+                   "and compare with `Ionian` as in [the overview](#modes).\n\n"
+                   "1. Play the mode\n2. Sing the root\n  - then the *fourth*\n  - then the **seventh**\n\n"
+                   "```\nroot < third && third > root\n```\n\n" + readme + "\n";
+        });
+    }});
+
+    corpus.push_back({ "nested-lists", documentSizes, [](size_t size)
+    {
+        // Down to 64 levels and back up, over and over
+        return tile(size, [](int line)
+        {
+            int depth = line % 128 < 64 ? line % 64 : 63 - line % 64;
+            return std::string(static_cast<size_t>(depth) * 2, ' ') + (depth % 2 == 0 ? "- " : "1. ")
+                   + "item with *emphasis* and `code`\n";
+        });
+    }});
+
+    corpus.push_back({ "code-fence", documentSizes, [](size_t size)
+    {
+        auto text = "```\n" + tile(size, [](int) { return std::string("if (a < b && c > d) { return *p + q[i]; }  // **not bold**\n"); });
+        return text + "```\n";
+    }});
+
+    corpus.push_back({ "unterminated-emphasis", lineSizes, [](size_t size)
+    {
+        return pathologicalDocument(size, "**", "an emphasis run that never ends ");
+    }});
+
+    corpus.push_back({ "unbalanced-links", lineSizes, [](size_t size)
+    {
+        return pathologicalDocument(size, "", "[x](");
+    }});
+
+    return corpus;
+}
+
+// MARK: - (Measuring)
+
+MarkdownBenchmark::Measurement MarkdownBenchmark::measure(const Family& family, size_t size, const Settings& settings)
+{
+    Measurement measurement;
+    measurement.family = family.name;
+
+    auto text = family.generate(size);
+    measurement.bytes = text.size();
+
+    MarkdownConverter converter;
+    std::string serial, parallel;
+
+    resetPeakMemory();
+    auto memoryBefore = getCurrentMemory();
+    measurement.serialSeconds = timeFastest([&] { return converter.convertToHtmlSerially(text); }, serial);
+    measurement.parallelSeconds = timeFastest([&] { return converter.convertToHtml(text); }, parallel);
+    measurement.peakMemoryBytes = juce::jmax<juce::int64>(0, getPeakMemory() - memoryBefore);
+
+    if (parallel != serial)
+    {
+        measurement.failure = "parallel conversion differs from serial";
+        return measurement;
+    }
+
+    if (!settings.goldenDirectory.isDirectory() && !settings.updateGolden)
+        return measurement;
+
+    auto hash = juce::SHA256(parallel.data(), parallel.size()).toHexString();
+    auto name = family.name + "-" + juce::String(static_cast<juce::int64>(size));
+    auto hashFile = settings.goldenDirectory.getChildFile(name + ".golden.sha256");
+
+    if (settings.updateGolden)
+    {
+        // The HTML too while it's small enough to keep, so a difference can be read
+        settings.goldenDirectory.createDirectory();
+        bool written = hashFile.replaceWithText(hash);
+        if (parallel.size() <= 1024 * 1024)
+            written = written && settings.goldenDirectory.getChildFile(name + ".golden.html").replaceWithData(parallel.data(), parallel.size());
+        if (!written)
+            measurement.failure = "couldn't write the golden files";
+    }
+    else if (!hashFile.existsAsFile())
+    {
+        measurement.failure = "no golden file (run with --update-golden)";
+    }
+    else if (hashFile.loadFileAsString().trim() != hash)
+    {
+        measurement.failure = "HTML differs from the golden file";
+    }
+
+    return measurement;
+}
+
+juce::String MarkdownBenchmark::findSuperlinearScaling(const std::vector<Measurement>& measurements)
+{
+    for (size_t i = 1; i < measurements.size(); ++i)
+    {
+        auto& smaller = measurements[i - 1];
+        auto& larger = measurements[i];
+        if (smaller.serialSeconds < kMinTimedSeconds || larger.bytes <= smaller.bytes)
+            continue;
+
+        double exponent = std::log(larger.serialSeconds / smaller.serialSeconds)
+                        / std::log(static_cast<double>(larger.bytes) / static_cast<double>(smaller.bytes));
+        if (exponent > kMaxScalingExponent)
+            return formatBytes(static_cast<double>(smaller.bytes)) + " to " + formatBytes(static_cast<double>(larger.bytes))
+                 + " took " + juce::String(larger.serialSeconds / smaller.serialSeconds, 1) + "x as long (time ~ size^"
+                 + juce::String(exponent, 2) + ")";
+    }
+    return {};
+}
+
+void MarkdownBenchmark::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--max-mb"))
+        settings.maxDocumentBytes = static_cast<size_t>(juce::jmax(0.001, args.getValueForOption("--max-mb").getDoubleValue()) * 1024.0 * 1024.0);
+    if (args.containsOption("--golden"))
+        settings.goldenDirectory = args.getFileForOption("--golden");
+    settings.updateGolden = args.containsOption("--update-golden");
+    if (settings.updateGolden && settings.goldenDirectory == juce::File())
+        juce::ConsoleApplication::fail("--update-golden needs --golden=<directory>", 1);
+
+    std::cout << "Converting documents up to " << formatBytes(static_cast<double>(settings.maxDocumentBytes))
+              << " on up to " << juce::SystemStats::getNumCpus() << " cores" << std::endl;
+
+    int numFailed = 0;
+    for (auto& family : createCorpus(settings))
+    {
+        std::vector<Measurement> measurements;
+        for (auto size : family.sizes)
+        {
+            auto measurement = measure(family, size, settings);
+            bool passed = measurement.failure.isEmpty();
+            numFailed += passed ? 0 : 1;
+
+            std::cout << (passed ? "ok    " : "FAIL  ") << family.name << " " << formatBytes(static_cast<double>(measurement.bytes))
+                      << ": serial " << formatSpeed(measurement.bytes, measurement.serialSeconds)
+                      << ", parallel " << formatSpeed(measurement.bytes, measurement.parallelSeconds)
+                      << ", peak memory " << (measurement.peakMemoryBytes > 0 ? formatBytes(static_cast<double>(measurement.peakMemoryBytes)) : juce::String("n/a"))
+                      << (passed ? juce::String() : "; " + measurement.failure) << std::endl;
+            measurements.push_back(measurement);
+        }
+
+        auto scaling = findSuperlinearScaling(measurements);
+        if (scaling.isNotEmpty())
+        {
+            numFailed++;
+            std::cout << "FAIL  " << family.name << " scales superlinearly: " << scaling << std::endl;
+        }
+    }
+
+    if (numFailed > 0)
+        juce::ConsoleApplication::fail(juce::String(numFailed) + " checks failed", 1);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Throughput, memory and correctness of MarkdownConverter over a generated
+// corpus: the README, lesson-style books from 1 KB up to --max-mb, deeply
+// nested lists, huge code fences, and lines of unterminated emphasis and
+// unbalanced link brackets of growing length. Each document is converted both
+// serially and by the parallel path, which must agree byte for byte, and the
+// HTML can be checked against golden hashes so speed work can't change it.
+//
+// Each family is converted at several sizes; if time grows faster than
+// size^kMaxScalingExponent between two of them, the family is flagged as
+// scaling superlinearly. Lines of pathological input are kept to
+// kMaxPathologicalLineLength, since std::regex recurses once per character
+// and overflows the stack on lines far longer.
+class MarkdownBenchmark
+{
+public:
+    static constexpr double kMaxScalingExponent = 1.4;
+    static constexpr double kMinTimedSeconds = 0.005;          // Shorter conversions are too noisy to compare
+    static constexpr size_t kMaxPathologicalLineLength = 8192;
+
+    struct Settings
+    {
+        size_t maxDocumentBytes = 1024 * 1024;  // Largest book, list and code fence document
+        juce::File goldenDirectory;             // No golden check if it doesn't exist
+        bool updateGolden = false;
+    };
+
+    // Documents of one kind at increasing sizes
+    struct Family
+    {
+        juce::String name;
+        std::vector<size_t> sizes;
+        std::function<std::string(size_t)> generate;  // Deterministic, so goldens stay valid
+    };
+
+    struct Measurement
+    {
+        juce::String family;
+        size_t bytes = 0;
+        double serialSeconds = 0.0;
+        double parallelSeconds = 0.0;
+        juce::int64 peakMemoryBytes = 0;  // Above the memory in use before converting; 0 where unknown
+        juce::String failure;             // Empty when passed
+    };
+
+    static std::vector<Family> createCorpus(const Settings& settings);
+
+    /** Convert one document and check it against its golden hash */
+    static Measurement measure(const Family& family, size_t size, const Settings& settings);
+
+    /** Why a family's time grew faster than its size, or an empty string */
+    static juce::String findSuperlinearScaling(const std::vector<Measurement>& measurements);
+
+    /** Entry point for the --markdown-bench command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
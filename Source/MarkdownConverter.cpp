@@ -1,12 +1,150 @@
 #include "MarkdownConverter.h"
+#include <algorithm>
+#include <atomic>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 
 std::string MarkdownConverter::convertToHtml(const std::string& markdown) {
-    std::stringstream html;
+    size_t numThreads = std::thread::hardware_concurrency();
+    if (markdown.size() < kMinParallelSize || numThreads < 2)
+        return convertToHtmlSerially(markdown);
+
     std::vector<std::string> lines = splitLines(markdown);
+    std::vector<size_t> chunkStarts = findChunkStarts(lines, std::max(kMinChunkSize, markdown.size() / (numThreads * 4)));
+    std::vector<std::string> chunks(chunkStarts.size());
+
+    runInParallel(chunks.size(), [&](size_t chunk) {
+        size_t end = chunk + 1 < chunkStarts.size() ? chunkStarts[chunk + 1] : lines.size();
+        chunks[chunk] = convertLines(lines, chunkStarts[chunk], end);
+    });
+
+    size_t totalSize = 0;
+    for (const auto& chunk : chunks)
+        totalSize += chunk.size();
+
+    std::string html;
+    html.reserve(totalSize);
+    for (const auto& chunk : chunks)
+        html += chunk;
+    return html;
+}
+
+std::string MarkdownConverter::convertToHtmlSerially(const std::string& markdown) {
+    std::vector<std::string> lines = splitLines(markdown);
+    return convertLines(lines, 0, lines.size());
+}
+
+size_t MarkdownConverter::convertBlocks(const std::string& markdown, std::vector<Block>& blocks) {
+    std::unordered_map<size_t, const Block*> previousBlocks;
+    for (const auto& block : blocks)
+        previousBlocks.emplace(block.hash, &block);
+
+    // Split without copying: a block ends after a blank line outside a code block
+    std::string_view text(markdown);
+    std::vector<size_t> blockStarts;
+    bool inCodeBlock = false;
+    size_t blockStart = 0;
+
+    for (size_t lineStart = 0; lineStart < text.size();) {
+        size_t lineEnd = std::min(text.find('\n', lineStart), text.size());
+        size_t nextLine = std::min(lineEnd + 1, text.size());
+
+        size_t first = text.find_first_not_of(" \t", lineStart);
+        bool isBlank = first >= lineEnd;
+        size_t last = isBlank ? first : text.find_last_not_of(" \t", lineEnd - 1);
+
+        if (!isBlank && last - first == 2 && text.compare(first, 3, "```") == 0)
+            inCodeBlock = !inCodeBlock;
+        else if (isBlank && !inCodeBlock) {
+            blockStarts.push_back(blockStart);
+            blockStart = nextLine;
+        }
+        lineStart = nextLine;
+    }
+    if (blockStart < text.size())
+        blockStarts.push_back(blockStart);
+
+    std::vector<Block> newBlocks(blockStarts.size());
+    std::vector<size_t> blocksToConvert;
+    size_t bytesToConvert = 0;
+
+    for (size_t i = 0; i < newBlocks.size(); ++i) {
+        size_t end = i + 1 < blockStarts.size() ? blockStarts[i + 1] : text.size();
+        auto& block = newBlocks[i];
+        block.length = end - blockStarts[i];
+        block.hash = std::hash<std::string_view>()(text.substr(blockStarts[i], block.length));
+
+        auto previous = previousBlocks.find(block.hash);
+        if (previous != previousBlocks.end() && previous->second->length == block.length) {
+            block.html = previous->second->html;
+        } else {
+            blocksToConvert.push_back(i);
+            bytesToConvert += block.length;
+        }
+    }
+
+    auto convertBlock = [&](size_t index) {
+        size_t blockIndex = blocksToConvert[index];
+        auto& block = newBlocks[blockIndex];
+        block.html = std::make_shared<const std::string>(convertToHtmlSerially(markdown.substr(blockStarts[blockIndex], block.length)));
+    };
+
+    if (bytesToConvert >= kMinParallelSize)
+        runInParallel(blocksToConvert.size(), convertBlock);
+    else
+        for (size_t i = 0; i < blocksToConvert.size(); ++i)
+            convertBlock(i);
+
+    blocks = std::move(newBlocks);
+    return blocksToConvert.size();
+}
+
+void MarkdownConverter::runInParallel(size_t count, const std::function<void(size_t)>& work) {
+    // Taken in order, a few per thread, so one slow item doesn't hold up the rest
+    size_t numThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+    std::atomic<size_t> nextItem { 0 };
+    auto takeItems = [&] {
+        for (size_t item = nextItem++; item < count; item = nextItem++)
+            work(item);
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < numThreads; ++i)
+        pool.emplace_back(takeItems);
+    takeItems();
+    for (auto& thread : pool)
+        thread.join();
+}
+
+std::vector<size_t> MarkdownConverter::findChunkStarts(const std::vector<std::string>& lines, size_t chunkSize) {
+    // A blank line outside a code block closes any open list, so nothing carries over it
+    std::vector<size_t> starts { 0 };
+    bool inCodeBlock = false;
+    size_t bytesInChunk = 0;
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        bytesInChunk += lines[i].size() + 1;
+        std::string trimmedLine = trim(lines[i]);
+
+        if (isCodeBlockStart(trimmedLine))
+            inCodeBlock = !inCodeBlock;
+        else if (!inCodeBlock && trimmedLine.empty() && bytesInChunk >= chunkSize && i + 1 < lines.size()) {
+            starts.push_back(i + 1);
+            bytesInChunk = 0;
+        }
+    }
+
+    return starts;
+}
+
+std::string MarkdownConverter::convertLines(const std::vector<std::string>& lines, size_t begin, size_t end) {
+    std::stringstream html;
     ListState listState;
     bool inCodeBlock = false;
     
-    for (const auto& line : lines) {
+    for (size_t i = begin; i < end; ++i) {
+        const std::string& line = lines[i];
         std::string trimmedLine = trim(line);
 
         if (isCodeBlockStart(trimmedLine)) {
@@ -5,21 +5,85 @@
 #include <regex>
 #include <sstream>
 #include <cctype>
+#include <cstddef>
+#include <functional>
+#include <memory>
 
 class MarkdownConverter
 {
 public:
+    // Inputs smaller than this are converted on the calling thread
+    static constexpr size_t kMinParallelSize = 256 * 1024;
+
+    // Chunks converted in parallel are at least this large
+    static constexpr size_t kMinChunkSize = 64 * 1024;
+
     MarkdownConverter() = default;
     ~MarkdownConverter() = default;
 
     /**
-     * Convert markdown text to HTML
+     * Convert markdown text to HTML. Large inputs are split into chunks at
+     * blank lines outside code blocks, where no list or code block is open,
+     * and the chunks converted on one thread per core; the result is
+     * identical to convertToHtmlSerially().
      * @param markdown The markdown text to convert
      * @return HTML string
      */
     std::string convertToHtml(const std::string& markdown);
 
+    /**
+     * Convert markdown text to HTML on the calling thread, line by line
+     * @param markdown The markdown text to convert
+     * @return HTML string
+     */
+    std::string convertToHtmlSerially(const std::string& markdown);
+
+    // A block of a document: its lines up to and including a blank line
+    // outside a code block, which nothing carries over. The HTML is shared
+    // between copies, so keeping a document's blocks around is cheap.
+    struct Block
+    {
+        size_t hash = 0;    // Of the block's markdown
+        size_t length = 0;  // Of the block's markdown, in bytes
+        std::shared_ptr<const std::string> html;
+    };
+
+    /**
+     * Convert markdown text to HTML block by block, converting only blocks
+     * whose markdown isn't among the previous blocks. Joined in order, the
+     * blocks' HTML is identical to convertToHtmlSerially().
+     * @param markdown The markdown text to convert
+     * @param blocks The document's blocks from the previous call (or empty), replaced by its new blocks
+     * @return Number of blocks converted; the others were reused
+     */
+    size_t convertBlocks(const std::string& markdown, std::vector<Block>& blocks);
+
 private:
+    /**
+     * Call work(0) to work(count - 1), spread over up to one thread per core
+     * @param count Number of items
+     * @param work Called once for each item, on any of the threads
+     */
+    void runInParallel(size_t count, const std::function<void(size_t)>& work);
+
+    /**
+     * Convert a range of lines, starting outside any list or code block
+     * @param lines All the lines of the document
+     * @param begin First line to convert
+     * @param end One past the last line to convert
+     * @return HTML string
+     */
+    std::string convertLines(const std::vector<std::string>& lines, size_t begin, size_t end);
+
+    /**
+     * Find where chunks can start: after a blank line outside a code block,
+     * once the chunk so far is at least chunkSize bytes
+     * @param lines All the lines of the document
+     * @param chunkSize Smallest chunk, in bytes
+     * @return Index of the first line of each chunk, starting with 0
+     */
+    std::vector<size_t> findChunkStarts(const std::vector<std::string>& lines, size_t chunkSize);
+
     /**
      * Process inline formatting (bold, italic, code) within a line
      * @param line The line to process
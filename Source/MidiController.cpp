@@ -0,0 +1,237 @@
+#include "MidiController.h"
+#include <algorithm>
+
+MidiController::MidiController()
+    : outputThread(*this)
+{
+}
+
+MidiController::~MidiController()
+{
+    cancelPendingUpdate();
+    closeInput();
+    closeOutput();
+}
+
+juce::Array<juce::MidiDeviceInfo> MidiController::getAvailableInputs() const
+{
+    return juce::MidiInput::getAvailableDevices();
+}
+
+juce::Array<juce::MidiDeviceInfo> MidiController::getAvailableOutputs() const
+{
+    return juce::MidiOutput::getAvailableDevices();
+}
+
+bool MidiController::openInput(const juce::String& identifier)
+{
+    closeInput();
+    if (identifier.isEmpty())
+        return true;
+
+    midiInput = juce::MidiInput::openDevice(identifier, this);
+    if (midiInput == nullptr)
+        return false;
+
+    midiInput->start();
+    return true;
+}
+
+bool MidiController::openVirtualInput()
+{
+    closeInput();
+
+    // Not supported on Windows, where this returns nullptr
+    midiInput = juce::MidiInput::createNewDevice(kVirtualPortName, this);
+    if (midiInput == nullptr)
+        return false;
+
+    midiInput->start();
+    return true;
+}
+
+void MidiController::closeInput()
+{
+    if (midiInput != nullptr)
+        midiInput->stop();
+    midiInput.reset();
+    pendingMode = -1;
+}
+
+bool MidiController::openOutput(const juce::String& identifier)
+{
+    closeOutput();
+    if (identifier.isEmpty())
+        return true;
+
+    midiOutput = juce::MidiOutput::openDevice(identifier);
+    if (midiOutput == nullptr)
+        return false;
+
+    startOutput();
+    return true;
+}
+
+bool MidiController::openVirtualOutput()
+{
+    closeOutput();
+
+    midiOutput = juce::MidiOutput::createNewDevice(kVirtualPortName);
+    if (midiOutput == nullptr)
+        return false;
+
+    startOutput();
+    return true;
+}
+
+void MidiController::startOutput()
+{
+    // The FIFO isn't reset here: the audio thread may still be writing to it.
+    // The output thread discards whatever is left over when it starts instead.
+    midiOutput->startBackgroundThread();
+    outputThread.startThread(juce::Thread::Priority::high);
+    outputEnabled = true;
+}
+
+void MidiController::closeOutput()
+{
+    outputEnabled = false;
+    outputThread.stopThread(1000);
+
+    if (midiOutput != nullptr)
+    {
+        midiOutput->stopBackgroundThread();
+        midiOutput->clearAllPendingMessages();
+        for (int channel = 1; channel <= 16; ++channel)
+            midiOutput->sendMessageNow(juce::MidiMessage::allNotesOff(channel));
+    }
+    midiOutput.reset();
+}
+
+bool MidiController::isOutputOpen() const
+{
+    return outputEnabled;
+}
+
+bool MidiController::getModeForNote(int noteNumber, AudioEngine::ModeType& mode)
+{
+    switch (noteNumber % 12)
+    {
+        case 0:  mode = AudioEngine::ModeType::Ionian;     return true;  // C
+        case 2:  mode = AudioEngine::ModeType::Dorian;     return true;  // D
+        case 4:  mode = AudioEngine::ModeType::Phrygian;   return true;  // E
+        case 5:  mode = AudioEngine::ModeType::Lydian;     return true;  // F
+        case 7:  mode = AudioEngine::ModeType::Mixolydian; return true;  // G
+        case 9:  mode = AudioEngine::ModeType::Aeolian;    return true;  // A
+        case 11: mode = AudioEngine::ModeType::Locrian;    return true;  // B
+        default: return false;
+    }
+}
+
+// MARK: - (Input)
+
+void MidiController::handleIncomingMidiMessage(juce::MidiInput*, const juce::MidiMessage& message)
+{
+    // MIDI thread: resolve and latch the answer here, so the only deferred
+    // work is the UI update, and later keys can't overwrite the first answer.
+    if (!message.isNoteOn())
+        return;
+
+    AudioEngine::ModeType mode;
+    if (!getModeForNote(message.getNoteNumber(), mode))
+        return;
+
+    int expected = -1;
+    if (pendingMode.compare_exchange_strong(expected, static_cast<int>(mode)))
+        triggerAsyncUpdate();
+}
+
+void MidiController::handleAsyncUpdate()
+{
+    int mode = pendingMode.exchange(-1);
+    if (mode >= 0 && onModeKeyPressed)
+        onModeKeyPressed(static_cast<AudioEngine::ModeType>(mode));
+}
+
+// MARK: - (Output)
+
+void MidiController::setOutputTiming(double sampleRate, int latencyInSamples)
+{
+    outputSampleRate = sampleRate;
+    outputLatencySamples = latencyInSamples;
+}
+
+void MidiController::mirrorNotes(const juce::MidiBuffer& notes)
+{
+    if (!outputEnabled || notes.isEmpty())
+        return;
+
+    // The block just rendered is heard after the device latency, so schedule
+    // each event at that point plus its offset within the block
+    double sampleRate = outputSampleRate;
+    double blockStartMs = juce::Time::getMillisecondCounterHiRes()
+                        + 1000.0 * outputLatencySamples / sampleRate;
+
+    for (const auto metadata : notes)
+    {
+        if (metadata.numBytes > 3)
+            continue;
+
+        const auto scope = outputFifo.write(1);
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return;  // Output thread has fallen behind; drop rather than block
+
+        auto& timed = outputMessages[static_cast<size_t>(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)];
+        timed.timeMs = blockStartMs + 1000.0 * metadata.samplePosition / sampleRate;
+        std::fill(std::begin(timed.data), std::end(timed.data), juce::uint8(0));
+        std::copy(metadata.data, metadata.data + metadata.numBytes, timed.data);
+    }
+}
+
+void MidiController::notesExpected()
+{
+    if (outputEnabled)
+        outputThread.notify();
+}
+
+MidiController::OutputThread::OutputThread(MidiController& owner)
+    : juce::Thread("MIDI output")
+    , owner(owner)
+{
+}
+
+void MidiController::OutputThread::run()
+{
+    juce::MidiBuffer block;
+
+    // Notes mirrored to a port closed since; reading is this thread's side of
+    // the FIFO, so it's safe while the audio thread writes
+    owner.outputFifo.read(owner.outputFifo.getNumReady());
+    double lastActiveMs = juce::Time::getMillisecondCounterHiRes();
+
+    while (!threadShouldExit())
+    {
+        int numReady = owner.outputFifo.getNumReady();
+        if (numReady > 0)
+        {
+            lastActiveMs = juce::Time::getMillisecondCounterHiRes();
+            const auto scope = owner.outputFifo.read(numReady);
+            scope.forEach([this, &block](int index)
+            {
+                auto& timed = owner.outputMessages[static_cast<size_t>(index)];
+                block.clear();
+                block.addEvent(juce::MidiMessage(timed.data[0], timed.data[1], timed.data[2]), 0);
+
+                // MidiOutput's own thread delivers each message at its timestamp
+                owner.midiOutput->sendBlockOfMessages(block, timed.timeMs, owner.outputSampleRate);
+            });
+        }
+
+        // Poll each millisecond while notes are coming; idle, sleep until notesExpected()
+        bool idle = juce::Time::getMillisecondCounterHiRes() - lastActiveMs > kIdleAfterMs;
+        if (idle && wait(kIdleWaitMs))
+            lastActiveMs = juce::Time::getMillisecondCounterHiRes();
+        else if (!idle)
+            wait(1);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+#include <juce_events/juce_events.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include "AudioEngine.h"
+
+// MIDI keyboard answers and MIDI mirroring of the engine's playback.
+//
+// Input: each mode is mapped to the white key it is built on (C = Ionian,
+// D = Dorian, ... B = Locrian) in any octave. Keys are resolved to modes on the
+// MIDI thread and the first key pressed is latched; a single coalesced async
+// update then hands it to the game logic on the message thread.
+//
+// Output: the audio thread pushes note events with sample-accurate timestamps
+// into a lock-free FIFO, and a background thread schedules them on the output
+// device so that an external synth sounds in sync with the audio output. That
+// thread polls every millisecond only while notes are coming: waking it takes
+// a lock, which the audio thread mustn't, so the message thread wakes it
+// through notesExpected() whenever it queues a playback.
+class MidiController : private juce::MidiInputCallback,
+                       private juce::AsyncUpdater
+{
+public:
+    static constexpr const char* kVirtualPortName = "Mode Trainer";
+
+    MidiController();
+    ~MidiController() override;
+
+    // Called on the message thread with the mode for each answer key
+    std::function<void(AudioEngine::ModeType)> onModeKeyPressed;
+
+    // Device selection (message thread). An empty identifier closes the port.
+    juce::Array<juce::MidiDeviceInfo> getAvailableInputs() const;
+    juce::Array<juce::MidiDeviceInfo> getAvailableOutputs() const;
+    bool openInput(const juce::String& identifier);
+    bool openOutput(const juce::String& identifier);
+    bool openVirtualInput();
+    bool openVirtualOutput();
+    void closeInput();
+    void closeOutput();
+    bool isOutputOpen() const;
+
+    /**
+     * Map a MIDI note to the mode built on that white key
+     * @param noteNumber MIDI note number
+     * @param mode Set to the mapped mode
+     * @return false for black keys
+     */
+    static bool getModeForNote(int noteNumber, AudioEngine::ModeType& mode);
+
+    // Audio thread: timing of the device, used to timestamp mirrored notes
+    void setOutputTiming(double sampleRate, int latencyInSamples);
+
+    // Audio thread: queue the engine's note events for the block just rendered
+    void mirrorNotes(const juce::MidiBuffer& notes);
+
+    // Message thread: a playback or stop has just been queued, so mirrored
+    // notes are about to arrive
+    void notesExpected();
+
+private:
+    struct TimedMessage
+    {
+        double timeMs;
+        juce::uint8 data[3];
+    };
+
+    class OutputThread : public juce::Thread
+    {
+    public:
+        static constexpr double kIdleAfterMs = 2000.0;  // Longer than the slowest note
+        static constexpr int kIdleWaitMs = 250;         // Bounds the delay for notes nobody said to expect
+
+        explicit OutputThread(MidiController& owner);
+        void run() override;
+
+    private:
+        MidiController& owner;
+    };
+
+    std::unique_ptr<juce::MidiInput> midiInput;
+    std::unique_ptr<juce::MidiOutput> midiOutput;
+    OutputThread outputThread;
+
+    // Mirrored notes, written by the audio thread and read by the output thread
+    static constexpr int kFifoSize = 512;
+    juce::AbstractFifo outputFifo { kFifoSize };
+    std::array<TimedMessage, kFifoSize> outputMessages;
+    std::atomic<bool> outputEnabled { false };
+    std::atomic<double> outputSampleRate { 44100.0 };
+    std::atomic<int> outputLatencySamples { 0 };
+
+    std::atomic<int> pendingMode { -1 };  // Latched answer, -1 when none
+
+    void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
+    void handleAsyncUpdate() override;
+    void startOutput();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiController)
+};
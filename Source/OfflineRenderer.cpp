@@ -0,0 +1,38 @@
+#include "OfflineRenderer.h"
+
+OfflineRenderer::OfflineRenderer(double sampleRate, int blockSize, int numChannels)
+    : sampleRate(sampleRate)
+    , blockSize(blockSize)
+    , numChannels(numChannels)
+{
+}
+
+juce::AudioBuffer<float> OfflineRenderer::render(AudioEngine& engine,
+                                                 AudioEngine::ModeType mode,
+                                                 float rootFrequency,
+                                                 AudioEngine::PlaybackPattern pattern)
+{
+    engine.prepareToPlay(blockSize, sampleRate);
+    engine.playMode(mode, rootFrequency, pattern);
+
+    // Size the buffer from the note count so that it normally never grows
+    int samplesPerNote = static_cast<int>(engine.getNoteDuration() * sampleRate) + 1;
+    int expectedLength = engine.getNumNotesInPlayback() * samplesPerNote + blockSize;
+
+    juce::AudioBuffer<float> output(numChannels, expectedLength);
+    output.clear();
+
+    int position = 0;
+    while (engine.isCurrentlyPlaying())
+    {
+        if (position + blockSize > output.getNumSamples())
+            output.setSize(numChannels, output.getNumSamples() * 2, true, true);
+
+        juce::AudioSourceChannelInfo info(&output, position, blockSize);
+        engine.getNextAudioBlock(info);
+        position += blockSize;
+    }
+
+    output.setSize(numChannels, position, true, false, true);
+    return output;
+}
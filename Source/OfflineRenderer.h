@@ -0,0 +1,34 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "AudioEngine.h"
+
+// Renders AudioEngine exercises into memory without an audio device, by
+// pulling blocks through getNextAudioBlock exactly as a device would.
+class OfflineRenderer
+{
+public:
+    OfflineRenderer(double sampleRate, int blockSize = 512, int numChannels = 2);
+
+    /**
+     * Play one exercise on the given engine and capture all of its output
+     * @param engine Engine to render with (its speed setting is used as-is)
+     * @param mode Mode to play
+     * @param rootFrequency Root note frequency in Hz
+     * @param pattern Playback pattern
+     * @return Rendered audio, trimmed to the block in which playback finished
+     */
+    juce::AudioBuffer<float> render(AudioEngine& engine,
+                                    AudioEngine::ModeType mode,
+                                    float rootFrequency,
+                                    AudioEngine::PlaybackPattern pattern);
+
+    double getSampleRate() const { return sampleRate; }
+    int getBlockSize() const { return blockSize; }
+
+private:
+    double sampleRate;
+    int blockSize;
+    int numChannels;
+};
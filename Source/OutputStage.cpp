@@ -0,0 +1,57 @@
+#include "OutputStage.h"
+#include <cmath>
+
+OutputStage::OutputStage()
+    : numGains(0)
+{
+    gains.fill(1.0f);
+}
+
+void OutputStage::setPosition(float position, int numChannels)
+{
+    numGains = juce::jlimit(0, kMaxChannels, numChannels);
+    if (position < 0.0f || numGains == 1)
+    {
+        std::fill(gains.begin(), gains.begin() + numGains, 1.0f);
+        return;
+    }
+
+    std::fill(gains.begin(), gains.begin() + numGains, 0.0f);
+    if (numGains == 0)
+        return;
+
+    // Constant-power pan between the two channels either side of the position
+    float channelPosition = juce::jlimit(0.0f, 1.0f, position) * static_cast<float>(numGains - 1);
+    int leftChannel = juce::jmin(static_cast<int>(channelPosition), numGains - 2);
+    float fraction = channelPosition - static_cast<float>(leftChannel);
+    float angle = fraction * juce::MathConstants<float>::halfPi;
+
+    gains[static_cast<size_t>(leftChannel)] = std::cos(angle);
+    gains[static_cast<size_t>(leftChannel + 1)] = std::sin(angle);
+}
+
+void OutputStage::writeToOutput(const juce::AudioSourceChannelInfo& bufferToFill, const float* source, int numSamples)
+{
+    auto* buffer = bufferToFill.buffer;
+    int startSample = bufferToFill.startSample;
+
+    for (int channel = 0; channel < buffer->getNumChannels(); ++channel)
+    {
+        float gain = (channel < numGains) ? gains[static_cast<size_t>(channel)] : 0.0f;
+        auto* output = buffer->getWritePointer(channel, startSample);
+
+        if (source == nullptr || gain == 0.0f)
+            juce::FloatVectorOperations::clear(output, numSamples);
+        else if (gain == 1.0f)
+            juce::FloatVectorOperations::copy(output, source, numSamples);
+        else
+            juce::FloatVectorOperations::copyWithMultiply(output, source, gain, numSamples);
+    }
+}
+
+void OutputStage::addToOutput(const juce::AudioSourceChannelInfo& bufferToFill, const float* source, int numSamples)
+{
+    for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        juce::FloatVectorOperations::add(bufferToFill.buffer->getWritePointer(channel, bufferToFill.startSample),
+                                         source, numSamples);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <array>
+
+// Fans a mono signal out to however many output channels the device has.
+//
+// Channels are treated as evenly spaced from left (first) to right (last).
+// Unpanned, every channel gets the signal at full level. Panned, the signal is
+// placed between the two nearest channels with constant-power gains, so mono
+// devices get it unchanged and stereo devices get a normal pan law.
+class OutputStage
+{
+public:
+    static constexpr int kMaxChannels = 64;
+
+    OutputStage();
+
+    /**
+     * Set where the signal is placed
+     * @param position 0 is the first channel, 1 the last, or negative for every channel at full level
+     * @param numChannels Number of output channels
+     */
+    void setPosition(float position, int numChannels);
+
+    /**
+     * Copy a mono signal to every output channel with the current gains
+     * @param bufferToFill Output region to write to
+     * @param source Mono signal, or nullptr to write silence
+     * @param numSamples Number of samples to write
+     */
+    void writeToOutput(const juce::AudioSourceChannelInfo& bufferToFill, const float* source, int numSamples);
+
+    /** Mix a mono signal into every output channel at full level, e.g. a reverb return */
+    static void addToOutput(const juce::AudioSourceChannelInfo& bufferToFill, const float* source, int numSamples);
+
+private:
+    std::array<float, kMaxChannels> gains;
+    int numGains;
+};
@@ -0,0 +1,274 @@
+#include "PatternLanguage.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const int kLowestDegree = 1 - 7 * PatternLanguage::kMaxOctaveSpan;
+    const int kHighestDegree = 1 + 7 * PatternLanguage::kMaxOctaveSpan;
+
+    juce::String getRangeError()
+    {
+        return "notes must stay within " + juce::String(PatternLanguage::kMaxOctaveSpan) + " octaves of the root";
+    }
+
+    // "5", "7-", "2+", "1++"
+    bool parseDegree(const juce::String& token, int& degree, juce::String& error)
+    {
+        auto digits = token.initialCharactersOf("0123456789");
+        auto octaveShifts = token.substring(digits.length());
+        if (digits.isEmpty() || !octaveShifts.containsOnly("+-"))
+            return false;
+
+        // Checked here as well as on the finished pattern, so that a run
+        // between far-off degrees is never expanded
+        if (digits.length() > 9)
+        {
+            error = getRangeError();
+            return false;
+        }
+        if (digits.getIntValue() < 1)
+            return false;
+
+        juce::int64 octaves = 0;
+        for (int i = 0; i < octaveShifts.length(); ++i)
+            octaves += (octaveShifts[i] == '+') ? 1 : -1;
+
+        juce::int64 shifted = digits.getIntValue() + 7 * octaves;
+        if (shifted < kLowestDegree || shifted > kHighestDegree)
+        {
+            error = getRangeError();
+            return false;
+        }
+
+        degree = static_cast<int>(shifted);
+        return true;
+    }
+
+    // A single degree or a stepwise run such as "1..8" or "8..1"
+    bool parseRun(const juce::String& token, std::vector<int>& run, juce::String& error)
+    {
+        run.clear();
+        if (!token.contains(".."))
+        {
+            int degree;
+            if (!parseDegree(token, degree, error))
+                return false;
+            run.push_back(degree);
+            return true;
+        }
+
+        int first, last;
+        if (!parseDegree(token.upToFirstOccurrenceOf("..", false, false), first, error)
+            || !parseDegree(token.fromFirstOccurrenceOf("..", false, false), last, error))
+            return false;
+
+        if (std::abs(last - first) + 1 > PatternLanguage::kMaxNotes)
+        {
+            error = "pattern has more than " + juce::String(PatternLanguage::kMaxNotes) + " notes";
+            return false;
+        }
+
+        int step = (last >= first) ? 1 : -1;
+        for (int degree = first; degree != last + step; degree += step)
+            run.push_back(degree);
+        return true;
+    }
+
+    int getDirection(const std::vector<int>& run)
+    {
+        return (run.size() > 1 && run[1] < run[0]) ? -1 : 1;
+    }
+
+    bool parseItem(const juce::StringArray& tokens, int& index, std::vector<int>& notes,
+                   bool& shuffled, juce::String& error)
+    {
+        if (index >= tokens.size())
+        {
+            error = "missing notes at end of pattern";
+            return false;
+        }
+
+        auto token = tokens[index++].toLowerCase();
+        std::vector<int> run;
+
+        if (token == "shuffle" || token == "reverse")
+        {
+            std::vector<int> inner;
+            if (!parseItem(tokens, index, inner, shuffled, error))
+                return false;
+            if (token == "shuffle")
+                shuffled = true;
+            else
+                std::reverse(inner.begin(), inner.end());
+            notes.insert(notes.end(), inner.begin(), inner.end());
+            return true;
+        }
+
+        if (token == "cycle")
+        {
+            // Up to the span limit, so the second degree of each pair can't overflow
+            const int maximumInterval = 7 * PatternLanguage::kMaxOctaveSpan + 1;
+            auto intervalToken = (index < tokens.size()) ? tokens[index++] : juce::String();
+            int interval = intervalToken.length() <= 3 ? intervalToken.getIntValue() : 0;
+            if (interval < 2 || interval > maximumInterval)
+            {
+                error = "cycle needs an interval from 2 to " + juce::String(maximumInterval) + ", e.g. \"cycle 3 1..7\"";
+                return false;
+            }
+            if (index >= tokens.size() || !parseRun(tokens[index++], run, error))
+            {
+                if (error.isEmpty())
+                    error = "cycle needs a run of degrees, e.g. \"cycle 3 1..7\"";
+                return false;
+            }
+
+            int direction = getDirection(run);
+            for (int degree : run)
+            {
+                notes.push_back(degree);
+                notes.push_back(degree + (interval - 1) * direction);
+            }
+            return true;
+        }
+
+        if (token == "triads")
+        {
+            if (index >= tokens.size() || !parseRun(tokens[index++], run, error))
+            {
+                if (error.isEmpty())
+                    error = "triads needs a run of degrees, e.g. \"triads 1..5\"";
+                return false;
+            }
+
+            int direction = getDirection(run);
+            for (int degree : run)
+            {
+                notes.push_back(degree);
+                notes.push_back(degree + 2 * direction);
+                notes.push_back(degree + 4 * direction);
+            }
+            return true;
+        }
+
+        if (!parseRun(token, run, error))
+        {
+            if (error.isEmpty())
+                error = "\"" + token + "\" is not a degree, run or pattern keyword";
+            return false;
+        }
+
+        notes.insert(notes.end(), run.begin(), run.end());
+        return true;
+    }
+}
+
+bool PatternLanguage::parse(const juce::String& source, PatternCode& code, juce::String& error)
+{
+    error.clear();
+    auto tokens = juce::StringArray::fromTokens(source, " ,\t", "");
+    tokens.removeEmptyStrings();
+
+    PatternCode result;
+    int index = 0;
+    while (index < tokens.size())
+    {
+        std::vector<int> notes;
+        bool shuffled = false;
+        if (!parseItem(tokens, index, notes, shuffled, error))
+            return false;
+
+        if (shuffled && notes.size() > 1)
+            result.shuffles.emplace_back(static_cast<int>(result.degrees.size()), static_cast<int>(notes.size()));
+        result.degrees.insert(result.degrees.end(), notes.begin(), notes.end());
+
+        if (static_cast<int>(result.degrees.size()) > kMaxNotes)
+        {
+            error = "pattern has more than " + juce::String(kMaxNotes) + " notes";
+            return false;
+        }
+    }
+
+    if (result.degrees.empty())
+    {
+        error = "pattern has no notes";
+        return false;
+    }
+
+    // Runs are checked as they're read, but cycles and triads reach past them
+    for (int degree : result.degrees)
+    {
+        if (degree < kLowestDegree || degree > kHighestDegree)
+        {
+            error = getRangeError();
+            return false;
+        }
+    }
+
+    code = std::move(result);
+    return true;
+}
+
+std::vector<PatternLanguage::Definition> PatternLanguage::parseDefinitions(const juce::String& text, juce::StringArray& errors)
+{
+    std::vector<Definition> definitions;
+    auto lines = juce::StringArray::fromLines(text);
+
+    for (int lineIndex = 0; lineIndex < lines.size(); ++lineIndex)
+    {
+        auto line = lines[lineIndex].trim();
+        if (line.isEmpty() || line.startsWithChar('#'))
+            continue;
+
+        Definition definition;
+        definition.name = line.upToFirstOccurrenceOf(":", false, false).trim();
+        definition.source = line.fromFirstOccurrenceOf(":", false, false).trim();
+
+        juce::String error;
+        if (!line.containsChar(':') || definition.name.isEmpty())
+            error = "expected \"Name: pattern\"";
+        else if (parse(definition.source, definition.code, error))
+        {
+            definitions.push_back(std::move(definition));
+            continue;
+        }
+
+        errors.add("Line " + juce::String(lineIndex + 1) + ": " + error);
+    }
+
+    return definitions;
+}
+
+int PatternLanguage::degreeToSemitones(int degree, const std::vector<int>& scaleSemitones)
+{
+    int zeroBased = degree - 1;
+    int octave = (zeroBased >= 0) ? zeroBased / 7 : -((6 - zeroBased) / 7);
+    int index = zeroBased - 7 * octave;
+    return scaleSemitones[static_cast<size_t>(index)] + 12 * octave;
+}
+
+PatternLanguage::NoteProgram PatternLanguage::compile(const PatternCode& code, const std::vector<int>& scaleSemitones)
+{
+    jassert(scaleSemitones.size() >= 7);
+
+    // The note table holds each distinct degree once, lowest first
+    std::vector<int> tableDegrees = code.degrees;
+    std::sort(tableDegrees.begin(), tableDegrees.end());
+    tableDegrees.erase(std::unique(tableDegrees.begin(), tableDegrees.end()), tableDegrees.end());
+
+    NoteProgram program;
+    for (int degree : tableDegrees)
+    {
+        int semitones = degreeToSemitones(degree, scaleSemitones);
+        program.frequencyRatios.push_back(static_cast<float>(std::pow(2.0, semitones / 12.0)));
+    }
+
+    for (int degree : code.degrees)
+    {
+        auto position = std::lower_bound(tableDegrees.begin(), tableDegrees.end(), degree);
+        program.order.push_back(static_cast<int>(position - tableDegrees.begin()));
+    }
+
+    program.shuffles = code.shuffles;
+    return program;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <utility>
+#include <vector>
+
+// A small text language for playback patterns, compiled once into flat note
+// programs so that starting playback only has to copy a precompiled program.
+//
+// A pattern definition is one line, "Name: items", where items are separated by
+// spaces or commas:
+//   5        Scale degree (1 = root, 8 = octave, 9 = the 9th, ...)
+//   7- 2+    Degree shifted down or up an octave per '-' or '+'
+//   1..8     Stepwise run; runs descend when the first degree is higher
+//   cycle 3 1..7    Interval cycle over a run: each degree followed by the degree
+//                   a 3rd (or 4th, 5th, ...) further in the run's direction
+//   triads 1..5     Each degree of the run followed by its 3rd and 5th
+//   reverse <item>  The item's notes in reverse order
+//   shuffle <item>  The item's notes in a new random order on every play
+// Lines starting with '#' are comments.
+class PatternLanguage
+{
+public:
+    static constexpr int kMaxNotes = 256;       // Longest program a pattern may compile to
+    static constexpr int kMaxOctaveSpan = 3;    // Degrees may reach this many octaves from the root
+
+    // Pattern compiled to scale degrees, independent of the mode
+    struct PatternCode
+    {
+        std::vector<int> degrees;                   // 1-based degrees, 0 and below are under the root
+        std::vector<std::pair<int, int>> shuffles;  // (start, length) ranges of degrees to shuffle
+    };
+
+    // Flat program for one (scale, pattern): a table of notes and the order to play them
+    struct NoteProgram
+    {
+        std::vector<float> frequencyRatios;         // Each table entry's frequency relative to the root
+        std::vector<int> order;                     // Table indices in playback order
+        std::vector<std::pair<int, int>> shuffles;  // (start, length) ranges of order to shuffle
+    };
+
+    struct Definition
+    {
+        juce::String name;
+        juce::String source;
+        PatternCode code;
+    };
+
+    /**
+     * Parse the items of one pattern
+     * @param source Pattern items, e.g. "1, shuffle 2..8"
+     * @param code Set to the compiled pattern on success
+     * @param error Set to a description of the problem on failure
+     * @return true on success
+     */
+    static bool parse(const juce::String& source, PatternCode& code, juce::String& error);
+
+    /**
+     * Parse a file's worth of "Name: items" definitions
+     * @param text Definitions, one per line
+     * @param errors Receives a message for each line that could not be parsed
+     * @return Successfully parsed definitions
+     */
+    static std::vector<Definition> parseDefinitions(const juce::String& text, juce::StringArray& errors);
+
+    /**
+     * Resolve a pattern against a scale
+     * @param code Compiled pattern
+     * @param scaleSemitones Semitones above the root of scale degrees 1 to 7
+     * @return Program for this scale
+     */
+    static NoteProgram compile(const PatternCode& code, const std::vector<int>& scaleSemitones);
+
+    /** Semitones above the root of a degree, which may be outside the first octave */
+    static int degreeToSemitones(int degree, const std::vector<int>& scaleSemitones);
+};
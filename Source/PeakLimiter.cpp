@@ -0,0 +1,146 @@
+#include "PeakLimiter.h"
+#include <cmath>
+#include <cstring>
+
+PeakLimiter::PeakLimiter()
+    : lookahead(1)
+    , maximumBlockSize(0)
+    , numChannelsHeld(0)
+    , releaseCoefficient(1.0f)
+    , windowPosition(0)
+    , windowSum(0.0)
+    , releasedGain(1.0f)
+    , minimumStart(0)
+    , minimumCount(0)
+    , sampleCount(0)
+{
+}
+
+void PeakLimiter::prepare(double sampleRate, int newMaximumBlockSize)
+{
+    lookahead = juce::jmax(1, juce::roundToInt(kLookaheadSeconds * sampleRate));
+    maximumBlockSize = juce::jmax(1, newMaximumBlockSize);
+    releaseCoefficient = static_cast<float>(1.0 - std::exp(-1.0 / (kReleaseSeconds * sampleRate)));
+
+    delayLines.setSize(kMaxChannels, lookahead + maximumBlockSize);
+    peaks.assign(static_cast<size_t>(maximumBlockSize), 0.0f);
+    window.assign(static_cast<size_t>(lookahead + 1), 1.0f);
+    minimumValues.assign(static_cast<size_t>(lookahead + 1), 1.0f);
+    minimumTimes.assign(static_cast<size_t>(lookahead + 1), 0);
+    reset();
+}
+
+void PeakLimiter::reset()
+{
+    delayLines.clear();
+    std::fill(window.begin(), window.end(), 1.0f);
+    windowPosition = 0;
+    windowSum = static_cast<double>(window.size());
+    releasedGain = 1.0f;
+    minimumStart = 0;
+    minimumCount = 0;
+    sampleCount = 0;
+}
+
+int PeakLimiter::getLatencyInSamples() const
+{
+    return lookahead;
+}
+
+bool PeakLimiter::isSilent() const
+{
+    for (int channel = 0; channel < numChannelsHeld; ++channel)
+    {
+        auto range = juce::FloatVectorOperations::findMinAndMax(delayLines.getReadPointer(channel), lookahead);
+        if (range.getStart() < -kSilence || range.getEnd() > kSilence)
+            return false;
+    }
+    return true;
+}
+
+void PeakLimiter::process(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    if (maximumBlockSize == 0)
+    {
+        jassertfalse; // prepare() hasn't been called
+        return;
+    }
+
+    for (int offset = 0; offset < bufferToFill.numSamples;)
+    {
+        int numSamples = juce::jmin(bufferToFill.numSamples - offset, maximumBlockSize);
+        processChunk(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + offset, numSamples));
+        offset += numSamples;
+    }
+}
+
+void PeakLimiter::processChunk(const juce::AudioSourceChannelInfo& chunk)
+{
+    int numChannels = juce::jmin(chunk.buffer->getNumChannels(), kMaxChannels);
+    int numSamples = chunk.numSamples;
+    float* peak = peaks.data();
+    numChannelsHeld = numChannels;
+
+    // Queue each channel behind the samples carried over, and find the
+    // loudest channel at each sample
+    juce::FloatVectorOperations::clear(peak, numSamples);
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* delayed = delayLines.getWritePointer(channel);
+        float* incoming = delayed + lookahead;
+        juce::FloatVectorOperations::copy(incoming, chunk.buffer->getReadPointer(channel, chunk.startSample), numSamples);
+
+        // The input is now in the delay line and the output is written last,
+        // so the output region holds the magnitudes meanwhile
+        float* scratch = chunk.buffer->getWritePointer(channel, chunk.startSample);
+        juce::FloatVectorOperations::abs(scratch, incoming, numSamples);
+        juce::FloatVectorOperations::max(peak, peak, scratch, numSamples);
+    }
+
+    // Gain for each output sample, written over the peaks
+    for (int i = 0; i < numSamples; ++i)
+        peak[i] = getSmoothedGain(peak[i] > kCeiling ? kCeiling / peak[i] : 1.0f);
+
+    // Play the delayed samples with the gain, and carry the newest over
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* delayed = delayLines.getWritePointer(channel);
+        juce::FloatVectorOperations::multiply(chunk.buffer->getWritePointer(channel, chunk.startSample), delayed, peak, numSamples);
+        std::memmove(delayed, delayed + numSamples, sizeof(float) * static_cast<size_t>(lookahead));
+    }
+}
+
+float PeakLimiter::getSmoothedGain(float requiredGain)
+{
+    auto size = static_cast<int>(minimumValues.size());
+
+    // Lowest gain needed by this sample or the lookahead before it
+    if (minimumCount > 0 && minimumTimes[static_cast<size_t>(minimumStart)] <= sampleCount - size)
+    {
+        minimumStart = (minimumStart + 1) % size;
+        --minimumCount;
+    }
+    while (minimumCount > 0)
+    {
+        int newest = (minimumStart + minimumCount - 1) % size;
+        if (minimumValues[static_cast<size_t>(newest)] < requiredGain)
+            break;
+        --minimumCount;
+    }
+    int slot = (minimumStart + minimumCount) % size;
+    minimumValues[static_cast<size_t>(slot)] = requiredGain;
+    minimumTimes[static_cast<size_t>(slot)] = sampleCount;
+    ++minimumCount;
+    ++sampleCount;
+    float held = minimumValues[static_cast<size_t>(minimumStart)];
+
+    // Down at once, back up smoothly
+    releasedGain = held < releasedGain ? held : releasedGain + releaseCoefficient * (held - releasedGain);
+
+    // Averaging over the lookahead + 1 samples that the held value covers
+    // ramps the gain down to its lowest by the time the peak is played
+    windowSum += releasedGain - window[static_cast<size_t>(windowPosition)];
+    window[static_cast<size_t>(windowPosition)] = releasedGain;
+    windowPosition = (windowPosition + 1) % size;
+    return static_cast<float>(windowSum / size);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+#include "OutputStage.h"
+
+// Keeps the engine's output below a ceiling without clipping, for timbres and
+// loudness-compensated low notes whose peaks would otherwise pass full scale.
+//
+// The output is delayed by a short look-ahead, so the gain can start coming
+// down before a peak arrives rather than cutting into it. The gain is the
+// lowest any sample in the look-ahead needs, released smoothly and then
+// averaged over the look-ahead, so it reaches its lowest exactly when the
+// peak is played and never steps. One gain is shared by every channel, so
+// panning is kept.
+//
+// Delaying, peak detection and applying the gain run a block at a time with
+// juce::FloatVectorOperations; only the gain curve is worked out per sample,
+// in a few comparisons and adds.
+class PeakLimiter
+{
+public:
+    static constexpr float kCeiling = 0.891f;             // -1 dBFS
+    static constexpr double kLookaheadSeconds = 0.001;
+    static constexpr double kReleaseSeconds = 0.05;
+    static constexpr float kSilence = 1.0e-4f;            // -80 dBFS
+    static constexpr int kMaxChannels = OutputStage::kMaxChannels;
+
+    PeakLimiter();
+
+    /** Allocate buffers; call before processing, off the audio thread */
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /** Forget any audio in the look-ahead, e.g. when the limiter is switched on */
+    void reset();
+
+    /** Limit a block in place, delaying it by getLatencyInSamples() */
+    void process(const juce::AudioSourceChannelInfo& bufferToFill);
+
+    int getLatencyInSamples() const;
+
+    /** True if nothing in the look-ahead is above kSilence, so bypassing the limiter drops nothing audible */
+    bool isSilent() const;
+
+private:
+    int lookahead;
+    int maximumBlockSize;
+    int numChannelsHeld;  // Channels in the last block, which the look-ahead holds
+    float releaseCoefficient;
+
+    juce::AudioBuffer<float> delayLines;  // Per channel: lookahead samples carried over, then the block
+    std::vector<float> peaks;             // Per sample of the block, then its gain
+    std::vector<float> window;            // Box filter history, lookahead + 1 samples
+    int windowPosition;
+    double windowSum;
+    float releasedGain;
+
+    // Sliding minimum over the last lookahead + 1 required gains: increasing
+    // values, oldest first, in a ring
+    std::vector<float> minimumValues;
+    std::vector<juce::int64> minimumTimes;
+    int minimumStart;
+    int minimumCount;
+    juce::int64 sampleCount;
+
+    void processChunk(const juce::AudioSourceChannelInfo& chunk);
+    float getSmoothedGain(float requiredGain);
+};
@@ -0,0 +1,297 @@
+#include "PitchShifter.h"
+#include "DspNodes.h"
+#include "OfflineRenderer.h"
+#include "RenderCache.h"
+#include "RenderVerifier.h"
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    // Modified Bessel function of the first kind, order 0, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Kept as four running sums so the compiler can keep them in one SIMD register
+    inline float dotProduct(const float* kernelRow, const float* input)
+    {
+        float lanes[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int tap = 0; tap < PitchShifter::kNumTaps; tap += 4)
+            for (int lane = 0; lane < 4; ++lane)
+                lanes[lane] += kernelRow[tap + lane] * input[tap + lane];
+        return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+    }
+
+    size_t getBytes(const juce::AudioBuffer<float>& audio)
+    {
+        return sizeof(float) * static_cast<size_t>(audio.getNumSamples() * audio.getNumChannels());
+    }
+
+    /**
+     * Energy left in a note after removing the best fit of the expected tone
+     * under the note envelope, relative to the note's energy
+     */
+    double measureErrorDecibels(const float* note, int length, double frequency, double sampleRate, float samplesPerNote)
+    {
+        double angleDelta = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        double ss = 0.0, sc = 0.0, cc = 0.0, ys = 0.0, yc = 0.0, yy = 0.0;
+        for (int n = 0; n < length; ++n)
+        {
+            double envelope = EnvelopeNode::getLevel(static_cast<float>(n), samplesPerNote);
+            double s = envelope * std::sin(angleDelta * n);
+            double c = envelope * std::cos(angleDelta * n);
+            ss += s * s;
+            sc += s * c;
+            cc += c * c;
+            ys += note[n] * s;
+            yc += note[n] * c;
+            yy += static_cast<double>(note[n]) * note[n];
+        }
+
+        double determinant = ss * cc - sc * sc;
+        if (yy <= 0.0 || determinant <= 0.0)
+            return 0.0;  // Silent, so nothing like the tone
+        double a = (ys * cc - yc * sc) / determinant;
+        double b = (yc * ss - ys * sc) / determinant;
+
+        double residual = 0.0;
+        for (int n = 0; n < length; ++n)
+        {
+            double envelope = EnvelopeNode::getLevel(static_cast<float>(n), samplesPerNote);
+            double difference = note[n] - envelope * (a * std::sin(angleDelta * n) + b * std::cos(angleDelta * n));
+            residual += difference * difference;
+        }
+        return 10.0 * std::log10(juce::jmax(residual / yy, 1.0e-20));
+    }
+}
+
+PitchShifter::PitchShifter()
+    : kernel(static_cast<size_t>((kNumPhases + 1) * kNumTaps))
+{
+    // Row p holds a sinc centred p / kNumPhases of a sample after tap kNumTaps / 2 - 1
+    const double halfWidth = kNumTaps / 2;
+    for (int phase = 0; phase <= kNumPhases; ++phase)
+    {
+        for (int tap = 0; tap < kNumTaps; ++tap)
+        {
+            double distance = tap - (halfWidth - 1.0) - static_cast<double>(phase) / kNumPhases;
+            double sinc = distance == 0.0 ? 1.0
+                                          : std::sin(juce::MathConstants<double>::pi * distance) / (juce::MathConstants<double>::pi * distance);
+            double window = std::abs(distance) >= halfWidth
+                          ? 0.0
+                          : besselI0(kKaiserBeta * std::sqrt(1.0 - (distance / halfWidth) * (distance / halfWidth))) / besselI0(kKaiserBeta);
+            kernel[static_cast<size_t>(phase * kNumTaps + tap)] = static_cast<float>(sinc * window);
+        }
+    }
+}
+
+float PitchShifter::interpolate(const float* input, double position) const
+{
+    auto index = static_cast<int>(position);
+    double phase = (position - index) * kNumPhases;
+    auto row = static_cast<int>(phase);
+    auto fraction = static_cast<float>(phase - row);
+
+    const float* taps = input + index - (kNumTaps / 2 - 1);
+    const float* rowBelow = kernel.data() + row * kNumTaps;
+    float below = dotProduct(rowBelow, taps);
+    float above = dotProduct(rowBelow + kNumTaps, taps);
+    return below + fraction * (above - below);
+}
+
+juce::AudioBuffer<float> PitchShifter::shift(const juce::AudioBuffer<float>& tones, double ratio,
+                                             float noteDuration, double sampleRate) const
+{
+    jassert(ratio > 0.0 && ratio <= 1.0);
+    ratio = juce::jlimit(0.0, 1.0, ratio);
+
+    // The same note length and envelope as the engine's
+    int samplesPerNote = static_cast<int>(noteDuration * sampleRate);
+    float envelopeLength = noteDuration * static_cast<float>(sampleRate);
+    int numSamples = tones.getNumSamples();
+    int numNotes = samplesPerNote > 0 ? numSamples / samplesPerNote : 0;
+
+    // Padded with silence so the kernel can run off either end
+    std::vector<float> input(static_cast<size_t>(numSamples + 2 * kNumTaps), 0.0f);
+    if (numSamples > 0)
+        juce::FloatVectorOperations::copy(input.data() + kNumTaps, tones.getReadPointer(0), numSamples);
+
+    juce::AudioBuffer<float> output(1, numSamples);
+    output.clear();
+    auto* samples = output.getWritePointer(0);
+
+    for (int note = 0; note < numNotes; ++note)
+    {
+        int noteStart = note * samplesPerNote;
+        for (int n = 0; n < samplesPerNote; ++n)
+        {
+            float level = EnvelopeNode::getLevel(static_cast<float>(n), envelopeLength);
+            samples[noteStart + n] = level * interpolate(input.data() + kNumTaps, noteStart + n * ratio);
+        }
+    }
+    return output;
+}
+
+// MARK: - (Verification)
+
+PitchShifter::Result PitchShifter::verify(const Settings& settings)
+{
+    Result result;
+    juce::CriticalSection resultLock;
+
+    AudioEngine modeSource;
+    std::vector<AudioEngine::PlaybackPattern> patterns;
+    for (auto pattern : modeSource.getAllPatterns())
+        if (pattern != AudioEngine::PlaybackPattern::Random)  // Reference and direct renders would shuffle differently
+            patterns.push_back(pattern);
+
+    // One job per (sample rate, mode), each with its own engines
+    juce::ThreadPool pool;
+    for (double sampleRate : settings.sampleRates)
+    {
+        for (auto mode : modeSource.getAllModes())
+        {
+            pool.addJob([&, sampleRate, mode]
+            {
+                Result jobResult;
+                AudioEngine toneEngine, directEngine;
+                toneEngine.setEnvelopeEnabled(false);
+                toneEngine.setPlaybackSpeed(settings.playbackSpeed);
+                directEngine.setPlaybackSpeed(settings.playbackSpeed);
+
+                PitchShifter shifter;
+                RenderVerifier analyser;
+                OfflineRenderer renderer(sampleRate, 512, 1);
+                float noteDuration = directEngine.getNoteDuration();
+                int samplesPerNote = static_cast<int>(noteDuration * sampleRate);
+                float envelopeLength = noteDuration * static_cast<float>(sampleRate);
+                auto referenceFrequency = RenderCache::rootNoteIndexToFrequency(settings.referenceRootNoteIndex);
+
+                for (auto pattern : patterns)
+                {
+                    auto tones = renderer.render(toneEngine, mode, referenceFrequency, pattern);
+                    jobResult.referenceBytes += getBytes(tones);
+
+                    for (int root = 0; root <= settings.referenceRootNoteIndex; ++root)
+                    {
+                        auto rootFrequency = RenderCache::rootNoteIndexToFrequency(root);
+                        auto where = juce::String(sampleRate, 0) + " Hz " + modeSource.getModeName(mode) + " / "
+                                   + modeSource.getPatternName(pattern) + " root " + juce::String(root) + ": ";
+
+                        auto startTime = juce::Time::getMillisecondCounterHiRes();
+                        auto direct = renderer.render(directEngine, mode, rootFrequency, pattern);
+                        auto renderedTime = juce::Time::getMillisecondCounterHiRes();
+                        auto shifted = shifter.shift(tones, rootFrequency / referenceFrequency, noteDuration, sampleRate);
+                        jobResult.renderSeconds += (renderedTime - startTime) / 1000.0;
+                        jobResult.shiftSeconds += (juce::Time::getMillisecondCounterHiRes() - renderedTime) / 1000.0;
+                        jobResult.directBytes += getBytes(direct);
+                        jobResult.numExercises++;
+
+                        if (shifted.getNumSamples() != direct.getNumSamples())
+                        {
+                            jobResult.failures.add(where + "length differs from the direct render");
+                            continue;
+                        }
+
+                        // Each note against the exact frequency the engine plays
+                        auto playback = directEngine.preparePlayback(mode, rootFrequency, pattern);
+                        double worstError = -200.0;
+                        for (size_t note = 0; note < playback.order.size(); ++note)
+                        {
+                            auto frequency = playback.scale[static_cast<size_t>(playback.order[note])];
+                            auto error = measureErrorDecibels(shifted.getReadPointer(0, static_cast<int>(note) * samplesPerNote),
+                                                              samplesPerNote, frequency, sampleRate, envelopeLength);
+                            worstError = juce::jmax(worstError, error);
+                        }
+                        jobResult.worstErrorDecibels = juce::jmax(jobResult.worstErrorDecibels, worstError);
+                        if (worstError > kMaxErrorDecibels)
+                            jobResult.failures.add(where + "error " + juce::String(worstError, 1) + " dB");
+
+                        // And as the pitch analysis hears it, with notes starting in the same places
+                        auto directNotes = analyser.analyse(direct, sampleRate);
+                        auto shiftedNotes = analyser.analyse(shifted, sampleRate);
+                        if (directNotes.size() != shiftedNotes.size())
+                        {
+                            jobResult.failures.add(where + juce::String(static_cast<int>(shiftedNotes.size())) + " notes found, "
+                                                   + juce::String(static_cast<int>(directNotes.size())) + " when rendered directly");
+                            continue;
+                        }
+                        for (size_t note = 0; note < directNotes.size(); ++note)
+                        {
+                            double cents = 1200.0 * std::log2(shiftedNotes[note].frequency / directNotes[note].frequency);
+                            jobResult.worstCentsError = juce::jmax(jobResult.worstCentsError, std::abs(cents));
+                            if (std::abs(cents) > kMaxCentsError)
+                                jobResult.failures.add(where + "note " + juce::String(static_cast<int>(note) + 1) + " off by "
+                                                       + juce::String(cents, 2) + " cents");
+                            if (std::abs(shiftedNotes[note].onsetSample - directNotes[note].onsetSample) > samplesPerNote / 100)
+                                jobResult.failures.add(where + "note " + juce::String(static_cast<int>(note) + 1) + " starts "
+                                                       + juce::String(shiftedNotes[note].onsetSample - directNotes[note].onsetSample)
+                                                       + " samples from the direct render's");
+                        }
+                    }
+                }
+
+                const juce::ScopedLock lock(resultLock);
+                result.numExercises += jobResult.numExercises;
+                result.worstErrorDecibels = juce::jmax(result.worstErrorDecibels, jobResult.worstErrorDecibels);
+                result.worstCentsError = juce::jmax(result.worstCentsError, jobResult.worstCentsError);
+                result.referenceBytes += jobResult.referenceBytes;
+                result.directBytes += jobResult.directBytes;
+                result.shiftSeconds += jobResult.shiftSeconds;
+                result.renderSeconds += jobResult.renderSeconds;
+                result.failures.addArray(jobResult.failures);
+            });
+        }
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(5);
+
+    result.failures.sort(false);
+    return result;
+}
+
+void PitchShifter::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--rates"))
+    {
+        settings.sampleRates.clear();
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--rates"), ",", ""))
+            settings.sampleRates.push_back(token.getDoubleValue());
+    }
+    if (args.containsOption("--speed"))
+        settings.playbackSpeed = juce::jlimit(0.5f, 3.0f, args.getValueForOption("--speed").getFloatValue());
+
+    for (double sampleRate : settings.sampleRates)
+        if (sampleRate < 8000.0 || sampleRate > 192000.0)
+            juce::ConsoleApplication::fail("--rates must be between 8000 and 192000", 1);
+
+    auto result = verify(settings);
+
+    std::cout << result.numExercises << " exercises shifted from A6: worst error " << juce::String(result.worstErrorDecibels, 1)
+              << " dB (limit " << juce::String(kMaxErrorDecibels, 0) << "), worst pitch difference "
+              << juce::String(result.worstCentsError, 3) << " cents" << std::endl;
+    std::cout << "Audio kept: " << juce::String(static_cast<double>(result.referenceBytes) / (1024.0 * 1024.0), 1) << " MB shifting, "
+              << juce::String(static_cast<double>(result.directBytes) / (1024.0 * 1024.0), 1) << " MB rendering every root ("
+              << juce::String(static_cast<double>(result.directBytes) / static_cast<double>(juce::jmax<size_t>(1, result.referenceBytes)), 1)
+              << "x); " << juce::String(result.shiftSeconds * 1000.0 / juce::jmax(1, result.numExercises), 2) << " ms per shift, "
+              << juce::String(result.renderSeconds * 1000.0 / juce::jmax(1, result.numExercises), 2) << " ms per render" << std::endl;
+
+    for (int i = 0; i < juce::jmin(result.failures.size(), 20); ++i)
+        std::cout << "FAIL  " << result.failures[i] << std::endl;
+    if (result.failures.size() > 20)
+        std::cout << "      ... and " << result.failures.size() - 20 << " more" << std::endl;
+
+    if (!result.failures.isEmpty())
+        juce::ConsoleApplication::fail(juce::String(result.failures.size()) + " checks failed", 1);
+}
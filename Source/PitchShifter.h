@@ -0,0 +1,80 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+#include "AudioEngine.h"
+
+// Moves a rendered exercise to a lower root without rendering it again, so a
+// cache can keep one rendering per mode, pattern and speed instead of one per
+// root. The exercise is rendered as sustained tones (see
+// AudioEngine::setEnvelopeEnabled); each note is read back more slowly through
+// a windowed-sinc interpolator, which lowers its pitch while it keeps its
+// length, and the note envelope is applied afterwards, so attack and release
+// keep their timing at every pitch.
+//
+// Every output sample costs the same two kNumTaps-tap dot products, on
+// adjacent rows of a kernel table built once, written as four independent
+// lanes the compiler turns into SIMD multiply-adds.
+//
+// Only lowers pitch: raising it would read past the end of each note and
+// need a narrower kernel to keep out aliases, so render the reference at the
+// highest root. Content near Nyquist is interpolated less accurately, so at
+// sample rates below 22.05 kHz the highest notes come out noticeably impure.
+class PitchShifter
+{
+public:
+    static constexpr int kNumTaps = 32;     // A multiple of 4
+    static constexpr int kNumPhases = 256;  // Kernel rows per input sample, interpolated between
+    static constexpr double kKaiserBeta = 8.0;
+
+    // Verification limits (see verify())
+    static constexpr double kMaxErrorDecibels = -70.0;  // Anything but the expected tone, relative to the note
+    static constexpr double kMaxCentsError = 1.0;       // Between shifted and directly rendered notes
+
+    PitchShifter();
+
+    /**
+     * Lower the pitch of sustained tones, keeping each note's timing, and apply the note envelope
+     * @param tones Mono notes without an envelope, back to back from sample 0
+     * @param ratio Frequency of the result over that of tones; 0 to 1
+     * @param noteDuration Seconds per note, as given by AudioEngine::getNoteDuration()
+     * @param sampleRate Sample rate of tones
+     * @return Audio the length of tones; samples after the last whole note are silent
+     */
+    juce::AudioBuffer<float> shift(const juce::AudioBuffer<float>& tones, double ratio,
+                                   float noteDuration, double sampleRate) const;
+
+    struct Settings
+    {
+        std::vector<double> sampleRates { 22050.0, 44100.0, 48000.0 };
+        float playbackSpeed = 3.0f;  // Fastest speed keeps the sweep short
+        int referenceRootNoteIndex = 36;  // A6, the highest root, as in RenderCache
+    };
+
+    struct Result
+    {
+        int numExercises = 0;
+        double worstErrorDecibels = -200.0;
+        double worstCentsError = 0.0;
+        size_t referenceBytes = 0;  // Audio kept when shifting
+        size_t directBytes = 0;     // Audio kept when rendering every root
+        double shiftSeconds = 0.0;
+        double renderSeconds = 0.0;
+        juce::StringArray failures;
+    };
+
+    /**
+     * Shift every mode and non-random built-in pattern from the reference root
+     * to each lower root and compare it with rendering that root directly
+     */
+    static Result verify(const Settings& settings);
+
+    /** Entry point for the --verify-pitch-shift command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    std::vector<float> kernel;  // (kNumPhases + 1) rows of kNumTaps, row p for a fraction p / kNumPhases
+
+    float interpolate(const float* input, double position) const;
+};
@@ -0,0 +1,51 @@
+#include "QuizScheduler.h"
+
+// MARK: - (JuceQuizScheduler)
+
+double JuceQuizScheduler::getMillisecondCounter() const
+{
+    return juce::Time::getMillisecondCounterHiRes();
+}
+
+void JuceQuizScheduler::callAfterDelay(int milliseconds, std::function<void()> callback)
+{
+    if (milliseconds <= 0)
+        juce::MessageManager::callAsync(std::move(callback));
+    else
+        juce::Timer::callAfterDelay(milliseconds, std::move(callback));
+}
+
+// MARK: - (VirtualQuizScheduler)
+
+double VirtualQuizScheduler::getMillisecondCounter() const
+{
+    return now;
+}
+
+void VirtualQuizScheduler::callAfterDelay(int milliseconds, std::function<void()> callback)
+{
+    pending.push({ now + juce::jmax(0, milliseconds), numScheduled++, std::move(callback) });
+}
+
+void VirtualQuizScheduler::advanceTo(double millisecondCounter)
+{
+    // Callbacks may schedule more, which run too if they come due in time
+    while (!pending.empty() && pending.top().dueTime <= millisecondCounter)
+    {
+        auto callback = pending.top().callback;
+        now = pending.top().dueTime;
+        pending.pop();
+        callback();
+    }
+    now = juce::jmax(now, millisecondCounter);
+}
+
+void VirtualQuizScheduler::advanceBy(double milliseconds)
+{
+    advanceTo(now + milliseconds);
+}
+
+int VirtualQuizScheduler::getNumPending() const
+{
+    return static_cast<int>(pending.size());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_events/juce_events.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Where a QuizSession gets its time and its delayed callbacks from: the
+// message loop and the real clock in the app, or a virtual clock that a test
+// advances as fast as it likes.
+class QuizScheduler
+{
+public:
+    virtual ~QuizScheduler() = default;
+
+    virtual double getMillisecondCounter() const = 0;
+
+    /** Call back later on the scheduler's thread; 0 means as soon as the current call returns */
+    virtual void callAfterDelay(int milliseconds, std::function<void()> callback) = 0;
+};
+
+// The message loop and juce::Time
+class JuceQuizScheduler : public QuizScheduler
+{
+public:
+    double getMillisecondCounter() const override;
+    void callAfterDelay(int milliseconds, std::function<void()> callback) override;
+};
+
+// Time only moves when advanceTo() or advanceBy() is called, which runs every
+// callback that has come due, in time order (and in the order they were
+// scheduled for equal times), each at its own time.
+class VirtualQuizScheduler : public QuizScheduler
+{
+public:
+    double getMillisecondCounter() const override;
+    void callAfterDelay(int milliseconds, std::function<void()> callback) override;
+
+    void advanceTo(double millisecondCounter);
+    void advanceBy(double milliseconds);
+
+    int getNumPending() const;
+
+private:
+    struct Pending
+    {
+        double dueTime;
+        juce::uint64 order;
+        std::function<void()> callback;
+
+        bool operator>(const Pending& other) const
+        {
+            return dueTime != other.dueTime ? dueTime > other.dueTime : order > other.order;
+        }
+    };
+
+    double now = 0.0;
+    juce::uint64 numScheduled = 0;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+};
@@ -0,0 +1,270 @@
+#include "QuizSession.h"
+#include "Trace.h"
+#include <cmath>
+
+namespace
+{
+    // Shuffles are recorded, so a replay doesn't depend on how many questions were prepared and thrown away
+    juce::var orderToVar(const std::vector<int>& order)
+    {
+        juce::Array<juce::var> values;
+        for (int index : order)
+            values.add(index);
+        return values;
+    }
+}
+
+bool QuizSession::Settings::operator==(const Settings& other) const
+{
+    return rootNoteIndex == other.rootNoteIndex
+        && randomizeRoot == other.randomizeRoot
+        && pattern == other.pattern;
+}
+
+QuizSession::QuizSession(AudioEngine& engineToUse, QuizScheduler& schedulerToUse, juce::int64 seed)
+: engine(engineToUse)
+, scheduler(schedulerToUse)
+, random(seed)
+{
+    showInstructions();
+}
+
+// MARK: - (Settings)
+
+void QuizSession::setSettings(const Settings& newSettings)
+{
+    if (newSettings == settings)
+        return;
+
+    settings = newSettings;
+    nextQuestion.reset();
+}
+
+const QuizSession::Settings& QuizSession::getSettings() const
+{
+    return settings;
+}
+
+// MARK: - (Questions)
+
+bool QuizSession::playQuestion()
+{
+    TRACE_SCOPE("QuizSession::playQuestion");
+    if (engine.isCurrentlyPlaying())
+        return false;
+
+    auto question = nextQuestion.has_value() ? *nextQuestion : chooseQuestion();
+    nextQuestion.reset();
+    if (!question.playback.isValid())
+        return false;
+
+    // Start the sound first; everything after this only updates the state
+    engine.onPlaybackFinished = [this]
+    {
+        // Not if it was answered, or another question started, before it finished
+        if (status == Status::playingForGuess)
+            setStatus(Status::waitingForGuess, "Click a mode button to enter your answer...");
+    };
+    engine.play(question.playback);
+
+    currentMode = question.playback.mode;
+    lastPlayedMode = currentMode;
+    currentPattern = question.playback.pattern;
+    currentRootFrequency = question.playback.rootFrequency;
+    record("play", {{ "mode", engine.getModeName(currentMode) },
+                    { "root", currentRootFrequency },
+                    { "pattern", engine.getPatternName(currentPattern) },
+                    { "order", orderToVar(question.playback.order) },
+                    { "quiz", true }});
+
+    // A randomly chosen root becomes the setting, as the slider shows it
+    if (settings.randomizeRoot)
+        settings.rootNoteIndex = question.rootNoteIndex;
+
+    questionActive = true;
+    setStatus(Status::playingForGuess, "Playing... Listen and select your answer below...");
+    return true;
+}
+
+QuizSession::Question QuizSession::chooseQuestion()
+{
+    Question question;
+    auto modes = engine.getAllModes();
+
+    // Avoid playing the same mode twice in a row
+    AudioEngine::ModeType newMode;
+    do {
+        int randomIndex = random.nextInt(static_cast<int>(modes.size()));
+        newMode = modes[static_cast<size_t>(randomIndex)];
+    } while (newMode == lastPlayedMode && modes.size() > 1);
+
+    if (settings.randomizeRoot)
+        question.rootNoteIndex = static_cast<int>(kMinRootNoteIndex + random.nextDouble() * (kMaxRootNoteIndex - kMinRootNoteIndex));
+    else
+        question.rootNoteIndex = settings.rootNoteIndex;
+
+    float rootFreq = static_cast<float>(noteIndexToFrequency(question.rootNoteIndex));
+    question.playback = engine.preparePlayback(newMode, rootFreq, settings.pattern);
+    return question;
+}
+
+void QuizSession::prepareNextQuestion()
+{
+    // Not while a question is being played or answered: it's chosen after the last one
+    if (questionActive || nextQuestion.has_value())
+        return;
+
+    nextQuestion = chooseQuestion();
+}
+
+// MARK: - (Answers and practice)
+
+bool QuizSession::chooseMode(AudioEngine::ModeType mode)
+{
+    if (questionActive)
+    {
+        answer(mode);
+        return true;
+    }
+
+    if (engine.isCurrentlyPlaying())
+        return false;
+
+    practice(mode);
+    return true;
+}
+
+void QuizSession::answer(AudioEngine::ModeType guessedMode)
+{
+    TRACE_SCOPE("QuizSession::answer");
+    numAnswered++;
+    bool correct = (guessedMode == currentMode);
+    record("guess", {{ "guess", engine.getModeName(guessedMode) },
+                     { "actual", engine.getModeName(currentMode) },
+                     { "correct", correct },
+                     { "root", currentRootFrequency },
+                     { "pattern", engine.getPatternName(currentPattern) }});
+
+    questionActive = false;
+    if (correct)
+    {
+        score++;
+        setStatus(Status::correctGuess, "Correct! That was " + engine.getModeName(currentMode) + ".");
+    }
+    else
+    {
+        setStatus(Status::incorrectGuess, "Incorrect. That was " + engine.getModeName(currentMode) +
+                  ", you guessed " + engine.getModeName(guessedMode) + ".");
+    }
+
+    // Work out the next question while this answer is read, once the feedback has been shown
+    scheduler.callAfterDelay(0, [safeThis = juce::WeakReference<QuizSession>(this)]
+    {
+        if (safeThis != nullptr)
+            safeThis->prepareNextQuestion();
+    });
+
+    // Then the instructions for the next turn, unless it has already started
+    scheduler.callAfterDelay(kFeedbackMilliseconds, [safeThis = juce::WeakReference<QuizSession>(this)]
+    {
+        if (safeThis != nullptr && !safeThis->questionActive)
+            safeThis->showInstructions();
+    });
+}
+
+void QuizSession::practice(AudioEngine::ModeType mode)
+{
+    float rootFreq = static_cast<float>(noteIndexToFrequency(settings.rootNoteIndex));
+    engine.onPlaybackFinished = [this]
+    {
+        // Show instructions when playback finishes
+        if (!questionActive && !engine.isCurrentlyPlaying())
+            showInstructions();
+    };
+    auto playback = engine.preparePlayback(mode, rootFreq, AudioEngine::PlaybackPattern::Ascending);
+    if (!playback.isValid())
+        return;
+    engine.play(playback);
+    record("play", {{ "mode", engine.getModeName(mode) },
+                    { "root", rootFreq },
+                    { "pattern", engine.getPatternName(playback.pattern) },
+                    { "order", orderToVar(playback.order) },
+                    { "quiz", false }});
+
+    setStatus(Status::playingForPractice, "Playing " + engine.getModeName(mode) + "... Try to remember how this sounds...");
+}
+
+void QuizSession::stop()
+{
+    engine.stopPlaying();
+    record("stop");
+    showInstructions();
+}
+
+void QuizSession::showInstructions()
+{
+    setStatus(Status::instructions, "Click \"Play Random Scale\" to test your knowledge, or click any mode button to hear that scale.");
+}
+
+// MARK: - (State)
+
+QuizSession::Status QuizSession::getStatus() const
+{
+    return status;
+}
+
+const juce::String& QuizSession::getStatusText() const
+{
+    return statusText;
+}
+
+bool QuizSession::isQuestionActive() const
+{
+    return questionActive;
+}
+
+int QuizSession::getScore() const
+{
+    return score;
+}
+
+int QuizSession::getNumAnswered() const
+{
+    return numAnswered;
+}
+
+AudioEngine::ModeType QuizSession::getCurrentMode() const
+{
+    return currentMode;
+}
+
+AudioEngine::PlaybackPattern QuizSession::getCurrentPattern() const
+{
+    return currentPattern;
+}
+
+float QuizSession::getCurrentRootFrequency() const
+{
+    return currentRootFrequency;
+}
+
+double QuizSession::noteIndexToFrequency(int noteIndex)
+{
+    // Each semitone up multiplies frequency by 2^(1/12)
+    double a3 = 220.0;
+    return a3 * std::pow(2.0, noteIndex / 12.0);
+}
+
+void QuizSession::setStatus(Status newStatus, const juce::String& text)
+{
+    status = newStatus;
+    statusText = text;
+    if (onStatusChanged)
+        onStatusChanged();
+}
+
+void QuizSession::record(const juce::String& action, juce::NamedValueSet properties)
+{
+    if (onEvent)
+        onEvent(action, std::move(properties));
+}
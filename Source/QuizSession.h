@@ -0,0 +1,120 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include <functional>
+#include <optional>
+#include "AudioEngine.h"
+#include "QuizScheduler.h"
+
+// The game, without any widgets: which question is being asked, what the
+// status line says, and the score. MainComponent forwards its buttons here and
+// shows what it's told through onStatusChanged. Every delay goes through the
+// QuizScheduler and every playback through the AudioEngine, so a test can run
+// whole sessions on a virtual clock with the audio rendered offline (see
+// QuizSimulator).
+//
+// Call everything on the scheduler's thread; onPlaybackFinished is delivered
+// there too, by the engine's timer or its dispatchPendingNotifications().
+class QuizSession
+{
+public:
+    enum class Status : int
+    {
+        instructions,
+        playingForPractice,
+        playingForGuess,
+        waitingForGuess,
+        correctGuess,
+        incorrectGuess
+    };
+
+    static constexpr int kFeedbackMilliseconds = 2000;  // Correct/incorrect is shown this long
+    static constexpr int kMinRootNoteIndex = 12;        // A4; see noteIndexToFrequency()
+    static constexpr int kMaxRootNoteIndex = 24;        // A5
+
+    // What the player has chosen for the next question
+    struct Settings
+    {
+        int rootNoteIndex = 15;  // C5
+        bool randomizeRoot = false;
+        AudioEngine::PlaybackPattern pattern = AudioEngine::PlaybackPattern::Ascending;
+
+        bool operator==(const Settings& other) const;
+        bool operator!=(const Settings& other) const { return !operator==(other); }
+    };
+
+    QuizSession(AudioEngine& engine, QuizScheduler& scheduler, juce::int64 seed);
+
+    /** A change throws away the question prepared for next */
+    void setSettings(const Settings& newSettings);
+    const Settings& getSettings() const;  // rootNoteIndex follows a randomized root
+
+    /** Ask a new question, unless something is still playing; false if nothing was played */
+    bool playQuestion();
+
+    /** The answer to the question being asked, or else play the mode for practice; false if ignored */
+    bool chooseMode(AudioEngine::ModeType mode);
+
+    /** Stop the sound. A question being asked can still be answered. */
+    void stop();
+
+    /** Choose and work out the next question now, so playQuestion() only has to start it */
+    void prepareNextQuestion();
+
+    void showInstructions();
+
+    Status getStatus() const;
+    const juce::String& getStatusText() const;
+    bool isQuestionActive() const;
+    int getScore() const;
+    int getNumAnswered() const;
+
+    // Of the question being asked, or the last one answered
+    AudioEngine::ModeType getCurrentMode() const;
+    AudioEngine::PlaybackPattern getCurrentPattern() const;
+    float getCurrentRootFrequency() const;
+
+    // A3 = 220 Hz is note index 0, and each index is a semitone
+    static double noteIndexToFrequency(int noteIndex);
+
+    std::function<void()> onStatusChanged;
+
+    // Something to record in the session: "play", "guess" or "stop"
+    std::function<void(const juce::String& action, juce::NamedValueSet properties)> onEvent;
+
+private:
+    AudioEngine& engine;
+    QuizScheduler& scheduler;
+    juce::Random random;
+    Settings settings;
+
+    Status status = Status::instructions;
+    juce::String statusText;
+    int score = 0;
+    int numAnswered = 0;
+    AudioEngine::ModeType currentMode = AudioEngine::ModeType::Ionian;
+    AudioEngine::ModeType lastPlayedMode = AudioEngine::ModeType::Ionian;
+    AudioEngine::PlaybackPattern currentPattern = AudioEngine::PlaybackPattern::Ascending;
+    float currentRootFrequency = 440.0f;
+    bool questionActive = false;
+
+    // The next question is chosen and worked out while the last answer is
+    // shown, so playing it only has to hand it to the engine. It's thrown away
+    // if the settings it was chosen from change first.
+    struct Question
+    {
+        AudioEngine::PreparedPlayback playback;
+        int rootNoteIndex = 0;
+    };
+    std::optional<Question> nextQuestion;
+
+    Question chooseQuestion();
+    void answer(AudioEngine::ModeType guessedMode);
+    void practice(AudioEngine::ModeType mode);
+    void setStatus(Status newStatus, const juce::String& text);
+    void record(const juce::String& action, juce::NamedValueSet properties = {});
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(QuizSession)
+    JUCE_DECLARE_NON_COPYABLE(QuizSession)
+};
@@ -0,0 +1,277 @@
+#include "QuizSimulator.h"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // One engine and buffer per worker thread, reused for every session it plays
+    class Student
+    {
+    public:
+        explicit Student(const QuizSimulator::Settings& settingsToUse)
+        : settings(settingsToUse)
+        , buffer(2, settingsToUse.blockSize)
+        {
+            engine.prepareToPlay(settings.blockSize, settings.sampleRate);
+            engine.setPlaybackSpeed(settings.playbackSpeed);
+        }
+
+        /** Play one session; the first invariant broken, or an empty string */
+        juce::String playSession(juce::int64 seed, QuizSimulator::Result& result)
+        {
+            VirtualQuizScheduler scheduler;
+            engine.setRandomSeed(seed);
+            QuizSession quiz(engine, scheduler, seed);
+            juce::Random random(seed ^ 0x5eed);
+            renderedNonFinite = false;
+            numSamplesRendered = 0;
+            auto failure = playSession(quiz, scheduler, random, result);
+
+            engine.onPlaybackFinished = nullptr;  // It points at this session's quiz
+            if (failure.isEmpty() && scheduler.getNumPending() != 0)
+                failure = juce::String(scheduler.getNumPending()) + " callbacks still scheduled after the session";
+
+            result.numSamplesRendered += numSamplesRendered;
+            result.virtualSeconds += scheduler.getMillisecondCounter() / 1000.0;
+            result.numSessions++;
+            return failure;
+        }
+
+    private:
+        const QuizSimulator::Settings& settings;
+        AudioEngine engine;
+        juce::AudioBuffer<float> buffer;
+        bool renderedNonFinite = false;
+        juce::int64 numSamplesRendered = 0;
+
+        juce::String playSession(QuizSession& quiz, VirtualQuizScheduler& scheduler, juce::Random& random, QuizSimulator::Result& result)
+        {
+            auto modes = engine.getAllModes();
+            auto patterns = engine.getAllPatterns();
+            auto anyOf = [&random](const auto& values) { return values[static_cast<size_t>(random.nextInt(static_cast<int>(values.size())))]; };
+
+            auto chooseSettings = [&]
+            {
+                QuizSession::Settings chosen;
+                chosen.rootNoteIndex = QuizSession::kMinRootNoteIndex + random.nextInt(QuizSession::kMaxRootNoteIndex - QuizSession::kMinRootNoteIndex + 1);
+                chosen.randomizeRoot = random.nextBool();
+                chosen.pattern = anyOf(patterns);
+                return chosen;
+            };
+
+            auto quizSettings = chooseSettings();
+            quiz.setSettings(quizSettings);
+            quiz.prepareNextQuestion();  // As the app does once the device is open
+
+            int expectedScore = 0;
+            bool havePreviousMode = false;
+            auto previousMode = AudioEngine::ModeType::Ionian;
+
+            for (int question = 0; question < settings.questionsPerSession; ++question)
+            {
+                auto where = "question " + juce::String(question + 1) + ": ";
+
+                if (random.nextInt(10) == 0)
+                {
+                    if (!quiz.chooseMode(anyOf(modes)) || quiz.getStatus() != QuizSession::Status::playingForPractice)
+                        return where + "practice did not play";
+                    if (!renderUntilSilent(scheduler))
+                        return where + "practice playback never finished";
+                    if (quiz.getStatus() != QuizSession::Status::instructions)
+                        return where + "no instructions after practice";
+                }
+
+                if (random.nextInt(10) == 0)
+                {
+                    quizSettings = chooseSettings();
+                    quiz.setSettings(quizSettings);
+                }
+
+                if (!quiz.playQuestion())
+                    return where + "the question was not played";
+                if (quiz.getStatus() != QuizSession::Status::playingForGuess || !quiz.isQuestionActive())
+                    return where + "not playing for a guess";
+
+                auto mode = quiz.getCurrentMode();
+                if (havePreviousMode && mode == previousMode)
+                    return where + "the same mode twice in a row";
+                if (quiz.getCurrentPattern() != quizSettings.pattern)
+                    return where + "played in a pattern other than the one chosen";
+
+                int rootNoteIndex = quiz.getSettings().rootNoteIndex;
+                if (rootNoteIndex < QuizSession::kMinRootNoteIndex || rootNoteIndex > QuizSession::kMaxRootNoteIndex)
+                    return where + "root outside the slider's range";
+                if (!quizSettings.randomizeRoot && rootNoteIndex != quizSettings.rootNoteIndex)
+                    return where + "root other than the one chosen";
+                if (std::abs(quiz.getCurrentRootFrequency() - QuizSession::noteIndexToFrequency(rootNoteIndex)) > 0.01)
+                    return where + "root frequency doesn't match the root shown";
+
+                // Now and then the student stops it part way, but can still answer
+                bool stoppedEarly = random.nextInt(20) == 0;
+                if (stoppedEarly)
+                {
+                    for (int blocks = 1 + random.nextInt(10); blocks > 0; --blocks)
+                        renderBlock(scheduler);
+                    quiz.stop();
+                    if (quiz.getStatus() != QuizSession::Status::instructions || !quiz.isQuestionActive())
+                        return where + "stopping ended the question";
+                }
+
+                if (!renderUntilSilent(scheduler))
+                    return where + "the question's playback never finished";
+                if (renderedNonFinite)
+                    return where + "non-finite sample rendered";
+                if (quiz.getStatus() != (stoppedEarly ? QuizSession::Status::instructions : QuizSession::Status::waitingForGuess))
+                    return where + "not waiting for a guess after the playback";
+
+                // Thinking takes no rendering, as nothing is playing
+                scheduler.advanceBy(500.0 + random.nextInt(3500));
+
+                bool correct = random.nextDouble() < settings.accuracy;
+                auto guess = mode;
+                while (!correct && guess == mode)
+                    guess = anyOf(modes);
+
+                auto answeredAt = scheduler.getMillisecondCounter();
+                if (!quiz.chooseMode(guess))
+                    return where + "the answer was ignored";
+                expectedScore += correct ? 1 : 0;
+                if (quiz.getStatus() != (correct ? QuizSession::Status::correctGuess : QuizSession::Status::incorrectGuess))
+                    return where + "wrong feedback for the answer";
+                if (quiz.getScore() != expectedScore || quiz.getNumAnswered() != question + 1)
+                    return where + "score not counted";
+                if (quiz.isQuestionActive())
+                    return where + "still asking after the answer";
+
+                scheduler.advanceTo(answeredAt + QuizSession::kFeedbackMilliseconds - 1);
+                if (quiz.getStatus() != (correct ? QuizSession::Status::correctGuess : QuizSession::Status::incorrectGuess))
+                    return where + "feedback cleared too early";
+                scheduler.advanceTo(answeredAt + QuizSession::kFeedbackMilliseconds);
+                if (quiz.getStatus() != QuizSession::Status::instructions)
+                    return where + "no instructions after the feedback";
+
+                result.numQuestions++;
+                result.numCorrect += correct ? 1 : 0;
+                previousMode = mode;
+                havePreviousMode = true;
+            }
+
+            return {};
+        }
+
+        // Render while anything is playing, moving the clock with the audio
+        bool renderUntilSilent(VirtualQuizScheduler& scheduler)
+        {
+            auto deadline = scheduler.getMillisecondCounter() + QuizSimulator::kMaximumPlaybackSeconds * 1000.0;
+            while (engine.isCurrentlyPlaying())
+            {
+                if (scheduler.getMillisecondCounter() > deadline)
+                    return false;
+                renderBlock(scheduler);
+            }
+            return true;
+        }
+
+        void renderBlock(VirtualQuizScheduler& scheduler)
+        {
+            engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&buffer, 0, settings.blockSize));
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            {
+                auto* samples = buffer.getReadPointer(channel);
+                for (int i = 0; i < settings.blockSize; ++i)
+                    renderedNonFinite = renderedNonFinite || !std::isfinite(samples[i]);
+            }
+
+            // A playback finishing in this block is delivered at its end, as the timer would
+            scheduler.advanceBy(settings.blockSize * 1000.0 / settings.sampleRate);
+            engine.dispatchPendingNotifications();
+            numSamplesRendered += settings.blockSize;
+        }
+    };
+}
+
+double QuizSimulator::Result::getSpeedup() const
+{
+    return seconds > 0.0 ? virtualSeconds / seconds : 0.0;
+}
+
+QuizSimulator::Result QuizSimulator::run(const Settings& settings)
+{
+    Result result;
+    std::mutex resultLock;
+    std::atomic<int> nextSession { 0 };
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < juce::jmax(1, settings.numThreads); ++t)
+    {
+        workers.emplace_back([&]
+        {
+            Student student(settings);
+            Result workerResult;
+            juce::StringArray workerViolations;
+
+            for (int session = nextSession++; session < settings.numSessions; session = nextSession++)
+            {
+                auto failure = student.playSession(settings.seed + session, workerResult);
+                if (failure.isNotEmpty())
+                    workerViolations.add("session " + juce::String(session + 1) + " (seed " + juce::String(settings.seed + session) + "), " + failure);
+            }
+
+            std::lock_guard<std::mutex> lock(resultLock);
+            result.numSessions += workerResult.numSessions;
+            result.numQuestions += workerResult.numQuestions;
+            result.numCorrect += workerResult.numCorrect;
+            result.numSamplesRendered += workerResult.numSamplesRendered;
+            result.virtualSeconds += workerResult.virtualSeconds;
+            result.violations.addArray(workerViolations);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    result.seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    return result;
+}
+
+void QuizSimulator::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--sessions"))
+        settings.numSessions = juce::jmax(1, args.getValueForOption("--sessions").getIntValue());
+    if (args.containsOption("--questions"))
+        settings.questionsPerSession = juce::jmax(1, args.getValueForOption("--questions").getIntValue());
+    if (args.containsOption("--threads"))
+        settings.numThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+    if (args.containsOption("--accuracy"))
+        settings.accuracy = juce::jlimit(0.0, 1.0, args.getValueForOption("--accuracy").getDoubleValue());
+    if (args.containsOption("--rate"))
+        settings.sampleRate = juce::jmax(1000.0, args.getValueForOption("--rate").getDoubleValue());
+    if (args.containsOption("--speed"))
+        settings.playbackSpeed = juce::jlimit(0.5f, 3.0f, args.getValueForOption("--speed").getFloatValue());
+    if (args.containsOption("--seed"))
+        settings.seed = args.getValueForOption("--seed").getLargeIntValue();
+
+    std::cout << "Simulating " << settings.numSessions << " sessions of " << settings.questionsPerSession
+              << " questions on " << settings.numThreads << " threads (seed " << settings.seed << ")" << std::endl;
+
+    auto result = run(settings);
+
+    std::cout << result.numQuestions << " questions answered, " << result.numCorrect << " correctly; "
+              << juce::String(result.virtualSeconds / 3600.0, 1) << " hours of virtual time and "
+              << result.numSamplesRendered << " samples rendered in " << juce::String(result.seconds, 2) << " s ("
+              << juce::roundToInt(result.getSpeedup()) << "x real time)" << std::endl;
+
+    for (int i = 0; i < juce::jmin(result.violations.size(), 20); ++i)
+        std::cout << "FAIL  " << result.violations[i] << std::endl;
+    if (result.violations.size() > 20)
+        std::cout << "      ... and " << result.violations.size() - 20 << " more" << std::endl;
+
+    if (!result.violations.isEmpty())
+        juce::ConsoleApplication::fail(juce::String(result.violations.size()) + " sessions broke an invariant", 1);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "QuizSession.h"
+
+// Plays whole quiz sessions against the real QuizSession and AudioEngine with
+// a simulated student, on a virtual clock. Audio is rendered offline only
+// while something is playing, and the clock jumps straight over the student's
+// thinking time and the feedback delay, so thousands of sessions take seconds.
+//
+// Each question is played, heard to the end (or now and then stopped early),
+// answered correctly with the given probability and followed through the
+// feedback back to the instructions; now and then the student practises a
+// mode first, or changes the root or pattern between questions. After every
+// step the session's status, score and question are checked against what the
+// student did, and every rendered block for non-finite samples.
+class QuizSimulator
+{
+public:
+    static constexpr double kMaximumPlaybackSeconds = 60.0;  // A playback still going after this has hung
+
+    struct Settings
+    {
+        int numSessions = 1000;
+        int questionsPerSession = 10;
+        int numThreads = juce::SystemStats::getNumCpus();
+        double accuracy = 0.7;       // Probability of answering correctly
+        double sampleRate = 8000.0;  // Low, as only the flow is being tested
+        int blockSize = 256;
+        float playbackSpeed = 3.0f;
+        juce::int64 seed = juce::Time::currentTimeMillis();
+    };
+
+    struct Result
+    {
+        int numSessions = 0;
+        juce::int64 numQuestions = 0;
+        juce::int64 numCorrect = 0;
+        juce::int64 numSamplesRendered = 0;
+        double virtualSeconds = 0.0;  // Summed over every session
+        double seconds = 0.0;         // Wall-clock time for the whole run
+        juce::StringArray violations;
+
+        double getSpeedup() const;
+    };
+
+    static Result run(const Settings& settings);
+
+    /** Entry point for the --simulate-sessions command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
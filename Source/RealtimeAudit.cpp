@@ -0,0 +1,375 @@
+#include "RealtimeAudit.h"
+#include "AudioEngine.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if MODETRAINER_RT_AUDIT
+ #include <new>
+ #if JUCE_LINUX || JUCE_MAC
+  #include <dlfcn.h>
+  #include <execinfo.h>
+  #include <pthread.h>
+  #include <unistd.h>
+ #endif
+ #if JUCE_WINDOWS
+  #include <malloc.h>
+ #endif
+ #if JUCE_LINUX && defined(__GLIBC__)
+  #define MODETRAINER_RT_AUDIT_HOOKS_MALLOC 1
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void __libc_free(void* pointer);
+}
+ #else
+  #define MODETRAINER_RT_AUDIT_HOOKS_MALLOC 0
+ #endif
+#endif
+
+namespace
+{
+    std::atomic<int> numViolations { 0 };
+    std::atomic<bool> abortOnViolation { std::getenv("MODETRAINER_RT_AUDIT_ABORT") != nullptr
+                                         && std::strcmp(std::getenv("MODETRAINER_RT_AUDIT_ABORT"), "0") != 0 };
+
+#if MODETRAINER_RT_AUDIT
+    thread_local int realtimeDepth = 0;
+    thread_local bool isReporting = false;
+    constexpr int kMaxReports = 20;  // Full reports printed before only counting
+
+    void writeToStderr(const char* text)
+    {
+       #if JUCE_WINDOWS
+        std::fputs(text, stderr);
+       #else
+        auto written = ::write(STDERR_FILENO, text, std::strlen(text));
+        juce::ignoreUnused(written);
+       #endif
+    }
+
+    // Reporting must not allocate either: no juce::String or iostreams here
+    void checkRealtime(const char* what)
+    {
+        if (realtimeDepth == 0 || isReporting)
+            return;
+
+        isReporting = true;
+        int count = ++numViolations;
+        bool shouldAbort = abortOnViolation;
+
+        if (count <= kMaxReports || shouldAbort)
+        {
+            writeToStderr("Real-time audit: ");
+            writeToStderr(what);
+            writeToStderr(" called from the audio callback\n");
+           #if JUCE_LINUX || JUCE_MAC
+            void* frames[32];
+            int numFrames = backtrace(frames, 32);
+            backtrace_symbols_fd(frames, numFrames, STDERR_FILENO);
+           #endif
+        }
+
+        if (shouldAbort)
+            std::abort();
+
+        isReporting = false;
+    }
+
+   #if JUCE_LINUX || JUCE_MAC
+    // backtrace() loads its unwinder on first use, which allocates, so do that up front
+    const bool backtraceWarmedUp = []
+    {
+        void* frames[1];
+        return backtrace(frames, 1) >= 0;
+    }();
+   #endif
+
+    void* rawAllocate(std::size_t size)
+    {
+       #if MODETRAINER_RT_AUDIT_HOOKS_MALLOC
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+
+    void rawFree(void* pointer)
+    {
+       #if MODETRAINER_RT_AUDIT_HOOKS_MALLOC
+        __libc_free(pointer);
+       #else
+        std::free(pointer);
+       #endif
+    }
+
+    void* rawAllocateAligned(std::size_t size, std::size_t alignment)
+    {
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size == 0 ? 1 : size, alignment);
+       #else
+        void* pointer = nullptr;
+        return posix_memalign(&pointer, juce::jmax(alignment, sizeof(void*)), size == 0 ? 1 : size) == 0 ? pointer : nullptr;
+       #endif
+    }
+
+    void rawFreeAligned(void* pointer)
+    {
+       #if JUCE_WINDOWS
+        _aligned_free(pointer);
+       #else
+        rawFree(pointer);
+       #endif
+    }
+
+    void* allocateOrThrow(std::size_t size, const char* what)
+    {
+        checkRealtime(what);
+        if (auto* pointer = rawAllocate(size))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    void* allocateAlignedOrThrow(std::size_t size, std::align_val_t alignment, const char* what)
+    {
+        checkRealtime(what);
+        if (auto* pointer = rawAllocateAligned(size, static_cast<std::size_t>(alignment)))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    void deallocate(void* pointer, const char* what)
+    {
+        if (pointer == nullptr)
+            return;
+        checkRealtime(what);
+        rawFree(pointer);
+    }
+
+    void deallocateAligned(void* pointer, const char* what)
+    {
+        if (pointer == nullptr)
+            return;
+        checkRealtime(what);
+        rawFreeAligned(pointer);
+    }
+#endif
+}
+
+#if MODETRAINER_RT_AUDIT
+
+// MARK: - (Hooks)
+
+void* operator new(std::size_t size) { return allocateOrThrow(size, "operator new"); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size, "operator new[]"); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { checkRealtime("operator new"); return rawAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { checkRealtime("operator new[]"); return rawAllocate(size); }
+void operator delete(void* pointer) noexcept { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer, "operator delete[]"); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer, "operator delete[]"); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer, "operator delete[]"); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment, "operator new"); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAlignedOrThrow(size, alignment, "operator new[]"); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    checkRealtime("operator new");
+    return rawAllocateAligned(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    checkRealtime("operator new[]");
+    return rawAllocateAligned(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocateAligned(pointer, "operator delete"); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocateAligned(pointer, "operator delete[]"); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { deallocateAligned(pointer, "operator delete"); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { deallocateAligned(pointer, "operator delete[]"); }
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(pointer, "operator delete"); }
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocateAligned(pointer, "operator delete[]"); }
+
+#if MODETRAINER_RT_AUDIT_HOOKS_MALLOC
+extern "C" void* malloc(size_t size) noexcept
+{
+    checkRealtime("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept
+{
+    checkRealtime("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) noexcept
+{
+    checkRealtime("realloc");
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) noexcept
+{
+    if (pointer != nullptr)
+        checkRealtime("free");
+    __libc_free(pointer);
+}
+#endif
+
+#if JUCE_LINUX || JUCE_MAC
+ #if JUCE_LINUX
+  #define MODETRAINER_RT_AUDIT_NOEXCEPT noexcept  // glibc declares it __THROWNL
+ #else
+  #define MODETRAINER_RT_AUDIT_NOEXCEPT
+ #endif
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) MODETRAINER_RT_AUDIT_NOEXCEPT
+{
+    // Resolved lazily without a function-local static, whose guard could itself lock
+    using LockFunction = int (*)(pthread_mutex_t*);
+    static std::atomic<LockFunction> realLock { nullptr };
+
+    auto lock = realLock.load(std::memory_order_acquire);
+    if (lock == nullptr)
+    {
+        lock = reinterpret_cast<LockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        realLock.store(lock, std::memory_order_release);
+    }
+
+    checkRealtime("pthread_mutex_lock");
+    return lock(mutex);
+}
+#endif
+
+RealtimeAudit::ScopedRealtimeSection::ScopedRealtimeSection()
+{
+    ++realtimeDepth;
+}
+
+RealtimeAudit::ScopedRealtimeSection::~ScopedRealtimeSection()
+{
+    --realtimeDepth;
+}
+
+#endif
+
+void RealtimeAudit::setAbortOnViolation(bool shouldAbort)
+{
+    abortOnViolation = shouldAbort;
+}
+
+int RealtimeAudit::getNumViolations()
+{
+    return numViolations;
+}
+
+void RealtimeAudit::resetNumViolations()
+{
+    numViolations = 0;
+}
+
+// MARK: - (Command line)
+
+void RealtimeAudit::runFromCommandLine(const juce::ArgumentList& args)
+{
+    if (!isCompiledIn())
+        juce::ConsoleApplication::fail("This build does not include the real-time audit; build with MODETRAINER_RT_AUDIT=1", 1);
+
+    if (args.containsOption("--abort"))
+        setAbortOnViolation(true);
+
+    // Everything is set up outside the audited sections; only the engine's
+    // own callback marks itself as real-time, exactly as with a real device.
+    AudioEngine engine;
+    int numFinished = 0;
+    engine.onPlaybackFinished = [&numFinished] { numFinished++; };
+    engine.setMidiMirroringEnabled(true);
+
+    auto modes = engine.getAllModes();
+    auto patterns = engine.getAllPatterns();
+    int numPlays = 0;
+    int numPlayedToEnd = 0;  // Each should be reported once; stopped and replaced ones not at all
+    resetNumViolations();
+
+    for (double sampleRate : { 44100.0, 48000.0, 96000.0 })
+    {
+        for (int blockSize : { 32, 441, 512, 2048 })
+        {
+            // Mono, stereo and multichannel devices
+            int numChannels = (blockSize == 32) ? 1 : (blockSize == 2048 ? 8 : 2);
+            juce::AudioBuffer<float> buffer(numChannels, blockSize);
+            engine.prepareToPlay(blockSize, sampleRate);
+
+            auto renderBlocks = [&](int numBlocks)
+            {
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    juce::AudioSourceChannelInfo info(&buffer, 0, blockSize);
+                    engine.getNextAudioBlock(info);
+                    engine.dispatchPendingNotifications();
+                }
+            };
+            auto renderUntilFinished = [&]
+            {
+                while (engine.isCurrentlyPlaying())
+                    renderBlocks(1);
+                numPlayedToEnd++;
+            };
+
+            // Idle blocks
+            renderBlocks(4);
+
+            for (auto mode : modes)
+            {
+                for (auto pattern : patterns)
+                {
+                    // Complete playback at full speed
+                    engine.setPlaybackSpeed(3.0f);
+                    engine.playMode(mode, 440.0f, pattern);
+                    numPlays++;
+                    renderUntilFinished();
+
+                    // Speed and pattern changes during playback, then a stop
+                    engine.playMode(mode, 261.63f, pattern);
+                    numPlays++;
+                    renderBlocks(3);
+                    engine.setPlaybackSpeed(2.5f);
+                    engine.setPlaybackPattern(pattern);
+                    renderBlocks(3);
+                    engine.stopPlaying();
+                    renderBlocks(2);
+
+                    // Restart while already playing, without MIDI mirroring and with panning,
+                    // reverb and loudness compensation
+                    engine.setMidiMirroringEnabled(false);
+                    engine.setDegreePanningEnabled(true);
+                    engine.setLoudnessCompensationEnabled(true);
+                    engine.getReverb().setEnabled(true);
+                    engine.setTimbre(AudioEngine::Timbre::Warm);
+                    engine.playMode(mode, 220.0f, pattern);
+                    renderBlocks(2);
+                    engine.playMode(mode, 880.0f, pattern);
+                    numPlays += 2;
+                    renderUntilFinished();
+                    engine.setMidiMirroringEnabled(true);
+                    renderBlocks(4);  // Reverb tail after playback
+                    engine.setDegreePanningEnabled(false);
+                    engine.setLoudnessCompensationEnabled(false);
+                    engine.getReverb().setEnabled(false);
+                    engine.setTimbre(AudioEngine::Timbre::Pure);
+                }
+            }
+        }
+    }
+
+    std::cout << numPlays << " plays rendered, " << numFinished << " finished notifications for "
+              << numPlayedToEnd << " played to the end, " << getNumViolations() << " real-time violations" << std::endl;
+
+    if (getNumViolations() > 0)
+        juce::ConsoleApplication::fail("Real-time violations found in the audio callback", 1);
+    if (numFinished != numPlayedToEnd)
+        juce::ConsoleApplication::fail("Finished notifications don't match the playbacks that reached their end", 1);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Build with MODETRAINER_RT_AUDIT=1 (the Debug configurations do) to trap heap
+// and locking calls made from the audio callback. Global operator new/delete
+// are replaced on all platforms; on Linux malloc, calloc, realloc and free are
+// also hooked, and on Linux and macOS so is pthread_mutex_lock (which is what
+// juce::CriticalSection, and std::mutex on Linux, lock with).
+//
+// Any such call made while a ScopedRealtimeSection is active on the calling
+// thread is reported to stderr with a stack trace, or aborts the process if
+// setAbortOnViolation(true) was called or MODETRAINER_RT_AUDIT_ABORT=1 is set.
+#ifndef MODETRAINER_RT_AUDIT
+ #define MODETRAINER_RT_AUDIT 0
+#endif
+
+class RealtimeAudit
+{
+public:
+    // Marks the calling thread as real-time for the lifetime of the object
+    class ScopedRealtimeSection
+    {
+    public:
+#if MODETRAINER_RT_AUDIT
+        ScopedRealtimeSection();
+        ~ScopedRealtimeSection();
+#else
+        ScopedRealtimeSection() {}
+#endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeSection)
+    };
+
+    static bool isCompiledIn() { return MODETRAINER_RT_AUDIT != 0; }
+
+    static void setAbortOnViolation(bool shouldAbort);
+    static int getNumViolations();
+    static void resetNumViolations();
+
+    /** Entry point for the --rt-audit command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
@@ -0,0 +1,151 @@
+#include "RenderCache.h"
+#include "OfflineRenderer.h"
+#include <cmath>
+#include <tuple>
+
+bool RenderCache::Key::operator<(const Key& other) const
+{
+    return std::tie(mode, pattern, rootNoteIndex, speedPercent)
+         < std::tie(other.mode, other.pattern, other.rootNoteIndex, other.speedPercent);
+}
+
+RenderCache::RenderCache(Settings settings)
+    : settings(settings)
+    , pool(juce::jmax(1, settings.numThreads))
+{
+}
+
+RenderCache::~RenderCache()
+{
+    // Jobs capture this, so they must finish before the members go
+    pool.removeAllJobs(false, -1);
+}
+
+float RenderCache::rootNoteIndexToFrequency(int rootNoteIndex)
+{
+    // Same mapping as the root slider: index 0 is A3 = 220 Hz
+    return 220.0f * std::pow(2.0f, static_cast<float>(rootNoteIndex) / 12.0f);
+}
+
+RenderCache::Render RenderCache::get(const Key& key, bool& wasCached)
+{
+    if (!settings.pitchShiftRoots)
+        return getRender(key, wasCached);
+
+    // Only the reference is kept; shifting costs the same few milliseconds every time
+    auto referenceKey = key;
+    referenceKey.rootNoteIndex = kMaxRootNoteIndex;
+    auto tones = getRender(referenceKey, wasCached);
+
+    auto ratio = rootNoteIndexToFrequency(key.rootNoteIndex) / rootNoteIndexToFrequency(kMaxRootNoteIndex);
+    auto noteDuration = AudioEngine::getNoteDurationForSpeed(static_cast<float>(key.speedPercent) / 100.0f);
+    return std::make_shared<juce::AudioBuffer<float>>(pitchShifter.shift(*tones, ratio, noteDuration, settings.sampleRate));
+}
+
+RenderCache::Render RenderCache::getRender(const Key& key, bool& wasCached)
+{
+    std::shared_future<Render> pending;
+    std::shared_ptr<std::promise<Render>> promise;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, found->second.recency);
+            stats.hits++;
+            wasCached = true;
+            return found->second.render;
+        }
+
+        auto inProgress = rendering.find(key);
+        if (inProgress != rendering.end())
+        {
+            stats.shared++;
+            pending = inProgress->second;
+        }
+        else
+        {
+            stats.renders++;
+            promise = std::make_shared<std::promise<Render>>();
+            pending = promise->get_future().share();
+            rendering[key] = pending;
+        }
+    }
+
+    wasCached = (promise == nullptr);
+
+    if (promise != nullptr)
+    {
+        pool.addJob([this, key, promise]
+        {
+            auto result = render(key);
+            store(key, result);
+            promise->set_value(result);
+        });
+    }
+
+    return pending.get();
+}
+
+RenderCache::Stats RenderCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+RenderCache::Render RenderCache::render(const Key& key)
+{
+    // Engines are expensive to build (pattern programs, reverb), so workers reuse them
+    std::unique_ptr<AudioEngine> engine;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idleEngines.empty())
+        {
+            engine = std::move(idleEngines.back());
+            idleEngines.pop_back();
+        }
+    }
+
+    if (engine == nullptr)
+    {
+        engine = std::make_unique<AudioEngine>();
+        engine->loadUserPatterns(AudioEngine::getUserPatternFile());
+    }
+
+    engine->setPlaybackSpeed(static_cast<float>(key.speedPercent) / 100.0f);
+    engine->setEnvelopeEnabled(!settings.pitchShiftRoots);
+
+    OfflineRenderer renderer(settings.sampleRate, 512, 1);
+    auto audio = std::make_shared<juce::AudioBuffer<float>>(
+        renderer.render(*engine, key.mode, rootNoteIndexToFrequency(key.rootNoteIndex), key.pattern));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idleEngines.push_back(std::move(engine));
+    }
+
+    return audio;
+}
+
+void RenderCache::store(const Key& key, const Render& render)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    rendering.erase(key);
+    recentlyUsed.push_front(key);
+    entries[key] = { render, recentlyUsed.begin() };
+    stats.bytes += sizeof(float) * static_cast<size_t>(render->getNumSamples() * render->getNumChannels());
+
+    // Evict least recently used; clients still streaming an evicted render keep it alive
+    while (stats.bytes > settings.maximumBytes && recentlyUsed.size() > 1)
+    {
+        auto oldest = entries.find(recentlyUsed.back());
+        stats.bytes -= sizeof(float) * static_cast<size_t>(oldest->second.render->getNumSamples()
+                                                           * oldest->second.render->getNumChannels());
+        entries.erase(oldest);
+        recentlyUsed.pop_back();
+    }
+
+    stats.entries = static_cast<int>(entries.size());
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AudioEngine.h"
+#include "PitchShifter.h"
+
+// Rendered exercises shared between any number of requesting threads. Each
+// distinct (mode, pattern, root, speed) is rendered once on a worker pool;
+// requests that arrive while it is rendering wait for that same render rather
+// than starting another. Renders are kept most-recently-used first until the
+// cache exceeds its byte budget.
+//
+// The Random pattern is cached like any other, so every request for the same
+// key hears the same shuffle until the entry is evicted.
+//
+// With pitchShiftRoots, only the highest root of each (mode, pattern, speed)
+// is rendered and kept, as sustained tones, and every request is pitch-shifted
+// from it (see PitchShifter), so the cache holds one render where it held one
+// per root. Random patterns then shuffle the same way at every root.
+class RenderCache
+{
+public:
+    static constexpr int kMaxRootNoteIndex = 36;  // A6
+
+    struct Key
+    {
+        AudioEngine::ModeType mode = AudioEngine::ModeType::Ionian;
+        AudioEngine::PlaybackPattern pattern = AudioEngine::PlaybackPattern::Ascending;
+        int rootNoteIndex = 0;  // Semitones above A3, as used by the root slider
+        int speedPercent = 100; // Playback speed * 100
+
+        bool operator<(const Key& other) const;
+    };
+
+    using Render = std::shared_ptr<const juce::AudioBuffer<float>>;
+
+    struct Settings
+    {
+        double sampleRate = 44100.0;
+        int numThreads = juce::SystemStats::getNumCpus();
+        size_t maximumBytes = 256 * 1024 * 1024;
+        bool pitchShiftRoots = false;  // Render each mode, pattern and speed once and shift it to the root asked for
+    };
+
+    struct Stats
+    {
+        int hits = 0;           // Served from a finished render
+        int shared = 0;         // Waited on a render another request started
+        int renders = 0;        // Rendered for this request
+        int entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit RenderCache(Settings settings);
+    ~RenderCache();
+
+    /**
+     * Get the audio for an exercise, rendering it if needed. Blocks until it is ready.
+     * @param key Exercise to render
+     * @param wasCached Set to false only if this request started the render (of the reference, when pitch-shifting)
+     * @return Mono audio at getSampleRate(), trimmed to the end of playback
+     */
+    Render get(const Key& key, bool& wasCached);
+
+    Stats getStats() const;
+    double getSampleRate() const { return settings.sampleRate; }
+
+    static float rootNoteIndexToFrequency(int rootNoteIndex);
+
+private:
+    struct Entry
+    {
+        Render render;
+        std::list<Key>::iterator recency;
+    };
+
+    Settings settings;
+    juce::ThreadPool pool;
+    PitchShifter pitchShifter;  // Stateless once built, so shared by every requesting thread
+
+    mutable std::mutex mutex;  // Guards everything below
+    std::map<Key, Entry> entries;
+    std::list<Key> recentlyUsed;  // Most recent first
+    std::map<Key, std::shared_future<Render>> rendering;
+    std::vector<std::unique_ptr<AudioEngine>> idleEngines;  // One per worker at most
+    Stats stats;
+
+    Render getRender(const Key& key, bool& wasCached);
+    Render render(const Key& key);
+    void store(const Key& key, const Render& render);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderCache)
+};
@@ -0,0 +1,338 @@
+#include "RenderVerifier.h"
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    // Reference interval table, kept separate from AudioEngine on purpose so
+    // that a mistake in the engine's tables shows up as a verification failure.
+    const int kModeSemitones[7][7] = {
+        {0, 2, 4, 5, 7, 9, 11},  // Ionian
+        {0, 2, 3, 5, 7, 9, 10},  // Dorian
+        {0, 1, 3, 5, 7, 8, 10},  // Phrygian
+        {0, 2, 4, 6, 7, 9, 11},  // Lydian
+        {0, 2, 4, 5, 7, 9, 10},  // Mixolydian
+        {0, 2, 3, 5, 7, 8, 10},  // Aeolian
+        {0, 1, 3, 5, 6, 8, 10}   // Locrian
+    };
+
+    // Scale degrees (1 = root, 8 = octave, 0 = 7th below the root) for each pattern
+    std::vector<int> getExpectedDegrees(AudioEngine::PlaybackPattern pattern)
+    {
+        switch (pattern)
+        {
+            case AudioEngine::PlaybackPattern::Ascending:
+                return {1, 2, 3, 4, 5, 6, 7, 8};
+            case AudioEngine::PlaybackPattern::Descending:
+                return {8, 7, 6, 5, 4, 3, 2, 1};
+            case AudioEngine::PlaybackPattern::Intervallic:
+                return {1, 3, 2, 4, 3, 5, 4, 6, 5, 7, 6, 8, 7, 9, 8};
+            case AudioEngine::PlaybackPattern::IntervallicDescending:
+                return {8, 6, 7, 5, 6, 4, 5, 3, 4, 2, 3, 1, 2, 0, 1};
+            case AudioEngine::PlaybackPattern::Random:
+                return {1, 2, 3, 4, 5, 6, 7, 8};
+        }
+        return {};
+    }
+
+    int degreeToSemitones(AudioEngine::ModeType mode, int degree)
+    {
+        int octave = (degree >= 1) ? (degree - 1) / 7 : -((7 - degree) / 7);
+        int index = degree - 1 - 7 * octave;
+        return kModeSemitones[static_cast<int>(mode)][index] + 12 * octave;
+    }
+
+    int getHopSize(double sampleRate)
+    {
+        return juce::jmax(1, juce::roundToInt(sampleRate * 0.001));  // 1 ms envelope resolution
+    }
+
+    double rootNoteIndexToFrequency(int rootNoteIndex)
+    {
+        // Same mapping as the root slider: index 0 is A3 = 220 Hz
+        return 220.0 * std::pow(2.0, rootNoteIndex / 12.0);
+    }
+}
+
+RenderVerifier::RenderVerifier()
+    : RenderVerifier(Settings())
+{
+}
+
+RenderVerifier::RenderVerifier(Settings settings)
+    : settings(settings)
+{
+    engine.setPlaybackSpeed(settings.playbackSpeed);
+}
+
+std::vector<int> RenderVerifier::getExpectedSemitones(AudioEngine::ModeType mode, AudioEngine::PlaybackPattern pattern)
+{
+    std::vector<int> semitones;
+    for (int degree : getExpectedDegrees(pattern))
+        semitones.push_back(degreeToSemitones(mode, degree));
+    return semitones;
+}
+
+RenderVerifier::Result RenderVerifier::verify(AudioEngine::ModeType mode, int rootNoteIndex,
+                                              AudioEngine::PlaybackPattern pattern, double sampleRate)
+{
+    Result result;
+    double rootFrequency = rootNoteIndexToFrequency(rootNoteIndex);
+
+    OfflineRenderer renderer(sampleRate, settings.blockSize);
+    auto audio = renderer.render(engine, mode, static_cast<float>(rootFrequency), pattern);
+    result.notes = analyse(audio, sampleRate);
+
+    auto expected = getExpectedSemitones(mode, pattern);
+    if (result.notes.size() != expected.size())
+    {
+        result.failure = "expected " + juce::String(static_cast<int>(expected.size())) + " notes, found "
+                       + juce::String(static_cast<int>(result.notes.size()));
+        return result;
+    }
+
+    // Every onset should be one note duration after the previous one
+    int samplesPerNote = static_cast<int>(engine.getNoteDuration() * sampleRate);
+    int timingTolerance = 2 * getHopSize(sampleRate);
+    for (size_t i = 1; i < result.notes.size(); ++i)
+    {
+        int spacing = result.notes[i].onsetSample - result.notes[i - 1].onsetSample;
+        if (std::abs(spacing - samplesPerNote) > timingTolerance)
+        {
+            result.failure = "note " + juce::String(static_cast<int>(i + 1)) + " starts after "
+                           + juce::String(spacing) + " samples, expected " + juce::String(samplesPerNote);
+            return result;
+        }
+    }
+
+    // Convert each detected frequency to cents above the root
+    std::vector<double> detectedCents;
+    for (auto& note : result.notes)
+    {
+        if (note.frequency <= 0.0)
+        {
+            result.failure = "note at sample " + juce::String(note.onsetSample) + " is too short to analyse";
+            return result;
+        }
+        detectedCents.push_back(1200.0 * std::log2(note.frequency / rootFrequency));
+    }
+
+    // Random only fixes the root; the remaining notes must be a permutation of the scale
+    if (pattern == AudioEngine::PlaybackPattern::Random && detectedCents.size() > 1)
+        std::sort(detectedCents.begin() + 1, detectedCents.end());
+
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        double error = detectedCents[i] - 100.0 * expected[i];
+        result.worstCentsError = juce::jmax(result.worstCentsError, std::abs(error));
+        if (std::abs(error) > settings.centsTolerance)
+        {
+            result.failure = "note " + juce::String(static_cast<int>(i + 1)) + " is "
+                           + juce::String(detectedCents[i] / 100.0, 2) + " semitones above the root, expected "
+                           + juce::String(expected[i]);
+            return result;
+        }
+    }
+
+    result.passed = true;
+    return result;
+}
+
+std::vector<RenderVerifier::DetectedNote> RenderVerifier::analyse(const juce::AudioBuffer<float>& audio, double sampleRate)
+{
+    std::vector<DetectedNote> notes;
+    if (audio.getNumChannels() == 0)
+        return notes;
+
+    // Peak envelope at 1 ms resolution
+    int hop = getHopSize(sampleRate);
+    int numFrames = audio.getNumSamples() / hop;
+    std::vector<float> envelope(static_cast<size_t>(numFrames));
+    for (int frame = 0; frame < numFrames; ++frame)
+        envelope[static_cast<size_t>(frame)] = audio.getMagnitude(0, frame * hop, hop);
+
+    float peak = envelope.empty() ? 0.0f : *std::max_element(envelope.begin(), envelope.end());
+    if (peak <= 0.0f)
+        return notes;
+
+    // Each note's release falls to silence before the next attack, so an onset
+    // is the last quiet frame before the envelope rises past half of the peak.
+    float highThreshold = 0.5f * peak;
+    float lowThreshold = 0.1f * peak;
+    bool armed = true;
+    int lastQuietFrame = 0;
+    int lastSoundingFrame = 0;
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        float level = envelope[static_cast<size_t>(frame)];
+        if (level > 0.0f)
+            lastSoundingFrame = frame;
+
+        if (level <= lowThreshold)
+        {
+            lastQuietFrame = frame;
+            armed = true;
+        }
+        else if (armed && level >= highThreshold)
+        {
+            DetectedNote note;
+            note.onsetSample = lastQuietFrame * hop;
+            notes.push_back(note);
+            armed = false;
+        }
+    }
+
+    for (size_t i = 0; i < notes.size(); ++i)
+    {
+        int end = (i + 1 < notes.size()) ? notes[i + 1].onsetSample : (lastSoundingFrame + 1) * hop;
+        notes[i].lengthInSamples = end - notes[i].onsetSample;
+
+        // Analyse the sustain part of the note (the envelope is flat from 5% to 80%)
+        int sustainStart = notes[i].onsetSample + notes[i].lengthInSamples / 10;
+        int sustainLength = notes[i].lengthInSamples * 65 / 100;
+        if (sustainLength < 256)
+            continue;
+
+        int order = juce::jlimit(8, 13, static_cast<int>(std::floor(std::log2(sustainLength))));
+        int size = 1 << order;
+        int start = sustainStart + (sustainLength - size) / 2;
+        notes[i].frequency = estimateFrequency(audio.getReadPointer(0, start), size, sampleRate);
+    }
+
+    return notes;
+}
+
+double RenderVerifier::estimateFrequency(const float* samples, int numSamples, double sampleRate)
+{
+    int order = static_cast<int>(std::log2(numSamples));
+    auto& fft = getFFT(order);
+    auto& window = getWindow(order);
+
+    fftData.assign(static_cast<size_t>(2 * numSamples), 0.0f);
+    juce::FloatVectorOperations::multiply(fftData.data(), samples, window.data(), numSamples);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    int peakBin = 1;
+    for (int bin = 2; bin < numSamples / 2 - 1; ++bin)
+    {
+        if (fftData[static_cast<size_t>(bin)] > fftData[static_cast<size_t>(peakBin)])
+            peakBin = bin;
+    }
+
+    // Parabolic interpolation on log magnitudes around the peak bin
+    auto logMagnitude = [this](int bin) { return std::log(juce::jmax(fftData[static_cast<size_t>(bin)], 1.0e-12f)); };
+    double alpha = logMagnitude(peakBin - 1);
+    double beta = logMagnitude(peakBin);
+    double gamma = logMagnitude(peakBin + 1);
+    double denominator = alpha - 2.0 * beta + gamma;
+    double offset = (denominator != 0.0) ? 0.5 * (alpha - gamma) / denominator : 0.0;
+
+    return (peakBin + offset) * sampleRate / numSamples;
+}
+
+juce::dsp::FFT& RenderVerifier::getFFT(int order)
+{
+    auto& fft = ffts[order];
+    if (fft == nullptr)
+        fft = std::make_unique<juce::dsp::FFT>(order);
+    return *fft;
+}
+
+const std::vector<float>& RenderVerifier::getWindow(int order)
+{
+    auto& window = windows[order];
+    if (window.empty())
+    {
+        int size = 1 << order;
+        window.resize(static_cast<size_t>(size));
+        for (int n = 0; n < size; ++n)
+            window[static_cast<size_t>(n)] = 0.5f - 0.5f * std::cos(2.0f * juce::MathConstants<float>::pi * n / (size - 1));
+    }
+    return window;
+}
+
+// MARK: - (Command line)
+
+void RenderVerifier::runFromCommandLine(const juce::ArgumentList& args)
+{
+    Settings settings;
+    if (args.containsOption("--tolerance"))
+        settings.centsTolerance = args.getValueForOption("--tolerance").getDoubleValue();
+
+    std::vector<double> sampleRates = {44100.0, 48000.0, 96000.0};
+    if (args.containsOption("--rates"))
+    {
+        sampleRates.clear();
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--rates"), ",", ""))
+            sampleRates.push_back(token.getDoubleValue());
+    }
+
+    bool verbose = args.containsOption("--verbose");
+    const int numRoots = 37;  // A3 to A6
+
+    AudioEngine modeSource;
+    auto modes = modeSource.getAllModes();
+    auto patterns = modeSource.getAllPatterns();
+
+    std::atomic<int> numChecked { 0 };
+    std::atomic<int> numFailed { 0 };
+    juce::CriticalSection reportLock;
+    juce::StringArray failures;
+    double worstCentsError = 0.0;
+
+    auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    // One job per (sample rate, mode), each with its own engine
+    juce::ThreadPool pool;
+    for (double sampleRate : sampleRates)
+    {
+        for (auto mode : modes)
+        {
+            pool.addJob([&, sampleRate, mode]
+            {
+                RenderVerifier verifier(settings);
+                for (auto pattern : patterns)
+                {
+                    for (int root = 0; root < numRoots; ++root)
+                    {
+                        auto result = verifier.verify(mode, root, pattern, sampleRate);
+                        numChecked++;
+
+                        juce::String description = modeSource.getModeName(mode) + " / " + modeSource.getPatternName(pattern)
+                                                 + " / root " + juce::String(root) + " / " + juce::String(sampleRate) + " Hz";
+
+                        const juce::ScopedLock sl(reportLock);
+                        worstCentsError = juce::jmax(worstCentsError, result.worstCentsError);
+                        if (!result.passed)
+                        {
+                            numFailed++;
+                            failures.add(description + ": " + result.failure);
+                        }
+                        else if (verbose)
+                        {
+                            std::cout << "ok   " << description << " (worst " << result.worstCentsError << " cents)" << std::endl;
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(5);
+
+    auto elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    failures.sort(false);
+    for (auto& failure : failures)
+        std::cout << "FAIL " << failure << std::endl;
+
+    std::cout << numChecked.load() << " renders checked in " << elapsedSeconds << " s, "
+              << numFailed.load() << " failed, worst pitch error " << worstCentsError << " cents" << std::endl;
+
+    if (numFailed.load() > 0)
+        juce::ConsoleApplication::fail("Render verification failed", 1);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include "AudioEngine.h"
+
+// Offline check that a rendered exercise contains the right pitches in the
+// right order. The output is split into notes at envelope onsets, each note's
+// frequency is estimated with an FFT plus parabolic peak interpolation, and
+// the result is compared against an independent table of expected intervals.
+class RenderVerifier
+{
+public:
+    struct Settings
+    {
+        double centsTolerance = 10.0;  // Allowed pitch error per note
+        float playbackSpeed = 3.0f;    // Fastest speed keeps sweeps short
+        int blockSize = 512;
+    };
+
+    struct DetectedNote
+    {
+        int onsetSample = 0;
+        int lengthInSamples = 0;
+        double frequency = 0.0;
+    };
+
+    struct Result
+    {
+        bool passed = false;
+        juce::String failure;  // Empty when passed
+        std::vector<DetectedNote> notes;
+        double worstCentsError = 0.0;
+    };
+
+    RenderVerifier();
+    explicit RenderVerifier(Settings settings);
+
+    /**
+     * Render one exercise offline and verify it
+     * @param mode Mode to play
+     * @param rootNoteIndex Root as semitones above A3 (220 Hz), as used by the root slider
+     * @param pattern Playback pattern
+     * @param sampleRate Sample rate to render at
+     * @return Verification result
+     */
+    Result verify(AudioEngine::ModeType mode, int rootNoteIndex,
+                  AudioEngine::PlaybackPattern pattern, double sampleRate);
+
+    /**
+     * Segment rendered audio into notes and estimate each note's frequency
+     * @param audio Rendered audio (channel 0 is analysed)
+     * @param sampleRate Sample rate of the audio
+     * @return Detected notes in playback order
+     */
+    std::vector<DetectedNote> analyse(const juce::AudioBuffer<float>& audio, double sampleRate);
+
+    /**
+     * Expected notes of an exercise as semitones from the root. For the Random
+     * pattern only the first note is fixed; the rest are listed in ascending order.
+     */
+    static std::vector<int> getExpectedSemitones(AudioEngine::ModeType mode, AudioEngine::PlaybackPattern pattern);
+
+    /** Entry point for the --verify-renders command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    Settings settings;
+    AudioEngine engine;
+    std::map<int, std::unique_ptr<juce::dsp::FFT>> ffts;  // Keyed by FFT order
+    std::map<int, std::vector<float>> windows;           // Hann windows keyed by FFT order
+    std::vector<float> fftData;
+
+    double estimateFrequency(const float* samples, int numSamples, double sampleRate);
+    juce::dsp::FFT& getFFT(int order);
+    const std::vector<float>& getWindow(int order);
+};
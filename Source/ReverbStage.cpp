@@ -0,0 +1,178 @@
+#include "ReverbStage.h"
+#include <cmath>
+
+namespace
+{
+    constexpr double kDefaultImpulseSampleRate = 48000.0;
+    constexpr double kDefaultImpulseSeconds = 1.2;
+}
+
+ReverbStage::ReverbStage()
+    : convolution(juce::dsp::Convolution::Latency { 0 })
+    , preparedSampleRate(0.0)
+    , wasEnabled(false)
+    , impulseResponseRequested(false)
+{
+    formatManager.registerBasicFormats();
+    tailLimited = isLowPoweredMachine();
+}
+
+void ReverbStage::prepare(double sampleRate, int maximumBlockSize)
+{
+    wetBuffer.setSize(1, juce::jmax(1, maximumBlockSize));
+    wetBuffer.clear();
+    preparedSampleRate = sampleRate;
+
+    // Resamples the impulse response to the new rate
+    convolution.prepare({ sampleRate, static_cast<juce::uint32>(wetBuffer.getNumSamples()), 1 });
+}
+
+void ReverbStage::finishLoading()
+{
+    // Before prepare() there's nothing to do: preparing finishes the load too
+    if (preparedSampleRate > 0.0)
+        prepare(preparedSampleRate, wetBuffer.getNumSamples());
+}
+
+const float* ReverbStage::process(const float* input, int numSamples)
+{
+    bool isOn = enabled;
+    if (isOn && !wasEnabled)
+        convolution.reset();  // Don't resume a tail left over from the last time it was on
+    wasEnabled = isOn;
+
+    if (!isOn)
+        return nullptr;
+
+    jassert(numSamples <= wetBuffer.getNumSamples());
+    float* wet = wetBuffer.getWritePointer(0);
+
+    juce::dsp::AudioBlock<const float> inputBlock(&input, 1, static_cast<size_t>(numSamples));
+    juce::dsp::AudioBlock<float> outputBlock(&wet, 1, static_cast<size_t>(numSamples));
+    convolution.process(juce::dsp::ProcessContextNonReplacing<float>(inputBlock, outputBlock));
+
+    juce::FloatVectorOperations::multiply(wet, wetLevel.load(), numSamples);
+    return wet;
+}
+
+bool ReverbStage::loadImpulseResponse(const juce::File& file)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples == 0)
+        return false;
+
+    impulseResponseFile = file;
+    reloadImpulseResponse();
+    return true;
+}
+
+void ReverbStage::useDefaultImpulseResponse()
+{
+    impulseResponseFile = juce::File();
+    reloadImpulseResponse();
+}
+
+juce::String ReverbStage::getImpulseResponseName() const
+{
+    return impulseResponseFile == juce::File() ? juce::String("Small room")
+                                               : impulseResponseFile.getFileNameWithoutExtension();
+}
+
+void ReverbStage::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled && !impulseResponseRequested)
+    {
+        impulseResponseRequested = true;
+        reloadImpulseResponse();
+    }
+    enabled = shouldBeEnabled;
+}
+
+bool ReverbStage::isEnabled() const
+{
+    return enabled;
+}
+
+void ReverbStage::setTailLimited(bool shouldLimitTail)
+{
+    if (tailLimited.exchange(shouldLimitTail) != shouldLimitTail)
+        reloadImpulseResponse();
+}
+
+bool ReverbStage::isTailLimited() const
+{
+    return tailLimited;
+}
+
+void ReverbStage::setWetLevel(float level)
+{
+    wetLevel = juce::jlimit(0.0f, 1.0f, level);
+}
+
+bool ReverbStage::isLowPoweredMachine()
+{
+    return juce::SystemStats::getNumPhysicalCpus() <= 2;
+}
+
+// MARK: - (Impulse responses)
+
+void ReverbStage::reloadImpulseResponse()
+{
+    // Settings changed before the reverb was ever enabled are picked up then
+    if (!impulseResponseRequested)
+        return;
+
+    // The convolution loads, trims and resamples on its own background thread
+    if (impulseResponseFile == juce::File())
+    {
+        double seconds = tailLimited ? juce::jmin(kLimitedTailSeconds, kDefaultImpulseSeconds) : kDefaultImpulseSeconds;
+        convolution.loadImpulseResponse(createDefaultImpulseResponse(kDefaultImpulseSampleRate, seconds),
+                                        kDefaultImpulseSampleRate,
+                                        juce::dsp::Convolution::Stereo::no,
+                                        juce::dsp::Convolution::Trim::no,
+                                        juce::dsp::Convolution::Normalise::yes);
+        return;
+    }
+
+    // The size limit is in samples of the file, so work it out at the file's rate
+    size_t maximumLength = 0;
+    if (tailLimited)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(impulseResponseFile));
+        if (reader != nullptr)
+            maximumLength = static_cast<size_t>(reader->sampleRate * kLimitedTailSeconds);
+    }
+
+    convolution.loadImpulseResponse(impulseResponseFile,
+                                    juce::dsp::Convolution::Stereo::no,
+                                    juce::dsp::Convolution::Trim::yes,
+                                    maximumLength,
+                                    juce::dsp::Convolution::Normalise::yes);
+}
+
+juce::AudioBuffer<float> ReverbStage::createDefaultImpulseResponse(double sampleRate, double lengthSeconds)
+{
+    // Exponentially decaying noise with a few early reflections. No direct path:
+    // the dry signal is already in the output.
+    constexpr double decaySeconds = 0.8;  // Time to fall by 60 dB
+    int numSamples = static_cast<int>(sampleRate * lengthSeconds);
+    juce::AudioBuffer<float> impulse(1, numSamples);
+    auto* samples = impulse.getWritePointer(0);
+    juce::Random noise(0x5eed);  // Fixed seed so the room always sounds the same
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        double time = i / sampleRate;
+        double decay = std::pow(10.0, -3.0 * time / decaySeconds);
+        samples[i] = static_cast<float>((noise.nextDouble() * 2.0 - 1.0) * decay * 0.3);
+    }
+
+    for (double reflectionSeconds : { 0.011, 0.017, 0.023, 0.031 })
+    {
+        int index = static_cast<int>(reflectionSeconds * sampleRate);
+        if (index < numSamples)
+            samples[index] += static_cast<float>(std::pow(10.0, -3.0 * reflectionSeconds / decaySeconds));
+    }
+
+    return impulse;
+}
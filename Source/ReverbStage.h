@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_dsp/juce_dsp.h>
+#include <atomic>
+
+// Room reverb for the engine's mono voice, by convolution with an impulse response.
+//
+// juce::dsp::Convolution runs a uniformly partitioned FFT convolution whose
+// partitions are the prepared block size, so the reverb adds no latency beyond
+// the device buffer. Impulse responses are loaded and resampled to the current
+// sample rate on the convolution's background thread, and swapped in without
+// blocking the audio thread. Until a file is loaded a small synthetic room is used.
+// Nothing is built or loaded until the reverb is first enabled, as most
+// sessions never turn it on.
+class ReverbStage
+{
+public:
+    static constexpr double kLimitedTailSeconds = 0.5;  // IR length in the CPU-bounded tail mode
+
+    ReverbStage();
+
+    /** Allocate buffers and resample the impulse response; call before processing, off the audio thread */
+    void prepare(double sampleRate, int maximumBlockSize);
+
+    /**
+     * Finish loading the latest impulse response on this thread, so it's used
+     * from the next block. For offline renders that must be repeatable: it
+     * cuts off the current tail, and the audio thread mustn't be processing.
+     */
+    void finishLoading();
+
+    /**
+     * Convolve one block of the dry signal
+     * @param input Dry mono signal
+     * @param numSamples Number of samples, no more than the prepared block size
+     * @return The wet signal scaled by the wet level, or nullptr if the reverb is off
+     */
+    const float* process(const float* input, int numSamples);
+
+    /**
+     * Use an impulse response from a file in any format juce::AudioFormatManager reads
+     * @return false if the file could not be read
+     */
+    bool loadImpulseResponse(const juce::File& file);
+    void useDefaultImpulseResponse();
+    juce::String getImpulseResponseName() const;
+
+    /** Turn the reverb on or off; the first time on, this starts loading the impulse response */
+    void setEnabled(bool shouldBeEnabled);
+    bool isEnabled() const;
+
+    // Truncate long impulse responses to kLimitedTailSeconds, bounding the CPU cost
+    void setTailLimited(bool shouldLimitTail);
+    bool isTailLimited() const;
+
+    void setWetLevel(float level);  // 0 to 1
+
+    /** Whether the tail should be limited by default on this machine */
+    static bool isLowPoweredMachine();
+
+private:
+    juce::dsp::Convolution convolution;
+    juce::AudioBuffer<float> wetBuffer;
+    double preparedSampleRate;  // 0 until prepared
+    juce::File impulseResponseFile;  // Not set when using the synthetic room
+    juce::AudioFormatManager formatManager;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> tailLimited { false };
+    std::atomic<float> wetLevel { 0.25f };
+    bool wasEnabled;  // Audio thread only
+    bool impulseResponseRequested;  // Whether the reverb has been enabled yet
+
+    void reloadImpulseResponse();
+    static juce::AudioBuffer<float> createDefaultImpulseResponse(double sampleRate, double lengthSeconds);
+};
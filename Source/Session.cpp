@@ -0,0 +1,105 @@
+#include "Session.h"
+
+namespace
+{
+    constexpr int kFormatVersion = 1;
+}
+
+void Session::record(juce::int64 samplePosition, const juce::String& action, juce::NamedValueSet properties)
+{
+    jassert(events.empty() || samplePosition >= events.back().samplePosition);
+    events.push_back({ samplePosition, action, std::move(properties) });
+}
+
+juce::var Session::toVar() const
+{
+    juce::Array<juce::var> eventList;
+    for (auto& event : events)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty("sample", event.samplePosition);
+        object->setProperty("action", event.action);
+        for (auto& property : event.properties)
+            object->setProperty(property.name, property.value);
+        eventList.add(juce::var(object));
+    }
+
+    auto* root = new juce::DynamicObject();
+    root->setProperty("version", kFormatVersion);
+    // As a string: JSON numbers don't hold every 64-bit seed exactly
+    root->setProperty("seed", juce::String(seed));
+    root->setProperty("sampleRate", sampleRate);
+    root->setProperty("blockSize", blockSize);
+    root->setProperty("channels", numChannels);
+    root->setProperty("started", started.toISO8601(true));
+    root->setProperty("events", eventList);
+    return juce::var(root);
+}
+
+bool Session::save(const juce::File& file) const
+{
+    file.getParentDirectory().createDirectory();
+    return file.replaceWithText(juce::JSON::toString(toVar()));
+}
+
+bool Session::load(const juce::File& file, Session& session, juce::String& error)
+{
+    juce::var root;
+    auto result = juce::JSON::parse(file.loadFileAsString(), root);
+    if (result.failed())
+    {
+        error = result.getErrorMessage();
+        return false;
+    }
+
+    if (static_cast<int>(root["version"]) != kFormatVersion || !root["events"].isArray())
+    {
+        error = "Not a session file";
+        return false;
+    }
+
+    session = Session();
+    session.seed = root["seed"].toString().getLargeIntValue();
+    session.sampleRate = root["sampleRate"];
+    session.blockSize = root["blockSize"];
+    session.numChannels = root["channels"];
+    session.started = juce::Time::fromISO8601(root["started"].toString());
+
+    if (session.sampleRate <= 0.0 || session.blockSize <= 0 || session.numChannels <= 0)
+    {
+        error = "Invalid audio format";
+        return false;
+    }
+
+    for (auto& item : *root["events"].getArray())
+    {
+        auto* object = item.getDynamicObject();
+        if (object == nullptr)
+        {
+            error = "Invalid event";
+            return false;
+        }
+
+        Event event;
+        event.samplePosition = static_cast<juce::int64>(item["sample"]);
+        event.action = item["action"].toString();
+        event.properties = object->getProperties();
+        event.properties.remove("sample");
+        event.properties.remove("action");
+        session.events.push_back(std::move(event));
+    }
+
+    return true;
+}
+
+juce::File Session::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("ModeTrainer")
+        .getChildFile("Sessions");
+}
+
+juce::File Session::getDefaultFile() const
+{
+    return getDefaultDirectory().getChildFile(started.formatted("%Y-%m-%d_%H-%M-%S") + ".json");
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// One run of the trainer, recorded so that its audio can be rendered again
+// offline: the seed every random choice came from, the audio format, and each
+// user action and engine command stamped with the number of samples the
+// device had rendered when it was issued. Saved as JSON.
+//
+// Actions and their properties:
+//   play        mode, root (Hz), pattern (name), quiz (bool)
+//   stop
+//   guess       guess, actual (mode names), correct (bool), root, pattern   (no effect on audio)
+//   speed       value
+//   timbre      name
+//   loudness    on
+//   panning     on
+//   reverb      on
+//   reverbTail  on
+//   reverbRoom  file (full path, empty for the built-in room)
+//   format      sampleRate, blockSize, channels (when the device changes)
+class Session
+{
+public:
+    struct Event
+    {
+        juce::int64 samplePosition = 0;
+        juce::String action;
+        juce::NamedValueSet properties;
+    };
+
+    juce::int64 seed = 0;
+    double sampleRate = 44100.0;
+    int blockSize = 512;
+    int numChannels = 2;
+    juce::Time started;
+    std::vector<Event> events;
+
+    /** Append an event; call in sample order */
+    void record(juce::int64 samplePosition, const juce::String& action, juce::NamedValueSet properties = {});
+
+    juce::var toVar() const;
+    bool save(const juce::File& file) const;
+
+    /** Read a session saved by save(); on failure returns false with a reason in error */
+    static bool load(const juce::File& file, Session& session, juce::String& error);
+
+    /** Where the app saves each run's session */
+    static juce::File getDefaultDirectory();
+    juce::File getDefaultFile() const;
+};
@@ -0,0 +1,329 @@
+#include "SessionReplay.h"
+#include "AudioEngine.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_cryptography/juce_cryptography.h>
+#include <cmath>
+#include <iostream>
+#include <optional>
+
+namespace
+{
+    // The convolution loads impulse responses on its own thread, so these
+    // would otherwise take effect at whichever block that thread finished on.
+    // Enabling the reverb starts its first load.
+    bool changesImpulseResponse(const juce::String& action)
+    {
+        return action == "reverb" || action == "reverbTail" || action == "reverbRoom";
+    }
+
+    class Replayer
+    {
+    public:
+        Replayer(const Session& session, SessionReplay::Result& result)
+            : session(session)
+            , result(result)
+        {
+            engine.loadUserPatterns(AudioEngine::getUserPatternFile());
+            engine.setRandomSeed(session.seed);
+            result.audio.setSize(session.numChannels, static_cast<int>(session.sampleRate * 10.0));
+            result.audio.clear();
+        }
+
+        void run()
+        {
+            // The recorded starting settings go in before the engine is prepared,
+            // as they did in the app; preparing finishes any impulse response load
+            size_t next = 0;
+            for (; next < session.events.size() && session.events[next].samplePosition == 0; ++next)
+                apply(session.events[next]);
+
+            engine.prepareToPlay(session.blockSize, session.sampleRate);
+
+            // Later impulse responses are loaded here before the next block,
+            // not left to the convolution's thread
+            for (; next < session.events.size(); ++next)
+            {
+                auto& event = session.events[next];
+                renderUntil(event.samplePosition);
+                apply(event);
+                if (changesImpulseResponse(event.action))
+                    engine.getReverb().finishLoading();
+            }
+
+            while (engine.isCurrentlyPlaying())
+                renderUntil(position + session.blockSize);
+            renderUntil(position + static_cast<juce::int64>(session.sampleRate * SessionReplay::kTailSeconds));
+
+            result.audio.setSize(session.numChannels, static_cast<int>(position), true, false, true);
+        }
+
+    private:
+        const Session& session;
+        SessionReplay::Result& result;
+        AudioEngine engine;
+        juce::int64 position = 0;
+
+        void renderUntil(juce::int64 target)
+        {
+            while (position < target)
+            {
+                int numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(session.blockSize), target - position));
+                if (position + numSamples > result.audio.getNumSamples())
+                    result.audio.setSize(session.numChannels, result.audio.getNumSamples() * 2, true, true);
+
+                engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&result.audio, static_cast<int>(position), numSamples));
+                engine.dispatchPendingNotifications();  // Frees replaced graphs so the next swap can happen
+                position += numSamples;
+            }
+        }
+
+        void apply(const Session::Event& event)
+        {
+            auto& properties = event.properties;
+
+            if (event.action == "play")
+            {
+                auto mode = findMode(properties["mode"].toString());
+                auto pattern = findPattern(properties["pattern"].toString());
+                if (mode.has_value() && pattern.has_value())
+                    play(*mode, static_cast<float>(properties["root"]), *pattern, properties["order"]);
+                else
+                    warn("Can't play " + properties["mode"].toString() + " / " + properties["pattern"].toString()
+                         + " at sample " + juce::String(event.samplePosition));
+            }
+            else if (event.action == "stop")
+            {
+                engine.stopPlaying();
+            }
+            else if (event.action == "speed")
+            {
+                engine.setPlaybackSpeed(static_cast<float>(properties["value"]));
+            }
+            else if (event.action == "timbre")
+            {
+                for (auto timbre : engine.getAllTimbres())
+                    if (engine.getTimbreName(timbre) == properties["name"].toString())
+                        engine.setTimbre(timbre);
+            }
+            else if (event.action == "loudness")
+            {
+                engine.setLoudnessCompensationEnabled(properties["on"]);
+            }
+            else if (event.action == "panning")
+            {
+                engine.setDegreePanningEnabled(properties["on"]);
+            }
+            else if (event.action == "reverb")
+            {
+                engine.getReverb().setEnabled(properties["on"]);
+            }
+            else if (event.action == "reverbTail")
+            {
+                engine.getReverb().setTailLimited(properties["on"]);
+            }
+            else if (event.action == "reverbRoom")
+            {
+                juce::File file(properties["file"].toString());
+                if (properties["file"].toString().isEmpty())
+                    engine.getReverb().useDefaultImpulseResponse();
+                else if (!engine.getReverb().loadImpulseResponse(file))
+                    warn("Room " + file.getFullPathName() + " is missing; using the built-in room");
+            }
+            else if (event.action == "format")
+            {
+                if (static_cast<double>(properties["sampleRate"]) != session.sampleRate
+                    || static_cast<int>(properties["blockSize"]) != session.blockSize
+                    || static_cast<int>(properties["channels"]) != session.numChannels)
+                    warn("The device format changed at sample " + juce::String(event.samplePosition)
+                         + "; the rest is rendered in the starting format");
+            }
+            // guess and anything unknown don't affect the audio
+        }
+
+        void play(AudioEngine::ModeType mode, float rootFrequency, AudioEngine::PlaybackPattern pattern, const juce::var& order)
+        {
+            auto playback = engine.preparePlayback(mode, rootFrequency, pattern);
+            
+            // The recorded order, when there is one: the app may have drawn shuffles
+            // for questions it prepared and then threw away
+            if (auto* indices = order.getArray(); indices != nullptr && indices->size() == static_cast<int>(playback.order.size()))
+            {
+                for (size_t i = 0; i < playback.order.size(); ++i)
+                    playback.order[i] = juce::jlimit(0, static_cast<int>(playback.scale.size()) - 1,
+                                                     static_cast<int>((*indices)[static_cast<int>(i)]));
+            }
+            
+            if (playback.isValid())
+                engine.play(playback);
+        }
+
+        std::optional<AudioEngine::ModeType> findMode(const juce::String& name) const
+        {
+            for (auto mode : engine.getAllModes())
+                if (engine.getModeName(mode) == name)
+                    return mode;
+            return std::nullopt;
+        }
+
+        std::optional<AudioEngine::PlaybackPattern> findPattern(const juce::String& name) const
+        {
+            // By name, since user patterns may be numbered differently on this machine
+            for (auto pattern : engine.getAllPatterns())
+                if (engine.getPatternName(pattern) == name)
+                    return pattern;
+            return std::nullopt;
+        }
+
+        void warn(const juce::String& warning)
+        {
+            result.warnings.add(warning);
+        }
+    };
+
+    juce::AudioBuffer<float> readAudioFile(const juce::File& file)
+    {
+        juce::WavAudioFormat format;
+        juce::AudioBuffer<float> audio;
+        std::unique_ptr<juce::AudioFormatReader> reader(format.createReaderFor(file.createInputStream().release(), true));
+        if (reader != nullptr)
+        {
+            audio.setSize(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+            reader->read(&audio, 0, audio.getNumSamples(), 0, true, true);
+        }
+        return audio;
+    }
+
+    bool writeAudioFile(const juce::File& file, const juce::AudioBuffer<float>& audio, double sampleRate)
+    {
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return false;
+
+        // 32 bits is written as float, so the golden file is exact
+        juce::WavAudioFormat format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(stream.get(), sampleRate,
+                                                                               static_cast<unsigned int>(audio.getNumChannels()),
+                                                                               32, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        stream.release();  // Now owned by the writer
+        return writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+    }
+}
+
+SessionReplay::Result SessionReplay::render(const Session& session)
+{
+    Result result;
+    Replayer(session, result).run();
+    result.hash = hashAudio(result.audio);
+    return result;
+}
+
+juce::String SessionReplay::hashAudio(const juce::AudioBuffer<float>& audio)
+{
+    juce::MemoryOutputStream bytes;
+    for (int channel = 0; channel < audio.getNumChannels(); ++channel)
+    {
+        auto* samples = audio.getReadPointer(channel);
+        for (int i = 0; i < audio.getNumSamples(); ++i)
+            bytes.writeFloat(samples[i]);  // Little-endian on every platform
+    }
+    return juce::SHA256(bytes.getData(), bytes.getDataSize()).toHexString();
+}
+
+juce::File SessionReplay::getGoldenHashFile(const juce::File& sessionFile)
+{
+    return sessionFile.getSiblingFile(sessionFile.getFileNameWithoutExtension() + ".golden.sha256");
+}
+
+juce::File SessionReplay::getGoldenAudioFile(const juce::File& sessionFile)
+{
+    return sessionFile.getSiblingFile(sessionFile.getFileNameWithoutExtension() + ".golden.wav");
+}
+
+void SessionReplay::runFromCommandLine(const juce::ArgumentList& args)
+{
+    juce::File path = args.getExistingFileForOption("--replay");
+    bool updateGolden = args.containsOption("--update-golden");
+    double tolerance = args.containsOption("--tolerance") ? args.getValueForOption("--tolerance").getDoubleValue() : 0.0;
+
+    juce::Array<juce::File> sessionFiles;
+    if (path.isDirectory())
+        sessionFiles = path.findChildFiles(juce::File::findFiles, false, "*.json");
+    else
+        sessionFiles.add(path);
+    sessionFiles.sort();
+
+    int numFailed = 0;
+    for (auto& file : sessionFiles)
+    {
+        Session session;
+        juce::String error;
+        if (!Session::load(file, session, error))
+        {
+            std::cout << "FAIL  " << file.getFileName() << ": " << error << std::endl;
+            numFailed++;
+            continue;
+        }
+
+        auto result = render(session);
+        for (auto& warning : result.warnings)
+            std::cout << "      " << file.getFileName() << ": " << warning << std::endl;
+
+        auto description = file.getFileName() + " (" + juce::String(result.audio.getNumSamples() / session.sampleRate, 1)
+                         + " s, " + juce::String(static_cast<int>(session.events.size())) + " events)";
+
+        if (updateGolden)
+        {
+            if (!getGoldenHashFile(file).replaceWithText(result.hash + "\n")
+                || !writeAudioFile(getGoldenAudioFile(file), result.audio, session.sampleRate))
+                juce::ConsoleApplication::fail("Couldn't write the golden files for " + file.getFileName(), 1);
+            std::cout << "saved " << description << " " << result.hash << std::endl;
+            continue;
+        }
+
+        auto goldenHash = getGoldenHashFile(file).loadFileAsString().trim();
+        if (goldenHash.isEmpty())
+        {
+            std::cout << "FAIL  " << description << ": no golden files (run with --update-golden)" << std::endl;
+            numFailed++;
+        }
+        else if (goldenHash == result.hash)
+        {
+            std::cout << "exact " << description << std::endl;
+        }
+        else
+        {
+            auto golden = readAudioFile(getGoldenAudioFile(file));
+            if (golden.getNumChannels() != result.audio.getNumChannels()
+                || golden.getNumSamples() != result.audio.getNumSamples())
+            {
+                std::cout << "FAIL  " << description << ": length or channels differ from the golden audio" << std::endl;
+                numFailed++;
+                continue;
+            }
+
+            float worstDifference = 0.0f;
+            for (int channel = 0; channel < golden.getNumChannels(); ++channel)
+            {
+                auto* expected = golden.getReadPointer(channel);
+                auto* actual = result.audio.getReadPointer(channel);
+                for (int i = 0; i < golden.getNumSamples(); ++i)
+                    worstDifference = juce::jmax(worstDifference, std::abs(expected[i] - actual[i]));
+            }
+
+            bool withinTolerance = worstDifference <= tolerance;
+            std::cout << (withinTolerance ? "close " : "FAIL  ") << description
+                      << ": largest difference " << worstDifference
+                      << " (" << juce::Decibels::gainToDecibels(worstDifference) << " dBFS)" << std::endl;
+            if (!withinTolerance)
+                numFailed++;
+        }
+    }
+
+    std::cout << sessionFiles.size() << " sessions replayed, " << numFailed << " failed" << std::endl;
+    if (numFailed > 0)
+        juce::ConsoleApplication::fail(juce::String(numFailed) + " sessions did not match", 1);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "Session.h"
+
+// Renders a recorded Session again without a device, applying each event at
+// its recorded sample position, and checks the result against golden files
+// saved next to the session: <name>.golden.sha256 (the SHA-256 of the audio)
+// and <name>.golden.wav (the audio itself, as 32-bit float).
+//
+// A matching hash means the render is bit-exact. Otherwise the audio is
+// compared sample by sample with the golden WAV, so a change that is allowed
+// to differ slightly (e.g. a vectorized kernel replacing a scalar one) can be
+// accepted within a tolerance.
+class SessionReplay
+{
+public:
+    static constexpr double kTailSeconds = 1.0;  // Rendered after the last note, for reverb tails
+
+    struct Result
+    {
+        juce::AudioBuffer<float> audio;
+        juce::String hash;
+        juce::StringArray warnings;  // Things that make the render differ from what was heard
+    };
+
+    /** Render a session's audio */
+    static Result render(const Session& session);
+
+    /** SHA-256 of the samples as little-endian float32, channel by channel */
+    static juce::String hashAudio(const juce::AudioBuffer<float>& audio);
+
+    static juce::File getGoldenHashFile(const juce::File& sessionFile);
+    static juce::File getGoldenAudioFile(const juce::File& sessionFile);
+
+    static void runFromCommandLine(const juce::ArgumentList& args);
+};
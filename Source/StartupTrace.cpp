@@ -0,0 +1,88 @@
+#include "StartupTrace.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    struct Phase
+    {
+        juce::String name;
+        double milliseconds;
+    };
+
+    juce::CriticalSection lock;
+    double startTime = 0.0;
+    juce::Time launchTime;
+    std::vector<Phase> phases;
+    bool finished = false;
+}
+
+void StartupTrace::begin()
+{
+    const juce::ScopedLock scopedLock(lock);
+    startTime = juce::Time::getMillisecondCounterHiRes();
+    launchTime = juce::Time::getCurrentTime();
+    phases.clear();
+    finished = false;
+}
+
+void StartupTrace::mark(const juce::String& phase)
+{
+    markAt(phase, juce::Time::getMillisecondCounterHiRes());
+}
+
+void StartupTrace::markAt(const juce::String& phase, double millisecondCounter)
+{
+    const juce::ScopedLock scopedLock(lock);
+    if (finished || startTime == 0.0)
+        return;
+
+    phases.push_back({ phase, millisecondCounter - startTime });
+}
+
+juce::String StartupTrace::getSummary()
+{
+    const juce::ScopedLock scopedLock(lock);
+
+    // Phases from different threads can be marked out of order
+    auto sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b)
+    {
+        return a.milliseconds < b.milliseconds;
+    });
+
+    juce::String summary = "Startup trace:\n";
+    for (auto& phase : sorted)
+        summary << juce::String(phase.milliseconds, 1).paddedLeft(' ', 9) << " ms  " << phase.name << "\n";
+    return summary;
+}
+
+void StartupTrace::finish(const juce::String& applicationVersion)
+{
+    juce::String csv;
+    {
+        const juce::ScopedLock scopedLock(lock);
+        if (finished || startTime == 0.0)
+            return;
+        finished = true;
+
+        auto launch = launchTime.toISO8601(true);
+        for (auto& phase : phases)
+            csv << launch << "," << applicationVersion << ",\"" << phase.name << "\"," << juce::String(phase.milliseconds, 1) << "\n";
+    }
+
+    juce::Logger::writeToLog(getSummary());
+
+    auto file = getLogFile();
+    file.getParentDirectory().createDirectory();
+    if (!file.existsAsFile())
+        file.appendText("launch,version,phase,milliseconds\n");
+    file.appendText(csv);
+}
+
+juce::File StartupTrace::getLogFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("ModeTrainer")
+        .getChildFile("StartupTrace.csv");
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+// Timestamps for each phase of launching the app, so cold-start time can be
+// compared between releases. Phases can be marked from any thread except the
+// audio thread (marking allocates). finish() logs the trace and appends it to
+// getLogFile() as CSV: launch time, version, phase, milliseconds since begin().
+class StartupTrace
+{
+public:
+    /** Start timing; phases are measured from here */
+    static void begin();
+
+    /** Record that a phase has just been reached */
+    static void mark(const juce::String& phase);
+
+    /** Record a phase reached earlier, at a juce::Time::getMillisecondCounterHiRes() time */
+    static void markAt(const juce::String& phase, double millisecondCounter);
+
+    /** Log the trace and append it to the log file; only the first call does anything */
+    static void finish(const juce::String& applicationVersion);
+
+    static juce::String getSummary();
+    static juce::File getLogFile();
+};
@@ -0,0 +1,236 @@
+#include "Trace.h"
+#include <juce_events/juce_events.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        juce::int64 startTicks;
+        juce::int64 endTicks;
+    };
+
+    // An Event as stored in a ring. Its fields are atomic because
+    // writeChromeJson() copies slots that the owning thread may be
+    // overwriting; relaxed accesses compile to plain loads and stores.
+    struct EventSlot
+    {
+        std::atomic<const char*> name { nullptr };
+        std::atomic<juce::int64> startTicks { 0 };
+        std::atomic<juce::int64> endTicks { 0 };
+    };
+
+    enum SlotState
+    {
+        unused,
+        owned,
+        released  // Its thread exited; the events stay until another thread takes it
+    };
+
+    // Written by one thread only; writeIndex counts every event ever written,
+    // so a reader can tell which entries were overwritten while it copied them
+    struct ThreadBuffer
+    {
+        std::atomic<int> state { unused };
+        std::atomic<juce::uint64> writeIndex { 0 };
+        std::atomic<juce::uint64> ownerStartIndex { 0 };  // First event of the thread that owns it now
+        std::atomic<const char*> name { nullptr };
+        EventSlot events[Trace::kEventsPerThread];
+    };
+
+    std::unique_ptr<ThreadBuffer[]> buffers;                // Never freed once allocated
+    std::atomic<ThreadBuffer*> publishedBuffers { nullptr };
+
+    // Hands the slot back when its thread exits, so that threads started
+    // later (e.g. the audio thread after a device reopens) can be recorded.
+    // Only constructed once a slot is claimed; registering its destructor
+    // may allocate, once per thread.
+    struct SlotRelease
+    {
+        ThreadBuffer* buffer;
+        ~SlotRelease() { buffer->state.store(released, std::memory_order_release); }
+    };
+
+    ThreadBuffer* claimSlot(ThreadBuffer* all) noexcept
+    {
+        // Slots never used first, so an exited thread's events are kept as long as possible
+        for (int from : { static_cast<int>(unused), static_cast<int>(released) })
+        {
+            for (int slot = 0; slot < Trace::kMaxThreads; ++slot)
+            {
+                int expected = from;
+                if (all[slot].state.compare_exchange_strong(expected, owned, std::memory_order_acq_rel))
+                {
+                    auto& buffer = all[slot];
+                    buffer.name.store(nullptr, std::memory_order_relaxed);
+                    buffer.ownerStartIndex.store(buffer.writeIndex.load(std::memory_order_relaxed), std::memory_order_release);
+                    return &buffer;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    ThreadBuffer* getThreadBuffer() noexcept
+    {
+        thread_local ThreadBuffer* buffer = nullptr;
+        if (buffer != nullptr)
+            return buffer;
+
+        auto* all = publishedBuffers.load(std::memory_order_acquire);
+        if (all == nullptr)
+            return nullptr;
+
+        // Tried again on later events while every slot is taken
+        buffer = claimSlot(all);
+        if (buffer == nullptr)
+            return nullptr;
+
+        thread_local SlotRelease release { buffer };
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            buffer->name = "Message thread";
+        return buffer;
+    }
+
+    juce::String escape(const char* text)
+    {
+        return juce::JSON::toString(juce::var(juce::String(text)));  // Quoted and escaped
+    }
+}
+
+void Trace::setEnabled(bool shouldRecord)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+
+    if (shouldRecord && buffers == nullptr)
+    {
+        buffers = std::make_unique<ThreadBuffer[]>(kMaxThreads);
+        publishedBuffers.store(buffers.get(), std::memory_order_release);
+    }
+
+    enabled.store(shouldRecord, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const char* name) noexcept
+{
+    if (!isEnabled())
+        return;
+
+    if (auto* buffer = getThreadBuffer())
+        buffer->name.store(name, std::memory_order_relaxed);
+}
+
+void Trace::record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept
+{
+    auto* buffer = getThreadBuffer();
+    if (buffer == nullptr)
+        return;
+
+    // The fence pairs with the one in writeChromeJson(): a reader that sees
+    // any of this event's fields also sees writeIndex at least at index, and
+    // so knows the slot's older event is being overwritten
+    auto index = buffer->writeIndex.load(std::memory_order_relaxed);
+    auto& slot = buffer->events[index % kEventsPerThread];
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startTicks.store(startTicks, std::memory_order_relaxed);
+    slot.endTicks.store(endTicks, std::memory_order_relaxed);
+    buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool Trace::writeChromeJson(const juce::File& file)
+{
+    auto* all = publishedBuffers.load(std::memory_order_acquire);
+
+    struct ThreadEvents
+    {
+        int threadNumber;
+        const char* name;
+        std::vector<Event> events;
+    };
+    std::vector<ThreadEvents> threads;
+    juce::int64 firstTicks = std::numeric_limits<juce::int64>::max();
+
+    for (int slot = 0; all != nullptr && slot < kMaxThreads; ++slot)
+    {
+        auto& buffer = all[slot];
+        if (buffer.state.load(std::memory_order_acquire) == unused)
+            continue;
+
+        // Only the current owner's events, which its name applies to
+        auto ownerStart = buffer.ownerStartIndex.load(std::memory_order_acquire);
+        auto end = buffer.writeIndex.load(std::memory_order_acquire);
+        auto begin = juce::jmax(ownerStart, end > static_cast<juce::uint64>(kEventsPerThread) ? end - kEventsPerThread : 0);
+
+        ThreadEvents thread { slot + 1, buffer.name.load(std::memory_order_relaxed), {} };
+        thread.events.reserve(static_cast<size_t>(end - begin));
+        for (auto i = begin; i < end; ++i)
+        {
+            auto& slot = buffer.events[i % kEventsPerThread];
+            thread.events.push_back({ slot.name.load(std::memory_order_relaxed),
+                                      slot.startTicks.load(std::memory_order_relaxed),
+                                      slot.endTicks.load(std::memory_order_relaxed) });
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // The thread kept recording while these were copied; drop any it
+        // overwrote, including the one it may have been writing when it last
+        // bumped writeIndex, as those may mix fields of two events
+        auto endAfterCopy = buffer.writeIndex.load(std::memory_order_acquire);
+        auto firstIntact = endAfterCopy >= static_cast<juce::uint64>(kEventsPerThread) ? endAfterCopy - kEventsPerThread + 1 : 0;
+        if (firstIntact > begin)
+            thread.events.erase(thread.events.begin(),
+                                thread.events.begin() + static_cast<std::ptrdiff_t>(juce::jmin(firstIntact - begin, end - begin)));
+
+        for (auto& event : thread.events)
+            firstTicks = juce::jmin(firstTicks, event.startTicks);
+        threads.push_back(std::move(thread));
+    }
+
+    auto ticksToMicroseconds = [ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond())](juce::int64 ticks)
+    {
+        return static_cast<double>(ticks) * 1.0e6 / ticksPerSecond;
+    };
+
+    file.getParentDirectory().createDirectory();
+    file.deleteFile();
+    auto stream = file.createOutputStream();
+    if (stream == nullptr)
+        return false;
+
+    // Names are string literals from the code, but are escaped all the same
+    *stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (auto& thread : threads)
+    {
+        auto threadName = thread.name != nullptr ? juce::String(thread.name) : "Thread " + juce::String(thread.threadNumber);
+        *stream << (first ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadNumber
+                << ",\"args\":{\"name\":" << juce::JSON::toString(juce::var(threadName)) << "}}";
+        first = false;
+
+        for (auto& event : thread.events)
+        {
+            *stream << ",\n{\"name\":" << escape(event.name)
+                    << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread.threadNumber
+                    << ",\"ts\":" << juce::String(ticksToMicroseconds(event.startTicks - firstTicks), 3)
+                    << ",\"dur\":" << juce::String(ticksToMicroseconds(event.endTicks - event.startTicks), 3) << "}";
+        }
+    }
+    *stream << "\n]}\n";
+
+    stream->flush();
+    return stream->getStatus().wasOk();
+}
+
+juce::File Trace::getDefaultFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("ModeTrainer")
+        .getChildFile("Traces")
+        .getChildFile("Trace_" + juce::Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S") + ".json");
+}
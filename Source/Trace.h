@@ -0,0 +1,73 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+// Scoped timing events from any thread, including the audio thread, for
+// looking at what happened around a stutter. Each thread records into its
+// own fixed ring of the most recent kEventsPerThread events, so recording
+// never locks or allocates; the rings are allocated when tracing is first
+// enabled. writeChromeJson() dumps every thread's ring in the Chrome trace
+// event format, which chrome://tracing and ui.perfetto.dev open.
+//
+// Build with MODETRAINER_TRACE=0 to compile the scopes out. Compiled in but
+// disabled (the default at runtime), a scope costs one relaxed atomic load.
+#ifndef MODETRAINER_TRACE
+ #define MODETRAINER_TRACE 1
+#endif
+
+class Trace
+{
+public:
+    static constexpr int kMaxThreads = 16;          // Threads recorded at once; a thread's slot is reused after it exits
+    static constexpr int kEventsPerThread = 16384;  // About 20 s of audio callbacks at 128 samples and 48 kHz
+
+    // Records the time from construction to destruction, if tracing was enabled at construction
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name) noexcept
+            : name(name)
+            , startTicks(isEnabled() ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~Scope() noexcept
+        {
+            if (startTicks != 0)
+                record(name, startTicks, juce::Time::getHighResolutionTicks());
+        }
+
+    private:
+        const char* name;  // A string literal; only the pointer is kept
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(Scope)
+    };
+
+    /** Start or stop recording; message thread. The first start allocates the rings. */
+    static void setEnabled(bool shouldRecord);
+    static bool isEnabled() noexcept { return enabled.load(std::memory_order_relaxed); }
+
+    /** Name the calling thread in the trace (a string literal); threads are numbered otherwise */
+    static void setThreadName(const char* name) noexcept;
+
+    /** Write the events recorded so far as Chrome trace JSON; safe while threads are still recording */
+    static bool writeChromeJson(const juce::File& file);
+
+    /** A new file in ModeTrainer/Traces, named after the current time */
+    static juce::File getDefaultFile();
+
+    static void record(const char* name, juce::int64 startTicks, juce::int64 endTicks) noexcept;
+
+private:
+    static inline std::atomic<bool> enabled { false };
+};
+
+#if MODETRAINER_TRACE
+ #define TRACE_SCOPE_NAME_(line) traceScope_##line
+ #define TRACE_SCOPE_NAME(line) TRACE_SCOPE_NAME_(line)
+ #define TRACE_SCOPE(name) const Trace::Scope TRACE_SCOPE_NAME(__LINE__) (name)
+#else
+ #define TRACE_SCOPE(name)
+#endif
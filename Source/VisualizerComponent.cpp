@@ -0,0 +1,348 @@
+#include "VisualizerComponent.h"
+#include "AudioEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    constexpr float kFloorDecibels = -90.0f;
+    constexpr float kDecayDecibelsPerFrame = 1.5f;  // About 90 dB/s at 60 Hz
+    constexpr int kFramesToSettle = 90;              // Keep drawing this long after input stops
+    constexpr float kSilencePeak = 0.0001f;          // -80 dB; quieter blocks don't count as input
+}
+
+VisualizerComponent::VisualizerComponent(AudioTap& tap)
+    : tap(tap)
+    , fft(kFftOrder)
+    , window(static_cast<size_t>(kFftSize))
+    , history(static_cast<size_t>(kFftSize), 0.0f)
+    , historyPosition(0)
+    , incoming(static_cast<size_t>(kFftSize))
+    , fftData(static_cast<size_t>(2 * kFftSize), 0.0f)
+    , columnBinsSampleRate(0.0)
+    , framesSinceInput(kFramesToSettle)
+    , paused(false)
+{
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), window.size(),
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+    setOpaque(true);
+}
+
+void VisualizerComponent::setScale(const std::vector<float>& degreeFrequencies)
+{
+    scaleFrequencies = degreeFrequencies;
+    repaint(spectrumArea);
+}
+
+void VisualizerComponent::resized()
+{
+    auto area = getLocalBounds().reduced(4);
+    spectrumArea = area.removeFromLeft(area.getWidth() * 2 / 3);
+    area.removeFromLeft(8);
+    waveformArea = area;
+
+    spectrumDecibels.assign(static_cast<size_t>(juce::jlimit(1, kMaxColumns, spectrumArea.getWidth())), kFloorDecibels);
+    updateColumnBins();
+    auto numWaveformColumns = static_cast<size_t>(juce::jlimit(1, kMaxColumns, waveformArea.getWidth()));
+    waveformMinimum.assign(numWaveformColumns, 0.0f);
+    waveformMaximum.assign(numWaveformColumns, 0.0f);
+}
+
+void VisualizerComponent::setPaused(bool shouldPause)
+{
+    paused = shouldPause;
+    updateTimer();
+}
+
+void VisualizerComponent::visibilityChanged()
+{
+    updateTimer();
+}
+
+void VisualizerComponent::updateTimer()
+{
+    // No analysis at all while hidden or paused
+    if (isVisible() && !paused)
+        startTimerHz(60);
+    else
+        stopTimer();
+}
+
+// MARK: - (Analysis)
+
+void VisualizerComponent::timerCallback()
+{
+    if (readTap())
+        framesSinceInput = 0;
+    else if (framesSinceInput < kFramesToSettle)
+        framesSinceInput++;
+    else
+        return; // Settled on silence; nothing changes until more audio arrives
+
+    updateSpectrum();
+    updateWaveform();
+    repaint();
+}
+
+bool VisualizerComponent::readTap()
+{
+    bool gotSound = false;
+    int numRead;
+    while ((numRead = tap.pull(incoming.data(), static_cast<int>(incoming.size()))) > 0)
+    {
+        // A running device sends silent blocks too; only sound keeps the display awake
+        auto range = juce::FloatVectorOperations::findMinAndMax(incoming.data(), numRead);
+        gotSound = gotSound || juce::jmax(-range.getStart(), range.getEnd()) > kSilencePeak;
+        for (int i = 0; i < numRead; ++i)
+        {
+            history[static_cast<size_t>(historyPosition)] = incoming[static_cast<size_t>(i)];
+            historyPosition = (historyPosition + 1) % kFftSize;
+        }
+    }
+    return gotSound;
+}
+
+void VisualizerComponent::updateColumnBins()
+{
+    // Columns are spaced evenly in log frequency; each takes the bins from the
+    // one holding its low edge to the one holding its high edge
+    double sampleRate = tap.getSampleRate();
+    double binHz = juce::jmax(1.0, sampleRate) / kFftSize;  // Any rate before the device opens
+    double minimumFrequency = getMinimumFrequency();
+    double frequencyRatio = getMaximumFrequency() / minimumFrequency;
+    auto numColumns = spectrumDecibels.size();
+    int lastBin = kFftSize / 2 - 1;
+
+    columnFirstBin.resize(numColumns);
+    columnLastBin.resize(numColumns);
+    for (size_t column = 0; column < numColumns; ++column)
+    {
+        double lowFrequency = minimumFrequency * std::pow(frequencyRatio, static_cast<double>(column) / numColumns);
+        double highFrequency = minimumFrequency * std::pow(frequencyRatio, static_cast<double>(column + 1) / numColumns);
+        columnFirstBin[column] = juce::jlimit(0, lastBin, static_cast<int>(lowFrequency / binHz));
+        columnLastBin[column] = juce::jlimit(columnFirstBin[column], lastBin, static_cast<int>(std::ceil(highFrequency / binHz)));
+    }
+    columnBinsSampleRate = sampleRate;
+}
+
+void VisualizerComponent::updateSpectrum()
+{
+    // Unroll the ring oldest first and window it
+    auto split = static_cast<size_t>(historyPosition);
+    std::copy(history.begin() + static_cast<std::ptrdiff_t>(split), history.end(), fftData.begin());
+    std::copy(history.begin(), history.begin() + static_cast<std::ptrdiff_t>(split),
+              fftData.begin() + static_cast<std::ptrdiff_t>(kFftSize - split));
+    juce::FloatVectorOperations::multiply(fftData.data(), window.data(), kFftSize);
+    std::fill(fftData.begin() + kFftSize, fftData.end(), 0.0f);
+
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    // A full-scale sine through a Hann window peaks at kFftSize / 4
+    juce::FloatVectorOperations::multiply(fftData.data(), 4.0f / kFftSize, kFftSize / 2);
+
+    // The device, and so the bins' frequencies, may have changed since the last resize
+    if (tap.getSampleRate() != columnBinsSampleRate)
+        updateColumnBins();
+
+    // Each column takes the loudest bin in its frequency range
+    for (size_t column = 0; column < spectrumDecibels.size(); ++column)
+    {
+        int lowBin = columnFirstBin[column];
+        auto range = juce::FloatVectorOperations::findMinAndMax(fftData.data() + lowBin, columnLastBin[column] - lowBin + 1);
+        float decibels = juce::Decibels::gainToDecibels(range.getEnd(), kFloorDecibels);
+
+        // Rise immediately, fall slowly
+        auto& shown = spectrumDecibels[column];
+        shown = juce::jmax(decibels, shown - kDecayDecibelsPerFrame);
+    }
+}
+
+void VisualizerComponent::updateWaveform()
+{
+    auto numColumns = waveformMinimum.size();
+    int start = (historyPosition - kWaveformSamples + kFftSize) % kFftSize;
+
+    for (size_t column = 0; column < numColumns; ++column)
+    {
+        int first = static_cast<int>(column * kWaveformSamples / numColumns);
+        int last = juce::jmax(first + 1, static_cast<int>((column + 1) * kWaveformSamples / numColumns));
+
+        float minimum = 1.0f, maximum = -1.0f;
+        for (int i = first; i < last; ++i)
+        {
+            float sample = history[static_cast<size_t>((start + i) % kFftSize)];
+            minimum = juce::jmin(minimum, sample);
+            maximum = juce::jmax(maximum, sample);
+        }
+        waveformMinimum[column] = minimum;
+        waveformMaximum[column] = maximum;
+    }
+}
+
+float VisualizerComponent::getMinimumFrequency() const
+{
+    return 50.0f;
+}
+
+float VisualizerComponent::getMaximumFrequency() const
+{
+    return juce::jmin(8000.0f, static_cast<float>(tap.getSampleRate() * 0.5));
+}
+
+float VisualizerComponent::frequencyToX(float frequency) const
+{
+    float proportion = std::log(frequency / getMinimumFrequency())
+                     / std::log(getMaximumFrequency() / getMinimumFrequency());
+    return static_cast<float>(spectrumArea.getX()) + proportion * static_cast<float>(spectrumArea.getWidth());
+}
+
+// MARK: - (Drawing)
+
+void VisualizerComponent::paint(juce::Graphics& g)
+{
+    auto background = getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId);
+    auto foreground = getLookAndFeel().findColour(juce::Label::textColourId);
+    auto trace = juce::Colours::darkblue.interpolatedWith(foreground, 0.3f);
+
+    g.fillAll(background);
+    g.setColour(background.contrasting(0.08f));
+    g.fillRect(spectrumArea);
+    g.fillRect(waveformArea);
+
+    // Spectrum, filled down to the floor
+    if (!spectrumDecibels.empty())
+    {
+        auto area = spectrumArea.toFloat();
+        float columnWidth = area.getWidth() / static_cast<float>(spectrumDecibels.size());
+        juce::Path spectrum;
+        spectrum.startNewSubPath(area.getBottomLeft());
+        for (size_t column = 0; column < spectrumDecibels.size(); ++column)
+        {
+            float y = juce::jmap(spectrumDecibels[column], kFloorDecibels, 0.0f, area.getBottom(), area.getY());
+            spectrum.lineTo(area.getX() + (static_cast<float>(column) + 0.5f) * columnWidth, y);
+        }
+        spectrum.lineTo(area.getBottomRight());
+        spectrum.closeSubPath();
+        g.setColour(trace.withAlpha(0.6f));
+        g.fillPath(spectrum);
+    }
+
+    // Scale degree markers
+    g.setFont(11.0f);
+    for (size_t degree = 0; degree < scaleFrequencies.size(); ++degree)
+    {
+        float frequency = scaleFrequencies[degree];
+        if (frequency < getMinimumFrequency() || frequency > getMaximumFrequency())
+            continue;
+
+        float x = frequencyToX(frequency);
+        g.setColour(foreground.withAlpha(0.35f));
+        g.drawVerticalLine(juce::roundToInt(x), static_cast<float>(spectrumArea.getY()) + 14.0f,
+                           static_cast<float>(spectrumArea.getBottom()));
+        g.setColour(foreground);
+        g.drawText(juce::String(static_cast<int>(degree) + 1),
+                   juce::Rectangle<float>(x - 10.0f, static_cast<float>(spectrumArea.getY()), 20.0f, 14.0f),
+                   juce::Justification::centred, false);
+    }
+
+    // Waveform as a min/max envelope per column
+    if (!waveformMinimum.empty())
+    {
+        auto area = waveformArea.toFloat();
+        float columnWidth = area.getWidth() / static_cast<float>(waveformMinimum.size());
+        auto toY = [&area](float sample) { return juce::jmap(juce::jlimit(-1.0f, 1.0f, sample * 4.0f), 1.0f, -1.0f,
+                                                              area.getY(), area.getBottom()); };
+
+        juce::Path waveform;
+        waveform.startNewSubPath(area.getX(), toY(waveformMaximum[0]));
+        for (size_t column = 1; column < waveformMaximum.size(); ++column)
+            waveform.lineTo(area.getX() + static_cast<float>(column) * columnWidth, toY(waveformMaximum[column]));
+        for (size_t column = waveformMinimum.size(); column-- > 0;)
+            waveform.lineTo(area.getX() + static_cast<float>(column) * columnWidth, toY(waveformMinimum[column]) + 1.0f);
+        waveform.closeSubPath();
+        g.setColour(trace);
+        g.fillPath(waveform);
+    }
+}
+
+// MARK: - (Benchmark)
+
+void VisualizerComponent::runFromCommandLine(const juce::ArgumentList& args)
+{
+    int width = args.containsOption("--width") ? args.getValueForOption("--width").getIntValue() : kMaxWindowWidth;
+    int numFrames = args.containsOption("--frames") ? args.getValueForOption("--frames").getIntValue() : 600;
+    if (width < 16 || numFrames < 1)
+        juce::ConsoleApplication::fail("--width must be at least 16 and --frames at least 1", 1);
+
+    constexpr double sampleRate = 48000.0;
+    constexpr double frameRate = 60.0;
+    constexpr int blockSize = 512;
+
+    // The engine plays continuously into the tap, a frame's worth of audio
+    // between display frames, as the audio callback would
+    AudioEngine engine;
+    engine.setTimbre(AudioEngine::Timbre::Warm);
+    engine.prepareToPlay(blockSize, sampleRate);
+    auto playback = engine.preparePlayback(AudioEngine::ModeType::Dorian, 220.0f, AudioEngine::PlaybackPattern::Ascending);
+    juce::AudioBuffer<float> block(2, blockSize);
+
+    AudioTap tap;
+    tap.setSampleRate(sampleRate);
+    VisualizerComponent visualizer(tap);
+    visualizer.setBounds(0, 0, width, 240);
+    visualizer.setScale(playback.scale);
+
+    // Painted in software, which is at least as slow as the window's own renderer
+    juce::Image image(juce::Image::RGB, width, 240, true, juce::SoftwareImageType());
+    std::vector<double> analysisMs, paintMs;
+    double samplesOwed = 0.0;
+
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        for (samplesOwed += sampleRate / frameRate; samplesOwed >= blockSize; samplesOwed -= blockSize)
+        {
+            if (!engine.isCurrentlyPlaying())
+                engine.play(playback);
+            engine.getNextAudioBlock(juce::AudioSourceChannelInfo(&block, 0, blockSize));
+            engine.dispatchPendingNotifications();
+            tap.push(block.getReadPointer(0), blockSize);
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        visualizer.timerCallback();
+        auto analysed = juce::Time::getHighResolutionTicks();
+        {
+            juce::Graphics g(image);
+            visualizer.paint(g);
+        }
+        auto painted = juce::Time::getHighResolutionTicks();
+
+        analysisMs.push_back(juce::Time::highResolutionTicksToSeconds(analysed - start) * 1000.0);
+        paintMs.push_back(juce::Time::highResolutionTicksToSeconds(painted - analysed) * 1000.0);
+    }
+
+    auto mean = [](const std::vector<double>& values)
+    {
+        double total = 0.0;
+        for (double value : values)
+            total += value;
+        return total / static_cast<double>(values.size());
+    };
+    auto percentile99 = [](std::vector<double> values)
+    {
+        auto index = static_cast<size_t>(0.99 * static_cast<double>(values.size() - 1));
+        std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values[index];
+    };
+
+    double frameMs = mean(analysisMs) + mean(paintMs);
+    double coreFraction = frameMs * frameRate / 1000.0;
+    std::cout << numFrames << " frames at " << width << " px: analysis " << juce::String(mean(analysisMs), 3)
+              << " ms (p99 " << juce::String(percentile99(analysisMs), 3) << "), paint " << juce::String(mean(paintMs), 3)
+              << " ms (p99 " << juce::String(percentile99(paintMs), 3) << "), "
+              << juce::String(coreFraction * 100.0, 2) << "% of a core at 60 fps" << std::endl;
+
+    if (coreFraction > kMaxCoreFraction)
+        juce::ConsoleApplication::fail("Over the budget of " + juce::String(kMaxCoreFraction * 100.0, 0) + "% of a core", 1);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_dsp/juce_dsp.h>
+#include <vector>
+#include "AudioTap.h"
+
+// Live spectrum (log frequency, with the playing scale's degrees marked) and
+// waveform of what the audio callback writes into an AudioTap.
+//
+// All analysis happens here on the message thread at display rate: the audio
+// thread only copies into the tap. Drawing is decimated to at most kMaxColumns
+// columns however wide the window is, and the timer stops repainting once
+// everything has decayed to silence. Each column's FFT bins are worked out on
+// resize rather than per frame.
+class VisualizerComponent : public juce::Component, private juce::Timer
+{
+public:
+    static constexpr int kFftOrder = 12;
+    static constexpr int kFftSize = 1 << kFftOrder;
+    static constexpr int kWaveformSamples = 2048;
+    static constexpr int kMaxColumns = 1024;
+    static constexpr int kMaxWindowWidth = 8192;      // Widest window it's expected to keep up at
+    static constexpr double kMaxCoreFraction = 0.05;  // Of one core at 60 fps, analysis and painting together
+
+    explicit VisualizerComponent(AudioTap& tap);
+
+    /** Scale degree frequencies to mark, lowest first; empty to clear */
+    void setScale(const std::vector<float>& degreeFrequencies);
+
+    /** Stop analysing altogether, e.g. while the audio device is closed */
+    void setPaused(bool shouldPause);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void visibilityChanged() override;
+
+    /** Entry point for the --visualizer-bench command line option */
+    static void runFromCommandLine(const juce::ArgumentList& args);
+
+private:
+    AudioTap& tap;
+    juce::dsp::FFT fft;
+    std::vector<float> window;          // Hann, kFftSize
+    std::vector<float> history;         // Ring of the most recent kFftSize samples
+    int historyPosition;
+    std::vector<float> incoming;        // Scratch for reading the tap
+    std::vector<float> fftData;         // 2 * kFftSize, as juce::dsp::FFT wants
+    std::vector<float> spectrumDecibels;  // Per column, smoothed
+    std::vector<int> columnFirstBin;      // Per column, the FFT bins it covers
+    std::vector<int> columnLastBin;
+    double columnBinsSampleRate;          // Rate the bins were worked out for
+    std::vector<float> waveformMinimum;   // Per column
+    std::vector<float> waveformMaximum;
+    std::vector<float> scaleFrequencies;
+
+    juce::Rectangle<int> spectrumArea, waveformArea;
+    int framesSinceInput;
+    bool paused;
+
+    void timerCallback() override;
+    void updateTimer();
+    bool readTap();
+    void updateColumnBins();
+    void updateSpectrum();
+    void updateWaveform();
+    float frequencyToX(float frequency) const;
+    float getMinimumFrequency() const;
+    float getMaximumFrequency() const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VisualizerComponent)
+};